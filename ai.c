@@ -0,0 +1,419 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - computer opponent
+*
+*   The search runs in generations: a coarse grid over every angle and power first, then
+*   generations of random shots around the best one so far, narrower each time. Within a
+*   generation the candidates are independent, so the workers (and the calling thread) grab
+*   them in batches; the best one is only picked between generations, by index on ties,
+*   so a search without time budget gives the same shot whatever the number of threads.
+*   AIChooseShotLocal() runs the same generations on the calling thread only, with its own
+*   candidates, for callers that already keep every core busy with their own threads.
+*
+********************************************************************************************/
+
+#include "ai.h"
+#include "scheduler.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+#if defined(PLATFORM_WEB) && !defined(AI_NO_THREADS)
+    #define AI_NO_THREADS               // Emscripten builds are single threaded
+#endif
+
+#if !defined(AI_NO_THREADS)
+    #include <pthread.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define AI_MAX_WORKERS                   16
+#define AI_BATCH_SIZE                     8        // Candidates a thread takes at once
+#define AI_GENERATION_SIZE              256        // Candidates of each refining generation
+#define AI_MAX_CANDIDATES              1024        // Largest generation (the first grid)
+
+#define AI_MIN_ANGLE                      5
+#define AI_MAX_ANGLE                     85
+#define AI_ANGLE_STEP                     5        // Grid angle step (degrees)
+#define AI_MIN_POWER                     40
+#define AI_MAX_POWER                   1000
+#define AI_MAX_POWER_STEPS               49        // Grid power steps, fewer on small budgets
+
+#define AI_MISS_PENALTY             1000.0f        // Added to the score of shells leaving the screen
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct Candidate {
+    int angle;
+    int power;
+    float score;                    // Distance from the impact to the closest enemy, 0: hit
+} Candidate;
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static const AIConfig levelConfig[AI_LEVEL_COUNT] = {
+    { 0.001f,   300, 6, 10 },       // AI_EASY
+    { 0.003f,  3000, 2,  4 },       // AI_MEDIUM
+    { 0.005f, 50000, 0,  0 },       // AI_HARD
+};
+
+static const char *levelName[AI_LEVEL_COUNT] = { "EASY", "MEDIUM", "HARD" };
+
+static Candidate candidate[AI_MAX_CANDIDATES] = { 0 };
+
+// Current job, shared with the workers
+static const Game *jobGame = NULL;
+static int jobCount = 0;
+static int jobNext = 0;             // Next candidate to take
+static double jobDeadline = 0.0;
+
+#if !defined(AI_NO_THREADS)
+static pthread_t worker[AI_MAX_WORKERS];
+static int workerCount = 0;
+static int busyWorkers = 0;
+static unsigned int jobSerial = 0;
+static bool quitWorkers = false;
+
+static pthread_mutex_t jobLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobReady = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t jobDone = PTHREAD_COND_INITIALIZER;
+#endif
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static Candidate SearchShot(const Game *game, AIConfig config, Candidate *list, bool threaded);
+static void AimShot(Candidate best, int angleError, int powerError, int *angle, int *power);
+static int FillGrid(Candidate *list, int maxCandidates);
+static int FillAround(Candidate *list, Candidate best, int generation);
+static void RunGeneration(const Game *game, int count, double deadline);
+static void RunBatches(void);
+static void ScoreCandidates(const Game *game, Candidate *list, int first, int last);
+static float ScoreShot(const Game *game, ShellEvent event, Vector2 impactPoint, int hitIndex);
+static int NextRandom(unsigned int *state, int min, int max);
+
+#if !defined(AI_NO_THREADS)
+static void *WorkerThread(void *arg);
+#endif
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void InitAI(int workers)
+{
+#if !defined(AI_NO_THREADS)
+    if (workers <= 0) workers = GetProcessorCount();
+
+    workers--;                      // The calling thread searches too
+    if (workers > AI_MAX_WORKERS) workers = AI_MAX_WORKERS;
+
+    quitWorkers = false;
+    workerCount = 0;
+
+    for (int i = 0; i < workers; i++)
+    {
+        if (pthread_create(&worker[workerCount], NULL, WorkerThread, NULL) == 0) workerCount++;
+    }
+#endif
+}
+
+void CloseAI(void)
+{
+#if !defined(AI_NO_THREADS)
+    pthread_mutex_lock(&jobLock);
+    quitWorkers = true;
+    pthread_cond_broadcast(&jobReady);
+    pthread_mutex_unlock(&jobLock);
+
+    for (int i = 0; i < workerCount; i++) pthread_join(worker[i], NULL);
+
+    workerCount = 0;
+#endif
+}
+
+AIConfig GetAIConfig(AILevel level)
+{
+    if ((level < 0) || (level >= AI_LEVEL_COUNT)) level = AI_MEDIUM;
+
+    return levelConfig[level];
+}
+
+const char *GetAILevelName(AILevel level)
+{
+    if ((level < 0) || (level >= AI_LEVEL_COUNT)) return "";
+
+    return levelName[level];
+}
+
+bool AIChooseShot(const Game *game, AIConfig config, int *angle, int *power)
+{
+    Candidate best = SearchShot(game, config, candidate, true);
+
+    // Aim noise, so the easy levels miss like humans do
+    int angleError = GetRandomValue(-config.angleNoise, config.angleNoise);
+    int powerError = GetRandomValue(-config.powerNoise, config.powerNoise);
+
+    AimShot(best, angleError, powerError, angle, power);
+
+    return (best.score == 0.0f);
+}
+
+bool AIChooseShotLocal(const Game *game, AIConfig config, unsigned int *randomState, int *angle, int *power)
+{
+    Candidate list[AI_MAX_CANDIDATES];
+    Candidate best = SearchShot(game, config, list, false);
+    int angleError = NextRandom(randomState, -config.angleNoise, config.angleNoise);
+    int powerError = NextRandom(randomState, -config.powerNoise, config.powerNoise);
+
+    AimShot(best, angleError, powerError, angle, power);
+
+    return (best.score == 0.0f);
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+// Best candidate of the generations, threaded: list is candidate[] and the workers help, else the calling thread alone
+static Candidate SearchShot(const Game *game, AIConfig config, Candidate *list, bool threaded)
+{
+    double deadline = (config.timeBudget > 0.0f) ? GetTime() + config.timeBudget : 0.0;
+    Candidate best = { 45, 300, INFINITY };
+    int evaluated = 0;
+
+    for (int generation = 0; evaluated < config.maxCandidates; generation++)
+    {
+        int count = (generation == 0) ? FillGrid(list, config.maxCandidates) : FillAround(list, best, generation);
+
+        if (count > config.maxCandidates - evaluated) count = config.maxCandidates - evaluated;
+
+        if (threaded) RunGeneration(game, count, deadline);
+        else
+        {
+            for (int i = 0; i < count; i++) list[i].score = INFINITY;
+
+            for (int first = 0; first < count; first += AI_BATCH_SIZE)
+            {
+                if ((deadline > 0.0) && (GetTime() >= deadline)) break;
+
+                ScoreCandidates(game, list, first, (first + AI_BATCH_SIZE < count) ? first + AI_BATCH_SIZE : count);
+            }
+        }
+
+        evaluated += count;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (list[i].score < best.score) best = list[i];
+        }
+
+        if (best.score == 0.0f) break;                                  // Found a hit
+        if ((deadline > 0.0) && (GetTime() >= deadline)) break;         // Out of time
+    }
+
+    return best;
+}
+
+static void AimShot(Candidate best, int angleError, int powerError, int *angle, int *power)
+{
+    *angle = best.angle + angleError;
+    *power = best.power*(100 + powerError)/100;
+
+    if (*angle < 0) *angle = 0;
+    if (*angle > 90) *angle = 90;
+    if (*power < 1) *power = 1;
+}
+
+// First generation: every angle step, with as many power steps as the budget allows
+static int FillGrid(Candidate *list, int maxCandidates)
+{
+    int angleSteps = (AI_MAX_ANGLE - AI_MIN_ANGLE)/AI_ANGLE_STEP + 1;
+    int powerSteps = maxCandidates/2/angleSteps;
+
+    if (powerSteps < 4) powerSteps = 4;
+    if (powerSteps > AI_MAX_POWER_STEPS) powerSteps = AI_MAX_POWER_STEPS;
+
+    int count = 0;
+
+    for (int a = 0; a < angleSteps; a++)
+    {
+        for (int p = 0; p < powerSteps; p++)
+        {
+            list[count].angle = AI_MIN_ANGLE + a*AI_ANGLE_STEP;
+            list[count].power = AI_MIN_POWER + p*(AI_MAX_POWER - AI_MIN_POWER)/(powerSteps - 1);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+// Next generations: random shots around the best one, the spread shrinks each generation
+static int FillAround(Candidate *list, Candidate best, int generation)
+{
+    unsigned int state = 2654435761u*(unsigned int)generation;
+    float shrink = powf(0.6f, (float)(generation - 1));
+    int angleSpread = (int)(6*shrink + 0.5f);
+    int powerSpread = (int)(15*shrink + 0.5f);
+
+    if (angleSpread < 1) angleSpread = 1;
+    if (powerSpread < 1) powerSpread = 1;
+
+    for (int i = 0; i < AI_GENERATION_SIZE; i++)
+    {
+        list[i].angle = best.angle + NextRandom(&state, -angleSpread, angleSpread);
+        list[i].power = best.power*(100 + NextRandom(&state, -powerSpread, powerSpread))/100;
+
+        if (list[i].angle < 1) list[i].angle = 1;
+        if (list[i].angle > 89) list[i].angle = 89;
+        if (list[i].power < AI_MIN_POWER) list[i].power = AI_MIN_POWER;
+    }
+
+    return AI_GENERATION_SIZE;
+}
+
+// Evaluate candidate[0..count-1] on every thread, returns when all of them are done
+static void RunGeneration(const Game *game, int count, double deadline)
+{
+    // Candidates skipped because of the deadline keep an infinite score
+    for (int i = 0; i < count; i++) candidate[i].score = INFINITY;
+
+#if !defined(AI_NO_THREADS)
+    pthread_mutex_lock(&jobLock);
+#endif
+
+    jobGame = game;
+    jobCount = count;
+    jobNext = 0;
+    jobDeadline = deadline;
+
+#if !defined(AI_NO_THREADS)
+    jobSerial++;
+    pthread_cond_broadcast(&jobReady);
+    pthread_mutex_unlock(&jobLock);
+#endif
+
+    RunBatches();
+
+#if !defined(AI_NO_THREADS)
+    pthread_mutex_lock(&jobLock);
+    while (busyWorkers > 0) pthread_cond_wait(&jobDone, &jobLock);
+    jobGame = NULL;
+    pthread_mutex_unlock(&jobLock);
+#endif
+}
+
+// Take batches of candidates until none is left or the deadline has passed
+static void RunBatches(void)
+{
+    while (true)
+    {
+#if !defined(AI_NO_THREADS)
+        pthread_mutex_lock(&jobLock);
+#endif
+        if ((jobDeadline > 0.0) && (GetTime() >= jobDeadline)) jobNext = jobCount;
+
+        int first = jobNext;
+        int last = first + AI_BATCH_SIZE;
+
+        if (last > jobCount) last = jobCount;
+        jobNext = last;
+
+        const Game *game = jobGame;
+#if !defined(AI_NO_THREADS)
+        pthread_mutex_unlock(&jobLock);
+#endif
+
+        if (first >= last) break;
+
+        ScoreCandidates(game, candidate, first, last);
+    }
+}
+
+static void ScoreCandidates(const Game *game, Candidate *list, int first, int last)
+{
+    for (int i = first; i < last; i++)
+    {
+        Vector2 impactPoint = { 0 };
+        int hitIndex = -1;
+        ShellEvent event = SimulateShot(game, list[i].angle, list[i].power, &impactPoint, &hitIndex);
+
+        list[i].score = ScoreShot(game, event, impactPoint, hitIndex);
+    }
+}
+
+// Distance from where the shell lands to the closest enemy tank, 0 when it hits one
+static float ScoreShot(const Game *game, ShellEvent event, Vector2 impactPoint, int hitIndex)
+{
+    const Player *shooter = &game->player[game->playerTurn];
+    float score = INFINITY;
+
+    if ((event == SHELL_HIT_PLAYER) && (game->player[hitIndex].isLeftTeam != shooter->isLeftTeam)) return 0.0f;
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Player *target = &game->player[i];
+
+        if (!target->isAlive || (target->isLeftTeam == shooter->isLeftTeam)) continue;
+
+        float distance = hypotf(impactPoint.x - target->position.x, impactPoint.y - target->position.y);
+
+        if (distance < score) score = distance;
+    }
+
+    if ((event == SHELL_MISSED) || (event == SHELL_NONE)) score += AI_MISS_PENALTY;
+    if (event == SHELL_HIT_PLAYER) score += AI_MISS_PENALTY;         // Friendly fire
+
+    return score;
+}
+
+// Xorshift, thread-safe and independent from GetRandomValue()
+static int NextRandom(unsigned int *state, int min, int max)
+{
+    unsigned int x = *state ? *state : 0x9e3779b9u;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return min + (int)(x%(unsigned int)(max - min + 1));
+}
+
+#if !defined(AI_NO_THREADS)
+static void *WorkerThread(void *arg)
+{
+    (void)arg;                      // Workers are all alike, the batches hand out the work
+    unsigned int seenSerial = 0;
+
+    pthread_mutex_lock(&jobLock);
+
+    while (true)
+    {
+        while (!quitWorkers && (jobSerial == seenSerial)) pthread_cond_wait(&jobReady, &jobLock);
+
+        if (quitWorkers) break;
+
+        seenSerial = jobSerial;
+
+        if (jobGame == NULL) continue;          // Woke up after the job was over
+
+        busyWorkers++;
+        pthread_mutex_unlock(&jobLock);
+
+        RunBatches();
+
+        pthread_mutex_lock(&jobLock);
+        busyWorkers--;
+        if (busyWorkers == 0) pthread_cond_signal(&jobDone);
+    }
+
+    pthread_mutex_unlock(&jobLock);
+
+    return NULL;
+}
+#endif
@@ -0,0 +1,44 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - computer opponent
+*
+*   The AI simulates many candidate shots against the current terrain with SimulateShot(),
+*   the same shell physics the players get, and fires the one landing closest to an enemy.
+*   Candidates are evaluated in batches by a pool of worker threads, and the search stops
+*   when its time budget runs out so the 60 FPS loop never stalls.
+*
+********************************************************************************************/
+
+#ifndef AI_H
+#define AI_H
+
+#include "game.h"
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum AILevel {
+    AI_EASY = 0,
+    AI_MEDIUM,
+    AI_HARD,
+    AI_LEVEL_COUNT
+} AILevel;
+
+typedef struct AIConfig {
+    float timeBudget;               // Seconds the search may take, 0: no limit (deterministic search)
+    int maxCandidates;              // Shots simulated at most
+    int angleNoise;                 // Random error added to the chosen angle (degrees)
+    int powerNoise;                 // Random error added to the chosen power (% of the power)
+} AIConfig;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void InitAI(int workers);                                                   // Start the worker threads, 0: one per processor
+void CloseAI(void);                                                         // Stop the worker threads
+AIConfig GetAIConfig(AILevel level);                                        // Search budget and aim noise of a difficulty level
+const char *GetAILevelName(AILevel level);
+bool AIChooseShot(const Game *game, AIConfig config, int *angle, int *power);   // Aim for the current player, returns true if the shot found hits
+bool AIChooseShotLocal(const Game *game, AIConfig config, unsigned int *randomState, int *angle, int *power);   // Same search on the calling thread only, reentrant, aim noise from randomState
+
+#endif // AI_H
@@ -0,0 +1,43 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - embedded assets
+*
+*   The files of the resources directory, converted at build time by packassets (make) into
+*   assetdata.c and linked into the game: images as R8G8B8A8 pixels, ready to be uploaded,
+*   sounds as PCM samples, other files (the music) as they are. Nothing is decoded nor read
+*   from the disk at startup, wherever the game is started from.
+*
+********************************************************************************************/
+
+#ifndef ASSETDATA_H
+#define ASSETDATA_H
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum EmbeddedKind {
+    EMBEDDED_FILE = 0,              // Bytes of the file
+    EMBEDDED_IMAGE,                 // R8G8B8A8 pixels, row after row
+    EMBEDDED_WAVE                   // PCM samples, interleaved
+} EmbeddedKind;
+
+typedef struct EmbeddedAsset {
+    const char *fileName;           // Name in the resources directory
+    EmbeddedKind kind;
+    const unsigned char *data;
+    unsigned int size;              // Bytes of data
+    int width;                      // Images
+    int height;
+    int sampleCount;                // Waves: samples of each channel (raylib 2.5 Wave.sampleCount)
+    int sampleRate;
+    int sampleSize;                 // Bits
+    int channels;
+} EmbeddedAsset;
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+extern const EmbeddedAsset embeddedAssets[];    // Defined in the generated assetdata.c
+extern const int embeddedAssetCount;
+
+#endif // ASSETDATA_H
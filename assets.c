@@ -0,0 +1,260 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - assets
+*
+*   The atlas is packed in rows at load time from the separate sprite files, so the
+*   sprites can still be edited one by one. Sprites never overlap and the atlas is blank
+*   around them, so they are copied in row by row instead of blended with ImageDraw().
+*   The pixels of the tank sprites also give the collision masks of the tanks (tankmask.h).
+*
+********************************************************************************************/
+
+#include "assets.h"
+#include "assetdata.h"          // Only linked with ASSETS_EMBEDDED, assetdata.c is generated by packassets
+#include "tankmask.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    // NOTE: Declared here instead of including windows.h, its Rectangle() function clashes with the Rectangle type
+    __declspec(dllimport) unsigned long __stdcall GetModuleFileNameA(void *hModule, char *lpFilename, unsigned long nSize);
+#elif defined(__APPLE__)
+    #include <mach-o/dyld.h>
+#elif defined(__linux__)
+    #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define MAX_ASSET_PATH_LENGTH         1024
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static const char *spriteFiles[SPRITE_COUNT] = { "TankBleu.png", "TankRouge.png" };
+static const char *soundFiles[SOUND_COUNT] = { "boom.wav" };
+static const char *musicFiles[MUSIC_COUNT] = { "soundtrack.mp3" };
+
+static Texture2D atlas = { 0 };
+static Rectangle spriteRec[SPRITE_COUNT] = { 0 };
+static Wave waves[SOUND_COUNT] = { 0 };
+
+static char executableDirectory[MAX_ASSET_PATH_LENGTH] = { 0 };
+static char assetPath[MAX_ASSET_PATH_LENGTH] = { 0 };
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void LoadAtlas(void);
+static Image LoadSpriteImage(SpriteId sprite, bool *embedded);
+static Wave LoadSoundWave(SoundId sound);
+static const EmbeddedAsset *FindEmbeddedAsset(const char *fileName);
+static void InitExecutableDirectory(void);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void LoadAssets(void)
+{
+    InitExecutableDirectory();
+
+    LoadAtlas();
+
+    for (int i = 0; i < SOUND_COUNT; i++) waves[i] = LoadSoundWave(i);
+}
+
+void UnloadAssets(void)
+{
+    UnloadTexture(atlas);
+
+    for (int i = 0; i < SOUND_COUNT; i++) UnloadWave(waves[i]);
+
+    atlas = (Texture2D){ 0 };
+}
+
+// NOTE: The returned string is only valid until the next call
+const char *GetAssetPath(const char *fileName)
+{
+    snprintf(assetPath, MAX_ASSET_PATH_LENGTH, "%s%s/%s", executableDirectory, ASSETS_DIRECTORY, fileName);
+
+    if ((executableDirectory[0] != '\0') && !FileExists(assetPath))
+    {
+        snprintf(assetPath, MAX_ASSET_PATH_LENGTH, "%s/%s", ASSETS_DIRECTORY, fileName);      // Working directory
+    }
+
+    return assetPath;
+}
+
+Rectangle GetSpriteRec(SpriteId sprite)
+{
+    return spriteRec[sprite];
+}
+
+void DrawSprite(SpriteId sprite, Vector2 position, Color tint)
+{
+    DrawTextureRec(atlas, spriteRec[sprite], position, tint);
+}
+
+Wave GetWave(SoundId sound)
+{
+    return waves[sound];
+}
+
+const char *GetMusicPath(MusicId music)
+{
+    return GetAssetPath(musicFiles[music]);
+}
+
+bool GetMusicData(MusicId music, const unsigned char **data, unsigned int *size)
+{
+    const EmbeddedAsset *asset = FindEmbeddedAsset(musicFiles[music]);
+
+    if (asset == NULL) return false;
+
+    *data = asset->data;
+    *size = asset->size;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+// Pack the sprites in rows into one texture
+static void LoadAtlas(void)
+{
+    Image image[SPRITE_COUNT] = { 0 };
+    bool embedded[SPRITE_COUNT] = { 0 };
+    int x = 0;
+    int y = 0;
+    int rowHeight = 0;
+
+    for (int i = 0; i < SPRITE_COUNT; i++)
+    {
+        image[i] = LoadSpriteImage(i, &embedded[i]);
+
+        int width = image[i].width + 2*ATLAS_PADDING;
+        int height = image[i].height + 2*ATLAS_PADDING;
+
+        if (x + width > ATLAS_WIDTH)
+        {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+
+        spriteRec[i] = (Rectangle){ x + ATLAS_PADDING, y + ATLAS_PADDING, image[i].width, image[i].height };
+
+        x += width;
+        if (height > rowHeight) rowHeight = height;
+    }
+
+    // Power of two height, for older GPUs
+    int atlasHeight = 1;
+    while (atlasHeight < y + rowHeight) atlasHeight *= 2;
+
+    Image atlasImage = GenImageColor(ATLAS_WIDTH, atlasHeight, BLANK);
+
+    for (int i = 0; i < SPRITE_COUNT; i++)
+    {
+        for (int row = 0; row < image[i].height; row++)
+        {
+            unsigned char *destination = (unsigned char *)atlasImage.data + (((int)spriteRec[i].y + row)*ATLAS_WIDTH + (int)spriteRec[i].x)*4;
+
+            memcpy(destination, (unsigned char *)image[i].data + row*image[i].width*4, image[i].width*4);
+        }
+
+        if (((i == SPRITE_TANK_BLUE) || (i == SPRITE_TANK_RED)) && (image[i].data != NULL))
+        {
+            TankMask mask = { 0 };
+
+            BuildTankMask(&mask, (const unsigned char *)image[i].data, image[i].width, image[i].height);
+            SetTankMask(i == SPRITE_TANK_BLUE, &mask);
+        }
+
+        if (!embedded[i]) UnloadImage(image[i]);
+    }
+
+    atlas = LoadTextureFromImage(atlasImage);
+    UnloadImage(atlasImage);
+}
+
+// Pixels of a sprite in R8G8B8A8: the embedded ones are used in place, without a copy
+static Image LoadSpriteImage(SpriteId sprite, bool *embedded)
+{
+    const EmbeddedAsset *asset = FindEmbeddedAsset(spriteFiles[sprite]);
+
+    *embedded = (asset != NULL) && (asset->kind == EMBEDDED_IMAGE);
+
+    if (*embedded) return (Image){ (void *)asset->data, asset->width, asset->height, 1, UNCOMPRESSED_R8G8B8A8 };
+
+    Image image = LoadImage(GetAssetPath(spriteFiles[sprite]));
+    if (image.data != NULL) ImageFormat(&image, UNCOMPRESSED_R8G8B8A8);
+
+    return image;
+}
+
+// Decoded samples of a sound, UnloadWave() frees them whichever way they came
+static Wave LoadSoundWave(SoundId sound)
+{
+    const EmbeddedAsset *asset = FindEmbeddedAsset(soundFiles[sound]);
+
+    // NOTE: LoadWaveEx() works on a copy of the samples
+    if ((asset != NULL) && (asset->kind == EMBEDDED_WAVE)) return LoadWaveEx((void *)asset->data, asset->sampleCount, asset->sampleRate, asset->sampleSize, asset->channels);
+
+    return LoadWave(GetAssetPath(soundFiles[sound]));
+}
+
+// Asset of the resources directory linked into the game, NULL if none
+static const EmbeddedAsset *FindEmbeddedAsset(const char *fileName)
+{
+#if defined(ASSETS_EMBEDDED)
+    for (int i = 0; i < embeddedAssetCount; i++)
+    {
+        if (strcmp(embeddedAssets[i].fileName, fileName) == 0) return &embeddedAssets[i];
+    }
+#else
+    (void)fileName;
+#endif
+
+    return NULL;
+}
+
+// Directory of the running executable with a trailing separator, empty if unknown
+static void InitExecutableDirectory(void)
+{
+    char path[MAX_ASSET_PATH_LENGTH] = { 0 };
+    bool found = false;
+
+#if defined(_WIN32)
+    unsigned long length = GetModuleFileNameA(NULL, path, MAX_ASSET_PATH_LENGTH);
+    found = (length > 0) && (length < MAX_ASSET_PATH_LENGTH);
+#elif defined(__APPLE__)
+    uint32_t size = MAX_ASSET_PATH_LENGTH;
+    found = (_NSGetExecutablePath(path, &size) == 0);
+#elif defined(__linux__)
+    ssize_t length = readlink("/proc/self/exe", path, MAX_ASSET_PATH_LENGTH - 1);
+    found = (length > 0);
+    if (found) path[length] = '\0';
+#endif
+
+    executableDirectory[0] = '\0';
+
+    if (found)
+    {
+        // Cut after the last separator
+        char *separator = strrchr(path, '/');
+        char *backslash = strrchr(path, '\\');
+
+        if ((separator == NULL) || ((backslash != NULL) && (backslash > separator))) separator = backslash;
+
+        if (separator != NULL)
+        {
+            separator[1] = '\0';
+            strcpy(executableDirectory, path);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - assets
+*
+*   Every texture and sound is loaded once by LoadAssets() and handed out by id until
+*   UnloadAssets(), so restarting a round or a match loads nothing. Sounds are kept decoded
+*   (the voices of audio.c are made from them), musics are streamed from their file.
+*   The tank sprites are packed into one atlas texture: drawing them does not switch
+*   textures and the draws batch. Only the sprites the game draws are loaded, the other
+*   pictures of resources/ are not part of it.
+*
+*   Built with ASSETS_EMBEDDED (make EMBED_ASSETS=TRUE, the default), the assets are linked
+*   into the game already decoded (assetdata.h) and no file is opened. Otherwise, or for an
+*   asset missing from the build, paths are resolved next to the executable first, then in
+*   the working directory, so the game starts from any folder.
+*
+********************************************************************************************/
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "raylib.h"
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define ASSETS_DIRECTORY        "resources"
+#define ATLAS_WIDTH                   1024        // Sprites are packed in rows, the height is what the rows need
+#define ATLAS_PADDING                    2        // Empty pixels around each sprite, so filtering does not bleed
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum SpriteId {
+    SPRITE_TANK_BLUE = 0,
+    SPRITE_TANK_RED,
+    SPRITE_COUNT
+} SpriteId;
+
+typedef enum SoundId {
+    SOUND_BOOM = 0,
+    SOUND_COUNT
+} SoundId;
+
+typedef enum MusicId {
+    MUSIC_SOUNDTRACK = 0,
+    MUSIC_COUNT
+} MusicId;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void LoadAssets(void);                                                  // Load every asset, the window must be ready
+void UnloadAssets(void);
+const char *GetAssetPath(const char *fileName);                         // Path of a file of the resources directory
+
+Rectangle GetSpriteRec(SpriteId sprite);                                // Sprite rectangle in the atlas
+void DrawSprite(SpriteId sprite, Vector2 position, Color tint);        // Draw a sprite, position is its top-left corner
+Wave GetWave(SoundId sound);                                            // Decoded samples of a sound
+const char *GetMusicPath(MusicId music);                                // Same lifetime as GetAssetPath()
+bool GetMusicData(MusicId music, const unsigned char **data, unsigned int *size);  // Music file linked into the game, false: read it from GetMusicPath()
+
+#endif // ASSETS_H
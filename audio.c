@@ -0,0 +1,266 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - audio
+*
+*   The ring buffer has one producer (the audio thread, decoding) and one consumer (the main
+*   thread, feeding the stream): each side only writes its own counter, published with
+*   release/acquire atomics, so neither ever waits for the other.
+*
+*   NOTE: The mp3 is decoded with dr_mp3, the decoder raylib itself is built with: its
+*   functions come from libraylib, only its header is included here. The dr_mp3 of raylib 2.5
+*   only decodes to 32-bit float, so the ring and the stream are 32-bit, as raylib streams
+*   its own mp3 music.
+*
+********************************************************************************************/
+
+#include "audio.h"
+
+#include "dr_mp3.h"             // Found in raylib src/external, implemented in libraylib
+
+#include <stddef.h>
+
+#if defined(PLATFORM_WEB) && !defined(AUDIO_NO_THREADS)
+    #define AUDIO_NO_THREADS            // Emscripten builds are single threaded, the music is decoded in UpdateAudio()
+#endif
+
+#if !defined(AUDIO_NO_THREADS)
+    #include <pthread.h>
+    #if defined(_WIN32)
+        // NOTE: Declared here instead of including windows.h, its Rectangle() function clashes with the Rectangle type
+        __declspec(dllimport) void __stdcall Sleep(unsigned long dwMilliseconds);
+    #else
+        #include <time.h>
+    #endif
+#endif
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define MUSIC_MAX_CHANNELS                2
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static Sound voice[SOUND_COUNT][MAX_VOICES] = { 0 };
+static unsigned int voiceStart[SOUND_COUNT][MAX_VOICES] = { 0 };   // Serial of the last start, the lowest is the oldest
+static unsigned int voiceSerial = 0;
+static int voiceCount = 0;                      // Voices of each sound
+
+static drmp3 decoder = { 0 };
+static AudioStream musicStream = { 0 };
+static bool musicPlaying = false;
+static unsigned int musicChannels = 0;
+
+// Decoded frames, MUSIC_RING_FRAMES is a multiple of MUSIC_CHUNK_FRAMES so a chunk never wraps around
+static float musicRing[MUSIC_RING_FRAMES*MUSIC_MAX_CHANNELS] = { 0 };
+static unsigned int ringWrite = 0;              // Frames decoded so far, written by the audio thread only
+static unsigned int ringRead = 0;               // Frames handed to the stream so far, written by the main thread only
+
+#if !defined(AUDIO_NO_THREADS)
+static pthread_t musicThread;
+static bool quitMusic = false;
+#endif
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static int DecodeMusic(void);
+
+#if !defined(AUDIO_NO_THREADS)
+static void *MusicThread(void *arg);
+#endif
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void InitAudio(int polyphony)
+{
+    if (polyphony < 1) polyphony = 1;
+    if (polyphony > MAX_VOICES) polyphony = MAX_VOICES;
+
+    voiceCount = polyphony;
+    voiceSerial = 0;
+
+    for (int i = 0; i < SOUND_COUNT; i++)
+    {
+        for (int j = 0; j < voiceCount; j++)
+        {
+            voice[i][j] = LoadSoundFromWave(GetWave(i));
+            voiceStart[i][j] = 0;
+        }
+    }
+}
+
+void CloseAudio(void)
+{
+    StopMusic();
+
+    for (int i = 0; i < SOUND_COUNT; i++)
+    {
+        for (int j = 0; j < voiceCount; j++) UnloadSound(voice[i][j]);
+    }
+
+    voiceCount = 0;
+}
+
+void PlayVoice(SoundId sound)
+{
+    if (voiceCount == 0) return;
+
+    int chosen = 0;
+
+    for (int i = 0; i < voiceCount; i++)
+    {
+        if (!IsSoundPlaying(voice[sound][i]))
+        {
+            chosen = i;
+            break;
+        }
+
+        if (voiceStart[sound][i] < voiceStart[sound][chosen]) chosen = i;
+    }
+
+    StopSound(voice[sound][chosen]);
+    PlaySound(voice[sound][chosen]);
+    voiceStart[sound][chosen] = ++voiceSerial;
+}
+
+void PlayMusic(MusicId music)
+{
+    StopMusic();
+
+    const unsigned char *data = NULL;
+    unsigned int size = 0;
+    bool opened = false;
+
+    // Decoded straight from the game binary when it was linked in
+    if (GetMusicData(music, &data, &size)) opened = drmp3_init_memory(&decoder, data, size, NULL);
+    else opened = drmp3_init_file(&decoder, GetMusicPath(music), NULL);
+
+    if (!opened)
+    {
+        TraceLog(LOG_WARNING, "Music %s could not be opened", GetMusicPath(music));
+        return;
+    }
+
+    if ((decoder.channels < 1) || (decoder.channels > MUSIC_MAX_CHANNELS))
+    {
+        TraceLog(LOG_WARNING, "Music %s has %i channels, not played", GetMusicPath(music), (int)decoder.channels);
+        drmp3_uninit(&decoder);
+        return;
+    }
+
+    musicChannels = decoder.channels;
+    musicStream = InitAudioStream(decoder.sampleRate, 32, musicChannels);
+    ringWrite = 0;
+    ringRead = 0;
+
+    // The first chunks are decoded here, so the stream starts full
+    for (int i = 0; i < 2*MUSIC_CHUNK_FRAMES/MUSIC_DECODE_FRAMES; i++) DecodeMusic();
+
+    musicPlaying = true;
+
+#if !defined(AUDIO_NO_THREADS)
+    quitMusic = false;
+
+    if (pthread_create(&musicThread, NULL, MusicThread, NULL) != 0)
+    {
+        TraceLog(LOG_WARNING, "Audio thread could not be started, no music");
+        CloseAudioStream(musicStream);
+        drmp3_uninit(&decoder);
+        musicPlaying = false;
+        return;
+    }
+#endif
+
+    PlayAudioStream(musicStream);
+}
+
+void StopMusic(void)
+{
+    if (!musicPlaying) return;
+
+#if !defined(AUDIO_NO_THREADS)
+    __atomic_store_n(&quitMusic, true, __ATOMIC_RELEASE);
+    pthread_join(musicThread, NULL);
+#endif
+
+    StopAudioStream(musicStream);
+    CloseAudioStream(musicStream);
+    drmp3_uninit(&decoder);
+
+    musicPlaying = false;
+}
+
+// NOTE: No decoding here (unless single threaded), only a copy of the decoded samples per free stream buffer
+void UpdateAudio(void)
+{
+    if (!musicPlaying) return;
+
+#if defined(AUDIO_NO_THREADS)
+    while (DecodeMusic() > 0) { }
+#endif
+
+    while (IsAudioStreamProcessed(musicStream))
+    {
+        unsigned int read = ringRead;
+        unsigned int written = __atomic_load_n(&ringWrite, __ATOMIC_ACQUIRE);
+
+        if (written - read < MUSIC_CHUNK_FRAMES) break;        // The decoder is behind, the stream plays what it has
+
+        UpdateAudioStream(musicStream, musicRing + (read%MUSIC_RING_FRAMES)*musicChannels, MUSIC_CHUNK_FRAMES*musicChannels);
+
+        __atomic_store_n(&ringRead, read + MUSIC_CHUNK_FRAMES, __ATOMIC_RELEASE);
+    }
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+// Decode into the free part of the ring, rewinds at the end of the music, returns the frames decoded
+static int DecodeMusic(void)
+{
+    unsigned int write = ringWrite;
+    unsigned int read = __atomic_load_n(&ringRead, __ATOMIC_ACQUIRE);
+    unsigned int offset = write%MUSIC_RING_FRAMES;
+    unsigned int frames = MUSIC_RING_FRAMES - (write - read);
+
+    if (frames > MUSIC_RING_FRAMES - offset) frames = MUSIC_RING_FRAMES - offset;       // Up to the end of the ring, the rest on the next call
+    if (frames > MUSIC_DECODE_FRAMES) frames = MUSIC_DECODE_FRAMES;
+    if (frames == 0) return 0;
+
+    unsigned int decoded = (unsigned int)drmp3_read_pcm_frames_f32(&decoder, frames, musicRing + offset*musicChannels);
+
+    if (decoded == 0)
+    {
+        drmp3_seek_to_pcm_frame(&decoder, 0);           // Loop, the next call decodes the start again
+        return 0;
+    }
+
+    __atomic_store_n(&ringWrite, write + decoded, __ATOMIC_RELEASE);
+
+    return (int)decoded;
+}
+
+#if !defined(AUDIO_NO_THREADS)
+static void *MusicThread(void *arg)
+{
+    (void)arg;                      // A single music thread, its state is in the module
+
+    while (!__atomic_load_n(&quitMusic, __ATOMIC_ACQUIRE))
+    {
+        if (DecodeMusic() > 0) continue;
+
+        // Ring full (or rewinding): the main thread drains a chunk every ~90 ms
+    #if defined(_WIN32)
+        Sleep(MUSIC_DECODE_SLEEP);
+    #else
+        struct timespec delay = { 0, MUSIC_DECODE_SLEEP*1000000L };
+        nanosleep(&delay, NULL);
+    #endif
+    }
+
+    return NULL;
+}
+#endif
@@ -0,0 +1,41 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - audio
+*
+*   The soundtrack is decoded on a dedicated thread into a lock-free ring buffer: the main
+*   thread only copies decoded samples into the audio stream, so mp3 decoding never shows
+*   up in the frame time.
+*   Sound effects play from a pool of voices made from the pre-decoded sound: each voice is
+*   its own copy of the samples, so several explosions play at once instead of restarting
+*   the same sound. When every voice is busy, the one started first is taken over.
+*
+********************************************************************************************/
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include "raylib.h"
+#include "assets.h"
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define MAX_VOICES                       32        // Voices of each sound, at most
+#define DEFAULT_VOICES                    8        // Same sound playing at once
+
+#define MUSIC_CHUNK_FRAMES             4096        // Frames handed to the audio stream at once (raylib stream sub-buffer)
+#define MUSIC_RING_FRAMES             65536        // Decoded frames kept ahead (~1.5 s at 44.1 kHz), power of 2
+#define MUSIC_DECODE_FRAMES            4096        // Frames decoded at once by the audio thread
+#define MUSIC_DECODE_SLEEP               10        // ms the audio thread sleeps when the ring is full
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void InitAudio(int polyphony);                  // Create the voices of every sound, after LoadAssets(), polyphony: voices of each sound
+void CloseAudio(void);                          // Stop the music thread and free the voices, before UnloadAssets()
+void PlayVoice(SoundId sound);                  // Play a sound on a free voice, or on the oldest one
+void PlayMusic(MusicId music);                  // Start decoding a music on the audio thread, it loops
+void StopMusic(void);
+void UpdateAudio(void);                         // Call once per frame: hands decoded music to the audio stream
+
+#endif // AUDIO_H
@@ -0,0 +1,194 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - ballistics
+*
+*   x(t) = x0 + vx*t                (wind: + w*t^2/2)
+*   y(t) = y0 + vy*t + g*t^2/2      (screen y axis points down)
+*
+*   Air drag, with k the drag coefficient, V the terminal speed and phases in DRAG_TIME units:
+*   x(t) = x0 +- log(1 + k*|vx|*t)/k
+*   y(t) = topY - log(cos(phase - t/DRAG_TIME))/k           rising, vy = -V*tan(...)
+*   y(t) = topY + log(cosh((t - fallTime)/DRAG_TIME))/k     falling, vy = V*tanh(...)
+*
+********************************************************************************************/
+
+#include "game.h"
+#include "ballistics.h"
+
+#include <stdbool.h>
+
+#if defined(PLATFORM_WEB) && !defined(BALLISTICS_NO_THREADS)
+    #define BALLISTICS_NO_THREADS       // Emscripten builds are single threaded
+#endif
+
+#if !defined(BALLISTICS_NO_THREADS)
+    #include <pthread.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define DRAG_MAX_FALL_SPEED          0.999f        // Share of the terminal speed a shell launched going down is held to
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+float dragTable[DRAG_TABLE_COUNT][DRAG_TABLE_SIZE + 1] = { 0 };
+
+static bool dragTableReady = false;                     // Set once the tables are filled, read by every thread
+#if !defined(BALLISTICS_NO_THREADS)
+static pthread_mutex_t dragTableLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static const char *physicsName[PHYSICS_COUNT] = { "classic", "wind", "drag", "low-gravity", "bounce" };
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void InitDragTables(void);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+
+// Launch state of a shell fired from origin
+Trajectory LaunchTrajectory(Vector2 origin, int angle, int power, bool toTheRight, PhysicsMode physics, float wind)
+{
+    Trajectory trajectory = { 0 };
+
+    float direction = toTheRight ? 1.0f : -1.0f;
+    Vector2 velocity = { direction*cosf(angle*DEG2RAD)*power*SHELL_SPEED_SCALE, -sinf(angle*DEG2RAD)*power*SHELL_SPEED_SCALE };
+
+    trajectory.physics = physics;
+    trajectory.gravity = GetPhysicsGravity(physics);
+    trajectory.wind = (physics == PHYSICS_WIND) ? wind : 0.0f;
+
+    return ResumeTrajectory(trajectory, origin, velocity);
+}
+
+Trajectory ResumeTrajectory(Trajectory trajectory, Vector2 origin, Vector2 velocity)
+{
+    trajectory.origin = origin;
+    trajectory.velocity = velocity;
+
+    if (trajectory.physics == PHYSICS_DRAG)
+    {
+        InitDragTables();
+
+        float rise = fmaxf(-velocity.y, 0.0f)/PHYSICS_DRAG_SPEED;
+        float fall = fminf(fmaxf(velocity.y, 0.0f)/PHYSICS_DRAG_SPEED, DRAG_MAX_FALL_SPEED);
+        float fallPhase = atanhf(fall);
+
+        trajectory.decay = DRAG_COEFFICIENT*fabsf(velocity.x);
+        trajectory.phase = fminf(atanf(rise), DRAG_MAX_PHASE);
+        trajectory.topTime = trajectory.phase*DRAG_TIME;
+        trajectory.fallTime = trajectory.topTime - fallPhase*DRAG_TIME;
+
+        // From the tables, so the arc starts right at the origin
+        trajectory.topY = origin.y + (LookupDrag(DRAG_LOG_COS, trajectory.phase, DRAG_MAX_PHASE) - LookupDrag(DRAG_LOG_COSH, fallPhase, DRAG_MAX_FALL))/DRAG_COEFFICIENT;
+    }
+
+    return trajectory;
+}
+
+float GetPhysicsGravity(PhysicsMode physics)
+{
+    return (physics == PHYSICS_LOW_GRAVITY) ? SHELL_GRAVITY*PHYSICS_LOW_GRAVITY_SCALE : SHELL_GRAVITY;
+}
+
+const char *GetPhysicsName(PhysicsMode physics)
+{
+    if ((physics < 0) || (physics >= PHYSICS_COUNT)) return "unknown";
+
+    return physicsName[physics];
+}
+
+Vector2 TrajectoryPosition(Trajectory trajectory, float time)
+{
+    switch (trajectory.physics)
+    {
+        case PHYSICS_WIND: return ArcPosition(trajectory, time, PHYSICS_WIND);
+        case PHYSICS_DRAG: return ArcPosition(trajectory, time, PHYSICS_DRAG);
+        default: return ArcPosition(trajectory, time, PHYSICS_CLASSIC);
+    }
+}
+
+Vector2 TrajectoryVelocity(Trajectory trajectory, float time)
+{
+    switch (trajectory.physics)
+    {
+        case PHYSICS_WIND: return ArcVelocity(trajectory, time, PHYSICS_WIND);
+        case PHYSICS_DRAG: return ArcVelocity(trajectory, time, PHYSICS_DRAG);
+        default: return ArcVelocity(trajectory, time, PHYSICS_CLASSIC);
+    }
+}
+
+float TrajectoryTimeAtX(Trajectory trajectory, float x)
+{
+    switch (trajectory.physics)
+    {
+        case PHYSICS_WIND: return ArcTimeAtX(trajectory, x, PHYSICS_WIND);
+        case PHYSICS_DRAG: return ArcTimeAtX(trajectory, x, PHYSICS_DRAG);
+        default: return ArcTimeAtX(trajectory, x, PHYSICS_CLASSIC);
+    }
+}
+
+float TrajectoryTimeAtY(Trajectory trajectory, float y)
+{
+    switch (trajectory.physics)
+    {
+        case PHYSICS_DRAG: return ArcTimeAtY(trajectory, y, PHYSICS_DRAG);
+        default: return ArcTimeAtY(trajectory, y, PHYSICS_CLASSIC);
+    }
+}
+
+float TrajectoryNextTime(Trajectory trajectory, float time, float maxDistance)
+{
+    switch (trajectory.physics)
+    {
+        case PHYSICS_WIND: return ArcNextTime(trajectory, time, maxDistance, PHYSICS_WIND);
+        case PHYSICS_DRAG: return ArcNextTime(trajectory, time, maxDistance, PHYSICS_DRAG);
+        default: return ArcNextTime(trajectory, time, maxDistance, PHYSICS_CLASSIC);
+    }
+}
+
+float TrajectoryTopTime(Trajectory trajectory)
+{
+    if (trajectory.physics == PHYSICS_DRAG) return trajectory.topTime;
+
+    return -trajectory.velocity.y/trajectory.gravity;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+// Fill the drag tables the first time, whatever thread launches the first drag shell
+static void InitDragTables(void)
+{
+    if (__atomic_load_n(&dragTableReady, __ATOMIC_ACQUIRE)) return;
+
+#if !defined(BALLISTICS_NO_THREADS)
+    pthread_mutex_lock(&dragTableLock);
+#endif
+
+    if (!dragTableReady)
+    {
+        for (int i = 0; i <= DRAG_TABLE_SIZE; i++)
+        {
+            double rise = (double)DRAG_MAX_PHASE*i/DRAG_TABLE_SIZE;
+            double fall = (double)DRAG_MAX_FALL*i/DRAG_TABLE_SIZE;
+
+            dragTable[DRAG_LOG_COS][i] = (float)log(cos(rise));
+            dragTable[DRAG_TAN][i] = (float)tan(rise);
+            dragTable[DRAG_LOG_COSH][i] = (float)log(cosh(fall));
+            dragTable[DRAG_TANH][i] = (float)tanh(fall);
+        }
+
+        __atomic_store_n(&dragTableReady, true, __ATOMIC_RELEASE);
+    }
+
+#if !defined(BALLISTICS_NO_THREADS)
+    pthread_mutex_unlock(&dragTableLock);
+#endif
+}
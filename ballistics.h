@@ -0,0 +1,278 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - ballistics
+*
+*   Closed-form shell trajectories: the position at any flight time is computed from the
+*   launch state in O(1), so the simulation does not depend on the frame rate and can jump
+*   ahead to any point of the flight. Time is in seconds, distances in pixels.
+*
+*   The physics of a match (PhysicsMode) picks the integrator of its arcs: gravity alone, gravity
+*   and wind (constant accelerations), or gravity and air drag on each axis. Each is closed-form.
+*   The integrators are inline functions taking the physics as an argument: called with a
+*   constant, the compiler keeps only the code of that physics. So the flight loops of game.c
+*   are specialized, one copy per integrator picked once per flight, with no mode test or
+*   function pointer inside. The Trajectory*() functions below are the same integrators
+*   picked from the physics of the trajectory, for the code outside the hot loops.
+*
+*   Air drag is applied to each axis on its own (-k*vx*|vx| and -k*vy*|vy|): the arcs are then
+*   logarithms, tangents and hyperbolic functions of the flight time. The vertical ones are read
+*   from tables precomputed once (DRAG_TABLE_SIZE points each, linearly interpolated), the
+*   horizontal distance is log1pf() itself, so ArcTimeAtX() (expm1f()) is its exact inverse.
+*
+*   NOTE: This is not quadratic drag on the speed (-k*|v|*v), which couples the axes and has no
+*   closed form: a shell flying diagonally is slowed by k*sqrt(vx^4 + vy^4) instead of k*|v|^2,
+*   down to 71% of it at 45 degrees. The shells fly a little farther than in real air.
+*
+********************************************************************************************/
+
+#ifndef BALLISTICS_H
+#define BALLISTICS_H
+
+#if defined(GAME_HEADLESS)
+    #include "headless.h"
+#else
+    #include "raylib.h"
+#endif
+
+#include <math.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define SHELL_SPEED_SCALE                 3        // Launch speed (px/s) for one point of power
+#define SHELL_GRAVITY      (GRAVITY*DELTA_FPS)     // Downward acceleration (px/s^2), same arcs as the former 60 FPS Euler step
+
+#define BALLISTICS_MAX_STEP            2.0f        // Largest shell move (px) between two collision tests
+#define BALLISTICS_REFINE_STEPS           8        // Bisection steps to locate the exact contact time
+
+#define PHYSICS_LOW_GRAVITY_SCALE      0.4f        // Share of SHELL_GRAVITY in PHYSICS_LOW_GRAVITY
+#define PHYSICS_MAX_WIND                 60        // Strongest wind (px/s^2) of PHYSICS_WIND, each map draws its own
+#define PHYSICS_DRAG_SPEED          1500.0f        // Terminal fall speed (px/s) of PHYSICS_DRAG, sets the drag coefficient
+#define PHYSICS_BOUNCES                   2        // Bounces off the buildings of a shell of PHYSICS_BOUNCE before it explodes
+#define PHYSICS_RESTITUTION            0.6f        // Speed kept against the surface at a bounce
+#define PHYSICS_BOUNCE_FRICTION        0.8f        // Speed kept along the surface
+
+#define DRAG_COEFFICIENT   (SHELL_GRAVITY/(PHYSICS_DRAG_SPEED*PHYSICS_DRAG_SPEED))     // k (1/px): drag deceleration k*v^2
+#define DRAG_TIME          (PHYSICS_DRAG_SPEED/SHELL_GRAVITY)      // s: time scale of the vertical drag arcs
+#define DRAG_TABLE_SIZE                4096        // Points of each drag table, over the ranges below
+#define DRAG_MAX_PHASE                 1.4f        // Rising phase atan(speed up/terminal speed) up to this (5.8 terminal speeds)
+#define DRAG_MAX_FALL                 16.0f        // Falling phase up to this, log(cosh()) is a line past it
+
+// Inlined into each caller: with a constant physics, the code of the other integrators folds away
+#if defined(__GNUC__)
+    #define PHYSICS_INLINE      static inline __attribute__((always_inline))
+#else
+    #define PHYSICS_INLINE      static inline
+#endif
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+// Physics of a match, see SetPhysicsMode()
+typedef enum PhysicsMode {
+    PHYSICS_CLASSIC = 0,            // Gravity only
+    PHYSICS_WIND,                   // Gravity and the wind of the map, a horizontal acceleration
+    PHYSICS_DRAG,                   // Gravity and air drag k*v^2 on each axis (not on the speed), the shells slow down
+    PHYSICS_LOW_GRAVITY,            // Gravity only, PHYSICS_LOW_GRAVITY_SCALE of it
+    PHYSICS_BOUNCE,                 // Gravity only, the shells bounce off the buildings before they explode
+    PHYSICS_COUNT
+} PhysicsMode;
+
+typedef enum DragTable {
+    DRAG_LOG_COS = 0,               // log(cos(phase)), height while rising
+    DRAG_TAN,                       // tan(phase), speed while rising
+    DRAG_LOG_COSH,                  // log(cosh(phase)), height while falling
+    DRAG_TANH,                      // tanh(phase), speed while falling
+    DRAG_TABLE_COUNT
+} DragTable;
+
+typedef struct Trajectory {
+    Vector2 origin;                 // Launch position
+    Vector2 velocity;               // Launch velocity (px/s)
+    float gravity;                  // Downward acceleration (px/s^2)
+    PhysicsMode physics;            // Integrator of the arc, all zero is a gravity arc
+
+    float wind;                     // PHYSICS_WIND: horizontal acceleration (px/s^2)
+    float decay;                    // PHYSICS_DRAG: k*|vx| at launch (1/s), vx(t) = vx/(1 + decay*t)
+    float phase;                    // PHYSICS_DRAG: rising phase at launch, vy(t) = -PHYSICS_DRAG_SPEED*tan(phase - t/DRAG_TIME)
+    float topTime;                  // PHYSICS_DRAG: end of the rise, 0 if launched going down
+    float fallTime;                 // PHYSICS_DRAG: time the fall would have started from rest, vy(t) = PHYSICS_DRAG_SPEED*tanh((t - fallTime)/DRAG_TIME)
+    float topY;                     // PHYSICS_DRAG: height the fall would have started from
+} Trajectory;
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+extern float dragTable[DRAG_TABLE_COUNT][DRAG_TABLE_SIZE + 1];     // Filled by the first drag launch
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+Trajectory LaunchTrajectory(Vector2 origin, int angle, int power, bool toTheRight, PhysicsMode physics, float wind);  // Angle in degrees above the horizon
+Trajectory ResumeTrajectory(Trajectory trajectory, Vector2 origin, Vector2 velocity);  // New arc in the same physics (bomblets, bounces)
+float GetPhysicsGravity(PhysicsMode physics);                                       // Downward acceleration (px/s^2)
+const char *GetPhysicsName(PhysicsMode physics);
+Vector2 TrajectoryPosition(Trajectory trajectory, float time);                      // Position at the given flight time
+Vector2 TrajectoryVelocity(Trajectory trajectory, float time);                      // Velocity at the given flight time
+float TrajectoryTimeAtX(Trajectory trajectory, float x);                            // Time the shell crosses x, -1 if never
+float TrajectoryTimeAtY(Trajectory trajectory, float y);                            // Time the shell crosses y going down, -1 if never
+float TrajectoryNextTime(Trajectory trajectory, float time, float maxDistance);     // Next sample time, the shell moves at most maxDistance
+float TrajectoryTopTime(Trajectory trajectory);                                     // Time of the top of the arc, negative or 0 if launched going down
+
+//------------------------------------------------------------------------------------
+// Integrators: the functions above with the physics as an argument, for the hot loops.
+// Low gravity and bounce shells fly the gravity arc, with their own gravity
+//------------------------------------------------------------------------------------
+PHYSICS_INLINE float LookupDrag(DragTable table, float u, float range)
+{
+    float index = u*(DRAG_TABLE_SIZE/range);
+    int i = (int)index;
+
+    if (i < 0) i = 0;
+    if (i > DRAG_TABLE_SIZE - 1) i = DRAG_TABLE_SIZE - 1;      // Past the range: the last segment extended
+
+    return dragTable[table][i] + (dragTable[table][i + 1] - dragTable[table][i])*(index - i);
+}
+
+PHYSICS_INLINE Vector2 ArcPosition(Trajectory trajectory, float time, PhysicsMode physics)
+{
+    Vector2 position = { 0 };
+
+    switch (physics)
+    {
+        case PHYSICS_WIND:
+        {
+            position.x = trajectory.origin.x + trajectory.velocity.x*time + trajectory.wind*time*time/2;
+            position.y = trajectory.origin.y + trajectory.velocity.y*time + trajectory.gravity*time*time/2;
+        } break;
+        case PHYSICS_DRAG:
+        {
+            float distance = log1pf(trajectory.decay*time)/DRAG_COEFFICIENT;
+
+            position.x = trajectory.origin.x + ((trajectory.velocity.x < 0.0f) ? -distance : distance);
+
+            if (time < trajectory.topTime) position.y = trajectory.topY - LookupDrag(DRAG_LOG_COS, trajectory.phase - time/DRAG_TIME, DRAG_MAX_PHASE)/DRAG_COEFFICIENT;
+            else position.y = trajectory.topY + LookupDrag(DRAG_LOG_COSH, (time - trajectory.fallTime)/DRAG_TIME, DRAG_MAX_FALL)/DRAG_COEFFICIENT;
+        } break;
+        default:
+        {
+            position.x = trajectory.origin.x + trajectory.velocity.x*time;
+            position.y = trajectory.origin.y + trajectory.velocity.y*time + trajectory.gravity*time*time/2;
+        } break;
+    }
+
+    return position;
+}
+
+PHYSICS_INLINE Vector2 ArcVelocity(Trajectory trajectory, float time, PhysicsMode physics)
+{
+    switch (physics)
+    {
+        case PHYSICS_WIND: return (Vector2){ trajectory.velocity.x + trajectory.wind*time, trajectory.velocity.y + trajectory.gravity*time };
+        case PHYSICS_DRAG:
+        {
+            Vector2 velocity = { trajectory.velocity.x/(1.0f + trajectory.decay*time), 0.0f };
+
+            if (time < trajectory.topTime) velocity.y = -PHYSICS_DRAG_SPEED*LookupDrag(DRAG_TAN, trajectory.phase - time/DRAG_TIME, DRAG_MAX_PHASE);
+            else velocity.y = PHYSICS_DRAG_SPEED*LookupDrag(DRAG_TANH, (time - trajectory.fallTime)/DRAG_TIME, DRAG_MAX_FALL);
+
+            return velocity;
+        }
+        default: return (Vector2){ trajectory.velocity.x, trajectory.velocity.y + trajectory.gravity*time };
+    }
+}
+
+// Earliest time the shell crosses x, -1 if never
+PHYSICS_INLINE float ArcTimeAtX(Trajectory trajectory, float x, PhysicsMode physics)
+{
+    float distance = x - trajectory.origin.x;
+    float time = -1.0f;
+
+    switch (physics)
+    {
+        case PHYSICS_WIND:
+        {
+            // Earliest positive root of wind/2*t^2 + vx*t - distance = 0, the wind may bring the shell back
+            float a = trajectory.wind/2;
+            float b = trajectory.velocity.x;
+
+            if (a == 0.0f) time = (b != 0.0f) ? distance/b : -1.0f;
+            else
+            {
+                float discriminant = b*b + 4*a*distance;
+
+                if (discriminant < 0.0f) return -1.0f;
+
+                float root = sqrtf(discriminant);
+                float early = (-b - root)/(2*a);
+                float late = (-b + root)/(2*a);
+
+                if (early > late) { float swap = early; early = late; late = swap; }
+
+                time = (early >= 0.0f) ? early : late;
+            }
+        } break;
+        case PHYSICS_DRAG:
+        {
+            if (trajectory.velocity.x < 0.0f) distance = -distance;
+
+            // The shell never stops: log(1 + decay*t)/k covers any distance ahead
+            if ((trajectory.decay > 0.0f) && (distance >= 0.0f)) time = expm1f(distance*DRAG_COEFFICIENT)/trajectory.decay;
+        } break;
+        default:
+        {
+            if (trajectory.velocity.x != 0.0f) time = distance/trajectory.velocity.x;
+        } break;
+    }
+
+    return (time >= 0.0f) ? time : -1.0f;
+}
+
+// Time the shell crosses y going down, -1 if never
+PHYSICS_INLINE float ArcTimeAtY(Trajectory trajectory, float y, PhysicsMode physics)
+{
+    float time = -1.0f;
+
+    if (physics == PHYSICS_DRAG)
+    {
+        // log(cosh(phase)) = k*(y - topY), so cosh(phase) = e^v: phase = v + log(1 + sqrt(1 - e^-2v))
+        float v = (y - trajectory.topY)*DRAG_COEFFICIENT;
+
+        if (v < 0.0f) return -1.0f;
+
+        time = trajectory.fallTime + (v + logf(1.0f + sqrtf(1.0f - expf(-2.0f*v))))*DRAG_TIME;
+    }
+    else
+    {
+        // Later root of g/2*t^2 + vy*t + (y0 - y) = 0, the earlier one is on the way up
+        float g = trajectory.gravity;
+        float vy = trajectory.velocity.y;
+        float discriminant = vy*vy - 2*g*(trajectory.origin.y - y);
+
+        if ((g <= 0.0f) || (discriminant < 0.0f)) return -1.0f;
+
+        time = (-vy + sqrtf(discriminant))/g;
+    }
+
+    return (time >= 0.0f) ? time : -1.0f;
+}
+
+PHYSICS_INLINE float ArcNextTime(Trajectory trajectory, float time, float maxDistance, PhysicsMode physics)
+{
+    Vector2 velocity = ArcVelocity(trajectory, time, physics);
+    float speed = sqrtf(velocity.x*velocity.x + velocity.y*velocity.y);
+    float acceleration = trajectory.gravity;
+
+    // Bound of the acceleration over the step: the wind adds up, the drag is strongest at the current speed
+    if (physics == PHYSICS_WIND) acceleration += fabsf(trajectory.wind);
+    if (physics == PHYSICS_DRAG) acceleration += DRAG_COEFFICIENT*speed*speed;
+
+    // Near the apex of a vertical shot the speed is almost zero, the acceleration alone bounds the move
+    float step = sqrtf(2*maxDistance/acceleration);
+
+    if (speed*step > maxDistance) step = maxDistance/speed;
+
+    return time + step;
+}
+
+#endif // BALLISTICS_H
@@ -0,0 +1,603 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - microbenchmarks
+*
+*   Times the hot paths of the game core on fixed seeds, writes the metrics as JSON and
+*   compares them with a stored baseline: a metric worse than the baseline by more than the
+*   threshold is a regression, and the run fails, as it does without a baseline. The metrics
+*   depend on the machine, so no baseline is shipped: --save-baseline stores the one of this
+*   machine. Built without raylib, like the headless
+*   runner (make bench).
+*
+*   Draw calls need a window: they are read from a profile of the game (./game --profile),
+*   given with --frames.
+*
+*   Usage: benchmark [--out bench.json] [--baseline bench-baseline.json] [--threshold %]
+*                    [--frames frames.csv] [--save-baseline]
+*
+********************************************************************************************/
+
+#include "game.h"
+#include "ai.h"
+#include "snapshot.h"
+#include "tankmask.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define BENCH_SEED                       42
+#define BENCH_MIN_TIME                 0.15        // Seconds each metric is measured for, at least
+#define BENCH_RUNS                        3        // Measures of each metric, the best is kept (the others met more noise)
+#define BENCH_DEFAULT_THRESHOLD        15.0        // % a metric may be worse than its baseline
+#define BENCH_MAX_METRICS                32
+
+#define BENCH_SAMPLES                  4096        // Precomputed random inputs, cycled through
+#define BENCH_STEP              (1.0f/120)        // Physics step of the windowed game
+#define BENCH_MAX_TURNS                 500        // A round nobody can win is dropped and the map regenerated
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct BenchMetric {
+    char name[64];
+    const char *unit;
+    bool higherIsBetter;
+    double value;
+} BenchMetric;
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static BenchMetric metric[BENCH_MAX_METRICS] = { 0 };
+static int metricCount = 0;
+
+static Game game = { 0 };
+static volatile int sink = 0;                   // Results the compiler must not optimize away
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void AddMetric(const char *name, const char *unit, bool higherIsBetter, double value);
+static void NewMap(int players, int screens);
+
+static void BenchShellSteps(void);
+static void BenchSimulateShot(PhysicsMode physics);
+static void BenchCircleRec(void);
+static void BenchCircleMask(void);
+static void BenchTerrainLookups(int craters);
+static void BenchPlanLookups(int craters);
+static void BenchMapInit(int screens);
+static void BenchSnapshots(int screens);
+static void BenchRound(void);
+static bool ReadDrawCalls(const char *fileName);
+
+static bool SaveMetrics(const char *fileName);
+static int CompareBaseline(const char *fileName, double threshold);
+
+//------------------------------------------------------------------------------------
+// Program main entry point
+//------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    const char *outFileName = "bench.json";
+    const char *baselineFileName = "bench-baseline.json";
+    const char *framesFileName = NULL;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    bool saveBaseline = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--out") == 0) && (i + 1 < argc)) outFileName = argv[++i];
+        else if ((strcmp(argv[i], "--baseline") == 0) && (i + 1 < argc)) baselineFileName = argv[++i];
+        else if ((strcmp(argv[i], "--threshold") == 0) && (i + 1 < argc)) threshold = atof(argv[++i]);
+        else if ((strcmp(argv[i], "--frames") == 0) && (i + 1 < argc)) framesFileName = argv[++i];
+        else if (strcmp(argv[i], "--save-baseline") == 0) saveBaseline = true;
+        else
+        {
+            fprintf(stderr, "Usage: %s [--out bench.json] [--baseline bench-baseline.json] [--threshold %%] [--frames frames.csv] [--save-baseline]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        BenchShellSteps();
+        for (int physics = 0; physics < PHYSICS_COUNT; physics++) BenchSimulateShot((PhysicsMode)physics);
+        BenchCircleRec();
+        BenchCircleMask();
+        BenchTerrainLookups(0);
+        BenchTerrainLookups(100);
+        BenchTerrainLookups(1000);
+        BenchPlanLookups(0);
+        BenchPlanLookups(100);
+        BenchPlanLookups(1000);
+        BenchMapInit(1);
+        BenchMapInit(MAX_WORLD_SCREENS);
+        BenchSnapshots(1);
+        BenchSnapshots(MAX_WORLD_SCREENS);
+        BenchRound();
+    }
+
+    if ((framesFileName != NULL) && !ReadDrawCalls(framesFileName))
+    {
+        fprintf(stderr, "%s is not a profile of the game (--profile)\n", framesFileName);
+        return 1;
+    }
+
+    for (int i = 0; i < metricCount; i++) printf("%-36s %14.1f %s\n", metric[i].name, metric[i].value, metric[i].unit);
+
+    if (!SaveMetrics(outFileName))
+    {
+        fprintf(stderr, "%s could not be written\n", outFileName);
+        return 1;
+    }
+
+    printf("metrics written to %s\n", outFileName);
+
+    if (saveBaseline)
+    {
+        if (!SaveMetrics(baselineFileName))
+        {
+            fprintf(stderr, "%s could not be written\n", baselineFileName);
+            return 1;
+        }
+
+        printf("baseline %s saved\n", baselineFileName);
+        return 0;
+    }
+
+    // Nothing to compare with is a failure, not a pass: the baseline of a machine is stored on purpose
+    FILE *baseline = fopen(baselineFileName, "r");
+
+    if (baseline == NULL)
+    {
+        fprintf(stderr, "%s not found, store one with --save-baseline (make bench BENCH_FLAGS=--save-baseline)\n", baselineFileName);
+        return 1;
+    }
+
+    fclose(baseline);
+
+    return CompareBaseline(baselineFileName, threshold);
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+// A metric measured again keeps its best value
+static void AddMetric(const char *name, const char *unit, bool higherIsBetter, double value)
+{
+    for (int i = 0; i < metricCount; i++)
+    {
+        if (strcmp(metric[i].name, name) != 0) continue;
+
+        if (higherIsBetter ? (value > metric[i].value) : (value < metric[i].value)) metric[i].value = value;
+        return;
+    }
+
+    if (metricCount == BENCH_MAX_METRICS) return;
+
+    BenchMetric *added = &metric[metricCount++];
+
+    strncpy(added->name, name, sizeof(added->name) - 1);
+    added->unit = unit;
+    added->higherIsBetter = higherIsBetter;
+    added->value = value;
+}
+
+// Same map for every run of the benchmark
+static void NewMap(int players, int screens)
+{
+    srand(BENCH_SEED);
+    SeedGame(&game, BENCH_SEED);
+    SetPlayerCount(&game, players);
+    SetWorldScreens(&game, screens);
+    SetPhysicsMode(&game, PHYSICS_CLASSIC);
+    InitLives(&game);
+    InitGame(&game);
+}
+
+// Shells moved by StepGame() per second, barrages of the whole pool on a map of 16 tanks
+static void BenchShellSteps(void)
+{
+    long long shellSteps = 0;
+    double elapsed = 0.0;
+    int volley = 0;
+
+    NewMap(MAX_PLAYERS, 1);
+
+    while (elapsed < BENCH_MIN_TIME)
+    {
+        if (game.gameOver)
+        {
+            InitLives(&game);
+            InitGame(&game);
+        }
+
+        double startTime = GetTime();
+
+        FireMunition(&game, 30 + volley%40, 300 + (volley*37)%400, MUNITION_BARRAGE);
+
+        while (game.shellOnAir && !game.gameOver)
+        {
+            shellSteps += game.shellCount;
+            StepGame(&game, BENCH_STEP);
+        }
+
+        elapsed += GetTime() - startTime;
+        volley++;
+    }
+
+    AddMetric("shell_steps_per_sec", "shell steps/s", true, shellSteps/elapsed);
+}
+
+// Whole swept flights of a single shell, as the AI simulates them, in each physics on the same map
+static void BenchSimulateShot(PhysicsMode physics)
+{
+    long long shots = 0;
+    char name[64] = { 0 };
+
+    NewMap(MIN_PLAYERS, 1);
+    SetPhysicsMode(&game, physics);
+    InitGameMap(&game, game.mapSeed);
+
+    double startTime = GetTime();
+    double elapsed = 0.0;
+
+    while (elapsed < BENCH_MIN_TIME)
+    {
+        for (int i = 0; i < 256; i++) sink += SimulateShot(&game, 10 + (int)(shots%80), 100 + (int)((shots*37)%900), NULL, NULL);
+
+        shots += 256;
+        elapsed = GetTime() - startTime;
+    }
+
+    // The classic physics keeps the name of the metric from before the physics modes
+    if (physics == PHYSICS_CLASSIC) snprintf(name, sizeof(name), "simulate_shot_per_sec");
+    else snprintf(name, sizeof(name), "simulate_shot_per_sec_%s", GetPhysicsName(physics));
+
+    for (char *c = name; *c != '\0'; c++) if (*c == '-') *c = '_';
+
+    AddMetric(name, "shots/s", true, shots/elapsed);
+}
+
+// The tank narrowphase, on random circles and rectangles
+static void BenchCircleRec(void)
+{
+    static Vector2 center[BENCH_SAMPLES] = { 0 };
+    static Rectangle rec[BENCH_SAMPLES] = { 0 };
+    long long checks = 0;
+
+    srand(BENCH_SEED);
+
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+    {
+        center[i] = (Vector2){ (float)GetRandomValue(0, 200), (float)GetRandomValue(0, 200) };
+        rec[i] = (Rectangle){ (float)GetRandomValue(0, 150), (float)GetRandomValue(0, 150), (float)GetRandomValue(10, 60), (float)GetRandomValue(10, 60) };
+    }
+
+    double startTime = GetTime();
+    double elapsed = 0.0;
+
+    while (elapsed < BENCH_MIN_TIME)
+    {
+        for (int i = 0; i < BENCH_SAMPLES; i++) sink += CheckCollisionCircleRec(center[i], SHELL_RADIUS, rec[i]);
+
+        checks += BENCH_SAMPLES;
+        elapsed = GetTime() - startTime;
+    }
+
+    AddMetric("circle_rec_checks_per_sec", "checks/s", true, checks/elapsed);
+}
+
+// The same circles against the pixels of a tank sprite
+static void BenchCircleMask(void)
+{
+    static Vector2 center[BENCH_SAMPLES] = { 0 };
+    static Vector2 origin[BENCH_SAMPLES] = { 0 };
+    const TankMask *mask = GetTankMask(true);
+    long long checks = 0;
+
+    srand(BENCH_SEED);
+
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+    {
+        center[i] = (Vector2){ (float)GetRandomValue(0, 200), (float)GetRandomValue(0, 200) };
+        origin[i] = (Vector2){ (float)GetRandomValue(0, 150), (float)GetRandomValue(0, 150) };
+    }
+
+    double startTime = GetTime();
+    double elapsed = 0.0;
+
+    while (elapsed < BENCH_MIN_TIME)
+    {
+        for (int i = 0; i < BENCH_SAMPLES; i++) sink += CheckCollisionCircleMask(center[i], SHELL_RADIUS, mask, origin[i]);
+
+        checks += BENCH_SAMPLES;
+        elapsed = GetTime() - startTime;
+    }
+
+    AddMetric("circle_mask_checks_per_sec", "checks/s", true, checks/elapsed);
+}
+
+// Ground tests of a one screen map after some explosions: the bitmask answers in one lookup whatever their number
+static void BenchTerrainLookups(int craters)
+{
+    static int x[BENCH_SAMPLES] = { 0 };
+    static int y[BENCH_SAMPLES] = { 0 };
+    long long lookups = 0;
+    char name[64] = { 0 };
+
+    NewMap(MIN_PLAYERS, 1);
+
+    for (int i = 0; i < craters; i++) CarveTerrainCircle(&game.terrain, (Vector2){ (float)GetRandomValue(0, screenWidth - 1), (float)GetRandomValue((int)game.skyline, screenHeight - 1) }, CRATER_RADIUS);
+
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+    {
+        x[i] = GetRandomValue(0, screenWidth - 1);
+        y[i] = GetRandomValue(0, screenHeight - 1);
+    }
+
+    double startTime = GetTime();
+    double elapsed = 0.0;
+
+    while (elapsed < BENCH_MIN_TIME)
+    {
+        for (int i = 0; i < BENCH_SAMPLES; i++) sink += IsTerrainSolid(&game.terrain, x[i], y[i]);
+
+        lookups += BENCH_SAMPLES;
+        elapsed = GetTime() - startTime;
+    }
+
+    snprintf(name, sizeof(name), "terrain_lookups_per_sec_%i_craters", craters);
+    AddMetric(name, "lookups/s", true, lookups/elapsed);
+}
+
+// Ground tests of a streamed chunk without bits, as the shot simulations make them: the scratch bits built from its plan
+static void BenchPlanLookups(int craters)
+{
+    static int x[BENCH_SAMPLES] = { 0 };
+    static int y[BENCH_SAMPLES] = { 0 };
+    long long lookups = 0;
+    char name[64] = { 0 };
+
+    NewMap(MIN_PLAYERS, MAX_WORLD_SCREENS);
+
+    // A screen in the middle of the world, far from the chunks the map left built
+    int x0 = game.worldWidth/2;
+
+    for (int i = 0; i < craters; i++) CarveTerrainCircle(&game.terrain, (Vector2){ (float)GetRandomValue(x0, x0 + screenWidth - 1), (float)GetRandomValue((int)game.skyline, screenHeight - 1) }, CRATER_RADIUS);
+
+    RequireTerrain(&game.terrain, 0, TERRAIN_CACHE_CHUNKS*TERRAIN_CHUNK_WIDTH - 1);
+
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+    {
+        x[i] = GetRandomValue(x0, x0 + screenWidth - 1);
+        y[i] = GetRandomValue(0, screenHeight - 1);
+    }
+
+    double startTime = GetTime();
+    double elapsed = 0.0;
+
+    while (elapsed < BENCH_MIN_TIME)
+    {
+        for (int i = 0; i < BENCH_SAMPLES; i++) sink += IsTerrainSolid(&game.terrain, x[i], y[i]);
+
+        lookups += BENCH_SAMPLES;
+        elapsed = GetTime() - startTime;
+    }
+
+    snprintf(name, sizeof(name), "plan_lookups_per_sec_%i_craters", craters);
+    AddMetric(name, "lookups/s", true, lookups/elapsed);
+}
+
+// Map generation: buildings, tanks, terrain and collision grid (InitGame())
+static void BenchMapInit(int screens)
+{
+    int maps = 0;
+    char name[64] = { 0 };
+
+    NewMap(MIN_PLAYERS, screens);
+
+    double startTime = GetTime();
+    double elapsed = 0.0;
+
+    while (elapsed < BENCH_MIN_TIME)
+    {
+        InitGame(&game);
+
+        maps++;
+        elapsed = GetTime() - startTime;
+    }
+
+    snprintf(name, sizeof(name), "map_init_us_%i_screen%s", screens, (screens > 1) ? "s" : "");
+    AddMetric(name, "us", false, elapsed*1e6/maps);
+}
+
+// Snapshot save and restore of a map with craters (SaveSnapshot() and RestoreSnapshot(), undo and rollback)
+static void BenchSnapshots(int screens)
+{
+    static unsigned char data[SNAPSHOT_MAX_SIZE];
+    static Game restored = { 0 };
+    int snapshots = 0;
+    int size = 0;
+    char name[64] = { 0 };
+
+    NewMap(MIN_PLAYERS, screens);
+
+    for (int i = 0; (i < 20) && !game.gameOver; i++)
+    {
+        FireShell(&game, 30 + (i*7)%40, 200 + (i*53)%600);
+        LandShell(&game);
+    }
+
+    double saveTime = 0.0;
+    double restoreTime = 0.0;
+
+    while (saveTime + restoreTime < BENCH_MIN_TIME)
+    {
+        double startTime = GetTime();
+
+        for (int i = 0; i < 64; i++) size = SaveSnapshot(&game, i, data);
+
+        double middleTime = GetTime();
+
+        for (int i = 0; i < 64; i++) sink += RestoreSnapshot(data, size, &restored, NULL);
+
+        saveTime += middleTime - startTime;
+        restoreTime += GetTime() - middleTime;
+        snapshots += 64;
+    }
+
+    snprintf(name, sizeof(name), "snapshot_save_us_%i_screen%s", screens, (screens > 1) ? "s" : "");
+    AddMetric(name, "us", false, saveTime*1e6/snapshots);
+    snprintf(name, sizeof(name), "snapshot_restore_us_%i_screen%s", screens, (screens > 1) ? "s" : "");
+    AddMetric(name, "us", false, restoreTime*1e6/snapshots);
+}
+
+// Whole rounds between two easy AIs, searching without time budget so the rounds are the same every run
+static void BenchRound(void)
+{
+    AIConfig config = GetAIConfig(AI_EASY);
+    int rounds = 0;
+    int turns = 0;
+
+    config.timeBudget = 0.0f;
+    InitAI(0);
+
+    NewMap(MIN_PLAYERS, 1);
+
+    int round = game.round;
+    double startTime = GetTime();
+    double elapsed = 0.0;
+
+    while (elapsed < BENCH_MIN_TIME)
+    {
+        int angle = 0;
+        int power = 0;
+
+        AIChooseShot(&game, config, &angle, &power);
+        FireShell(&game, angle, power);
+        LandShell(&game);
+        turns++;
+
+        if ((game.round != round) || game.gameOver || (turns >= BENCH_MAX_TURNS))
+        {
+            if (game.gameOver) InitLives(&game);
+            if (game.gameOver || (turns >= BENCH_MAX_TURNS)) InitGame(&game);
+
+            round = game.round;
+            rounds++;
+            turns = 0;
+            elapsed = GetTime() - startTime;
+        }
+    }
+
+    CloseAI();
+
+    AddMetric("round_ms", "ms", false, elapsed*1000.0/rounds);
+}
+
+// Mean and worst draw calls of the frames of a profile CSV, their last column
+static bool ReadDrawCalls(const char *fileName)
+{
+    FILE *file = fopen(fileName, "r");
+    char line[512] = { 0 };
+    long long frames = 0;
+    double sum = 0.0;
+    int worst = 0;
+
+    if (file == NULL) return false;
+
+    bool found = (fgets(line, sizeof(line), file) != NULL) && (strstr(line, ",draw_calls") != NULL);
+
+    while (found && (fgets(line, sizeof(line), file) != NULL))
+    {
+        const char *last = strrchr(line, ',');
+
+        if (last == NULL) continue;
+
+        int calls = atoi(last + 1);
+
+        sum += calls;
+        if (calls > worst) worst = calls;
+        frames++;
+    }
+
+    fclose(file);
+
+    if (!found || (frames == 0)) return false;
+
+    AddMetric("draw_calls_per_frame_avg", "calls", false, sum/frames);
+    AddMetric("draw_calls_per_frame_max", "calls", false, worst);
+
+    return true;
+}
+
+// One metric per line, so the baseline can be read back without a JSON parser
+static bool SaveMetrics(const char *fileName)
+{
+    FILE *file = fopen(fileName, "w");
+
+    if (file == NULL) return false;
+
+    fprintf(file, "{\n  \"seed\": %i,\n  \"metrics\": [\n", BENCH_SEED);
+
+    for (int i = 0; i < metricCount; i++)
+    {
+        fprintf(file, "    { \"name\": \"%s\", \"value\": %.3f, \"unit\": \"%s\", \"better\": \"%s\" }%s\n", metric[i].name, metric[i].value,
+                metric[i].unit, metric[i].higherIsBetter ? "higher" : "lower", (i < metricCount - 1) ? "," : "");
+    }
+
+    fprintf(file, "  ]\n}\n");
+
+    return (fclose(file) == 0);
+}
+
+// Returns the exit code: 1 if a metric regressed past the threshold, metrics missing from either side are skipped
+static int CompareBaseline(const char *fileName, double threshold)
+{
+    FILE *file = fopen(fileName, "r");
+    char line[512] = { 0 };
+    int regressions = 0;
+
+    if (file == NULL) return 1;
+
+    printf("\n%-36s %14s %14s %8s\n", "against baseline", "baseline", "now", "change");
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char name[64] = { 0 };
+        double value = 0.0;
+
+        if (sscanf(line, " { \"name\": \"%63[^\"]\", \"value\": %lf", name, &value) != 2) continue;
+
+        for (int i = 0; i < metricCount; i++)
+        {
+            if (strcmp(metric[i].name, name) != 0) continue;
+
+            double change = (value != 0.0) ? 100.0*(metric[i].value - value)/value : 0.0;
+            double worse = metric[i].higherIsBetter ? -change : change;
+            bool regressed = (worse > threshold);
+
+            printf("%-36s %14.1f %14.1f %+7.1f%%%s\n", name, value, metric[i].value, change, regressed ? "  REGRESSION" : "");
+
+            if (regressed) regressions++;
+        }
+    }
+
+    fclose(file);
+
+    if (regressions > 0)
+    {
+        printf("%i metric%s regressed by more than %.0f%%\n", regressions, (regressions > 1) ? "s" : "", threshold);
+        return 1;
+    }
+
+    printf("no regression past %.0f%%\n", threshold);
+
+    return 0;
+}
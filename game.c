@@ -0,0 +1,910 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - game core
+*
+*   Shell ballistics and turn rules, the maps come from mapgen.c. Nothing in here opens a window,
+*   reads input or plays a sound, see game.h.
+*
+********************************************************************************************/
+
+#include "game.h"
+#include "tankmask.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define GRID_TANK_MARGIN    (SHELL_RADIUS + 1)                          // Tank hitboxes are grown by this in the grid, the circle test rounds the box center
+#define CRATER_REACH        (CRATER_RADIUS + 2*BALLISTICS_MAX_STEP + 1) // Impacts this close to a new crater are computed again
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct MunitionInfo {
+    const char *name;
+    int shells;                     // Shells fired at once
+    int spread;                     // Degrees between two of them
+    int bomblets;                   // Bomblets of each shell, 0: it lands whole
+} MunitionInfo;
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static const MunitionInfo munitionInfo[MUNITION_COUNT] = {
+    { "SHELL", 1, 0, 0 },
+    { "VOLLEY", 5, 3, 0 },
+    { "CLUSTER", 1, 0, 8 },
+    { "BARRAGE", 16, 2, 8 },        // 128 bomblets, the whole pool
+};
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void InitPlayers(Game *game, const GameMap *map);
+static void InitSkyline(Game *game);
+static void InitGrid(Game *game);
+static void UpdateGridTanks(Game *game);
+static void InitShell(Shell *shell);
+static void ClearShells(Game *game);
+static void LaunchShell(Shell *shell, int owner, Trajectory trajectory, float launchTime, int bomblets, int bounces);
+static Shell *SpawnShell(Game *game, int owner, Trajectory trajectory, float launchTime, int bomblets, int bounces);
+static void ReleaseShell(Game *game, int live);
+static void PredictShell(const Game *game, Shell *shell);
+static void ReviseShells(Game *game, const Vector2 *crater);
+static ShellEvent EndShell(Game *game, int live);
+static void SplitShell(Game *game, const Shell *shell);
+static void BounceShell(Game *game, const Shell *shell);
+static Trajectory BounceTrajectory(const Game *game, const Shell *shell);
+static void ApplyRules(Game *game);
+static void MoveShell(Shell *shell, float time);
+static void MoveShells(Game *game, float volleyTime);
+static ShellEvent FlyShell(const Game *game, Shell *shell, float targetTime, int *hitIndex);
+static Vector2 ShellNose(Vector2 position, Vector2 speed, float radius);
+static int GetGameRandomValue(Game *game, int min, int max);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+
+// Seed the seeds of the maps, nothing else in the game core is random
+void SeedGame(Game *game, unsigned int seed)
+{
+    game->randomState = SeedMapState(seed);
+}
+
+// Set the number of tanks, the players alternate between the left and the right team
+void SetPlayerCount(Game *game, int count)
+{
+    if (count < MIN_PLAYERS) count = MIN_PLAYERS;
+    if (count > MAX_PLAYERS) count = MAX_PLAYERS;
+
+    game->playerCount = count;
+}
+
+// Set the world width in screens, a one screen world is the classic map
+void SetWorldScreens(Game *game, int screens)
+{
+    if (screens < 1) screens = 1;
+    if (screens > MAX_WORLD_SCREENS) screens = MAX_WORLD_SCREENS;
+
+    game->worldScreens = screens;
+}
+
+// Set the parameters of the next maps, all zero (or NULL) plays the defaults
+void SetMapParams(Game *game, const MapParams *params)
+{
+    if (params != NULL) game->mapParams = *params;
+    else memset(&game->mapParams, 0, sizeof(MapParams));
+}
+
+// Set the shell physics, for a whole match: replays and network games play it again from the start
+void SetPhysicsMode(Game *game, PhysicsMode physics)
+{
+    if ((physics < 0) || (physics >= PHYSICS_COUNT)) physics = PHYSICS_CLASSIC;
+
+    game->physics = physics;
+}
+
+// Initialize game variables, on a map drawn from the game generator
+void InitGame(Game *game)
+{
+    InitGameMap(game, (unsigned int)GetGameRandomValue(game, 0, 0x3fffffff));
+}
+
+// Initialize game variables, on the map of a seed
+void InitGameMap(Game *game, unsigned int mapSeed)
+{
+    GameMap map;
+    MapParams params = (game->mapParams.buildingCount > 0) ? game->mapParams : GetDefaultMapParams();
+    unsigned int aliveMask = 0;
+
+    ClearShells(game);
+
+    SetWorldScreens(game, game->worldScreens);
+    game->worldWidth = game->worldScreens*screenWidth;
+
+    for (int i = 0; i < game->playerCount; i++) if (game->player[i].lives > 0) aliveMask |= 1u << i;
+
+    GetMap(&map, &params, game->physics, mapSeed, game->worldScreens, game->playerCount, aliveMask);
+
+    game->previousMapSeed = game->mapSeed;
+    game->mapSeed = mapSeed;
+
+    game->buildingCount = map.buildingCount;
+    memcpy(game->building, map.building, map.buildingCount*sizeof(Building));
+    game->wind = (game->physics == PHYSICS_WIND) ? map.wind : 0.0f;
+
+    InitPlayers(game, &map);
+    InitSkyline(game);
+
+    // Init terrain: the plan of every chunk, their bits wait for RequireTerrain() in wide worlds
+    ClearTerrain(&game->terrain, game->worldWidth);
+
+    for (int i = 0; i < game->buildingCount; i++) FillTerrainRec(&game->terrain, game->building[i].rectangle);
+
+    InitGrid(game);
+
+    game->round++;
+}
+
+// Play the previous map again, a second call comes back to this one
+void InitPreviousMap(Game *game)
+{
+    InitGameMap(game, game->previousMapSeed);
+}
+
+// Initialize the player lives
+void InitLives(Game *game)
+{
+    SetPlayerCount(game, game->playerCount);
+
+    for (int i = 0; i < MAX_PLAYERS; i++)
+    {
+        game->player[i].lives = (i < game->playerCount) ? LIVES : 0;
+    }
+
+    if (game->playerTurn >= game->playerCount) game->playerTurn = 0;
+
+    game->gameOver = false;
+    game->winner = 0;
+    game->round = 0;
+}
+
+// Fire a single shell of the current player with the given angle (degrees) and power
+bool FireShell(Game *game, int angle, int power)
+{
+    return FireMunition(game, angle, power, MUNITION_SHELL);
+}
+
+// Fire the shells of a munition, fanned out around the given angle
+bool FireMunition(Game *game, int angle, int power, Munition munition)
+{
+    if (game->gameOver || game->shellOnAir) return false;
+    if ((munition < 0) || (munition >= MUNITION_COUNT)) munition = MUNITION_SHELL;
+
+    const MunitionInfo *info = &munitionInfo[munition];
+    Player *shooter = &game->player[game->playerTurn];
+
+    shooter->previousPower = power;
+    shooter->previousAngle = angle;
+
+    game->volleyTime = 0.0f;
+
+    for (int i = 0; i < info->shells; i++)
+    {
+        int shellAngle = angle + (2*i - (info->shells - 1))*info->spread/2;
+
+        // Right team shoots towards the left of the screen
+        SpawnShell(game, game->playerTurn, LaunchTrajectory(shooter->position, shellAngle, power, shooter->isLeftTeam, game->physics, game->wind), 0.0f, info->bomblets,
+                   (game->physics == PHYSICS_BOUNCE) ? PHYSICS_BOUNCES : 0);
+    }
+
+    game->shellOnAir = (game->shellCount > 0);
+
+    return true;
+}
+
+const char *GetMunitionName(Munition munition)
+{
+    if ((munition < 0) || (munition >= MUNITION_COUNT)) return "UNKNOWN";
+
+    return munitionInfo[munition].name;
+}
+
+// Fly a single shell of the current player on a copy, the game is left untouched.
+// A shell of PHYSICS_BOUNCE flies on from the buildings it meets, as EndShell() has it
+ShellEvent SimulateShot(const Game *game, int angle, int power, Vector2 *impactPoint, int *hitIndex)
+{
+    const Player *shooter = &game->player[game->playerTurn];
+    Shell shell = { 0 };
+    int hit = -1;
+
+    InitShell(&shell);
+    LaunchShell(&shell, game->playerTurn, LaunchTrajectory(shooter->position, angle, power, shooter->isLeftTeam, game->physics, game->wind), 0.0f, 0,
+                (game->physics == PHYSICS_BOUNCE) ? PHYSICS_BOUNCES : 0);
+
+    ShellEvent event = FlyShell(game, &shell, MAX_FLIGHT_TIME, &hit);
+
+    while ((event == SHELL_HIT_BUILDING) && (shell.bounces > 0))
+    {
+        LaunchShell(&shell, game->playerTurn, BounceTrajectory(game, &shell), 0.0f, 0, shell.bounces - 1);
+        event = FlyShell(game, &shell, MAX_FLIGHT_TIME, &hit);
+    }
+
+    if (impactPoint != NULL) *impactPoint = ShellNose(shell.position, shell.speed, shell.radius);
+    if (hitIndex != NULL) *hitIndex = hit;
+
+    return event;
+}
+
+// Same flight as SimulateShot(), for drawing it: the arcs of the shell (one more per bounce) and their flight times
+ShellEvent TraceShot(const Game *game, int angle, int power, Trajectory *trajectory, float *flightTime, int *arcCount)
+{
+    const Player *shooter = &game->player[game->playerTurn];
+    Shell shell = { 0 };
+    int hit = -1;
+
+    InitShell(&shell);
+    LaunchShell(&shell, game->playerTurn, LaunchTrajectory(shooter->position, angle, power, shooter->isLeftTeam, game->physics, game->wind), 0.0f, 0,
+                (game->physics == PHYSICS_BOUNCE) ? PHYSICS_BOUNCES : 0);
+
+    ShellEvent event = FlyShell(game, &shell, MAX_FLIGHT_TIME, &hit);
+    int count = 0;
+
+    trajectory[count] = shell.trajectory;
+    flightTime[count++] = shell.time;
+
+    while ((event == SHELL_HIT_BUILDING) && (shell.bounces > 0))
+    {
+        LaunchShell(&shell, game->playerTurn, BounceTrajectory(game, &shell), 0.0f, 0, shell.bounces - 1);
+        event = FlyShell(game, &shell, MAX_FLIGHT_TIME, &hit);
+
+        trajectory[count] = shell.trajectory;
+        flightTime[count++] = shell.time;
+    }
+
+    *arcCount = count;
+
+    return event;
+}
+
+// Update game (deltaTime seconds of shell flight)
+ShellEvent StepGame(Game *game, float deltaTime)
+{
+    if (game->gameOver || !game->shellOnAir) return SHELL_NONE;
+
+    ShellEvent event = SHELL_NONE;
+    float stepEnd = game->volleyTime + deltaTime;
+
+    // Flights ending during the step, earliest first: each impact changes the ground and the tanks the next ones meet
+    while (game->shellOnAir && !game->gameOver)
+    {
+        int next = -1;
+        float nextTime = stepEnd;
+
+        for (int i = 0; i < game->shellCount; i++)
+        {
+            const Shell *shell = &game->shell[game->liveShell[i]];
+            float endTime = shell->launchTime + shell->endTime;
+
+            if ((endTime <= stepEnd) && ((next < 0) || (endTime < nextTime)))
+            {
+                next = i;
+                nextTime = endTime;
+            }
+        }
+
+        if (next < 0) break;
+
+        ShellEvent shellEvent = EndShell(game, next);
+
+        if (shellEvent > event) event = shellEvent;
+    }
+
+    // Shells still flying are only moved along their arcs, with the ground around them built
+    if (game->shellOnAir && !game->gameOver) MoveShells(game, stepEnd);
+
+    return event;
+}
+
+// Skip the flight: the shells land in a single call, whatever their flight time
+ShellEvent LandShell(Game *game)
+{
+    return StepGame(game, MAX_FLIGHT_TIME);
+}
+
+// FNV-1a over what the next shots depend on: tanks, ground, turn and map generator.
+// Shells in the air are left out, two games are compared between shots
+unsigned int GetGameChecksum(const Game *game)
+{
+    unsigned int hash = 2166136261u;
+
+    hash = HashBytes(hash, &game->randomState, sizeof(game->randomState));
+    hash = HashBytes(hash, &game->previousMapSeed, sizeof(game->previousMapSeed));
+    hash = HashBytes(hash, &game->round, sizeof(game->round));
+    hash = HashBytes(hash, &game->playerTurn, sizeof(game->playerTurn));
+    hash = HashBytes(hash, &game->playerCount, sizeof(game->playerCount));
+    hash = HashBytes(hash, &game->gameOver, sizeof(game->gameOver));
+    hash = HashBytes(hash, &game->winner, sizeof(game->winner));
+    hash = HashBytes(hash, &game->physics, sizeof(game->physics));
+    hash = HashBytes(hash, &game->wind, sizeof(game->wind));
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Player *player = &game->player[i];
+
+        hash = HashBytes(hash, &player->position, sizeof(player->position));
+        hash = HashBytes(hash, &player->isAlive, sizeof(player->isAlive));
+        hash = HashBytes(hash, &player->lives, sizeof(player->lives));
+    }
+
+    return GetTerrainChecksum(&game->terrain, hash);
+}
+
+unsigned int HashBytes(unsigned int hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i])*16777619u;
+
+    return hash;
+}
+
+//--------------------------------------------------------------------------------------
+// Additional module functions
+//--------------------------------------------------------------------------------------
+// Tanks at the spawns of the map, the ones out of lives are out until the next match
+static void InitPlayers(Game *game, const GameMap *map)
+{
+    Player *player = game->player;
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        player[i].isAlive = (player[i].lives > 0);
+
+        // Decide the team of this player
+        if (i % 2 == 0) player[i].isLeftTeam = true;
+        else player[i].isLeftTeam = false;
+
+        // Set size, by default by now
+        player[i].size = (Vector2){ TANK_SIZE, TANK_SIZE };
+
+        // Set position, on top of its building
+        player[i].position = map->spawn[i];
+
+        // Set statistics to 0
+        player[i].aimingPoint = player[i].position;
+        player[i].previousAngle = 0;
+        player[i].previousPower = 0;
+        player[i].previousPoint = player[i].position;
+        player[i].aimingAngle = 0;
+        player[i].aimingPower = 0;
+
+        player[i].impactPoint = (Vector2){ -100, -100 };
+    }
+}
+
+// Highest point anything can be hit, craters only dig below it
+static void InitSkyline(Game *game)
+{
+    game->skyline = (float)screenHeight;
+
+    for (int i = 0; i < game->buildingCount; i++)
+    {
+        if (game->building[i].rectangle.y < game->skyline) game->skyline = game->building[i].rectangle.y;
+    }
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        if (!game->player[i].isAlive) continue;
+
+        float tankTop = game->player[i].position.y + game->player[i].size.y/2 - TANK_SPRITE_HEIGHT;
+
+        if (tankTop < game->skyline) game->skyline = tankTop;
+    }
+}
+
+// Fill the collision grid: top of the ground under each column of cells, then the tanks
+static void InitGrid(Game *game)
+{
+    CollisionGrid *grid = &game->grid;
+
+    for (int c = 0; c < GRID_COLUMNS; c++) grid->groundTop[c] = TERRAIN_HEIGHT;       // Bedrock below the screen
+
+    for (int i = 0; i < game->buildingCount; i++)
+    {
+        Rectangle rec = game->building[i].rectangle;
+        int top = ((int)rec.y > 0) ? (int)rec.y : 0;               // Same rounding as FillTerrainRec()
+        int first = (int)rec.x/GRID_CELL_SIZE;
+        int last = ((int)(rec.x + rec.width) - 1)/GRID_CELL_SIZE;
+
+        if (first < 0) first = 0;
+        if (last >= GRID_COLUMNS) last = GRID_COLUMNS - 1;
+
+        for (int c = first; c <= last; c++)
+        {
+            if (top < grid->groundTop[c]) grid->groundTop[c] = top;
+        }
+    }
+
+    UpdateGridTanks(game);
+}
+
+// List every tank alive in the cells a shell touching it can be centered in
+static void UpdateGridTanks(Game *game)
+{
+    CollisionGrid *grid = &game->grid;
+
+    memset(grid->tanks, 0, sizeof(grid->tanks));
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Player *player = &game->player[i];
+
+        if (!player->isAlive) continue;
+
+        float bottom = player->position.y + player->size.y/2;
+        int column0 = (int)floorf((player->position.x - player->size.x/2 - GRID_TANK_MARGIN)/GRID_CELL_SIZE);
+        int column1 = (int)floorf((player->position.x + player->size.x/2 + GRID_TANK_MARGIN)/GRID_CELL_SIZE);
+        int row0 = (int)floorf((bottom - TANK_SPRITE_HEIGHT - GRID_TANK_MARGIN)/GRID_CELL_SIZE);
+        int row1 = (int)floorf((bottom + GRID_TANK_MARGIN)/GRID_CELL_SIZE);
+
+        if (column0 < 0) column0 = 0;
+        if (column1 >= GRID_COLUMNS) column1 = GRID_COLUMNS - 1;
+        if (row0 < 0) row0 = 0;
+        if (row1 >= GRID_ROWS) row1 = GRID_ROWS - 1;
+
+        for (int r = row0; r <= row1; r++)
+        {
+            for (int c = column0; c <= column1; c++) grid->tanks[r][c] |= (unsigned short)(1 << i);
+        }
+    }
+}
+
+static void InitShell(Shell *shell)
+{
+    shell->radius = SHELL_RADIUS;
+    shell->rotation = 0.0;
+    shell->length = 15;
+    shell->rectangle.height = 5;
+    shell->rectangle.width = 10;
+    shell->rectangle.x = 0;
+    shell->rectangle.y = 0;
+    shell->active = false;
+}
+
+// Empty the shell pool
+static void ClearShells(Game *game)
+{
+    for (int i = 0; i < MAX_SHELLS; i++)
+    {
+        InitShell(&game->shell[i]);
+        game->freeShell[i] = MAX_SHELLS - 1 - i;       // Slot 0 is taken first
+    }
+
+    game->freeCount = MAX_SHELLS;
+    game->shellCount = 0;
+    game->volleyTime = 0.0f;
+    game->shellOnAir = false;
+}
+
+// Put the shell at the start of its trajectory
+static void LaunchShell(Shell *shell, int owner, Trajectory trajectory, float launchTime, int bomblets, int bounces)
+{
+    shell->trajectory = trajectory;
+    shell->sampleTime = 0.0f;
+    shell->owner = owner;
+    shell->bomblets = bomblets;
+    shell->bounces = bounces;
+    shell->launchTime = launchTime;
+    shell->active = true;
+
+    MoveShell(shell, 0.0f);
+}
+
+// Take a shell from the pool, launch it and find where its flight ends, NULL if the pool is empty
+static Shell *SpawnShell(Game *game, int owner, Trajectory trajectory, float launchTime, int bomblets, int bounces)
+{
+    if (game->freeCount == 0) return NULL;
+
+    int index = game->freeShell[--game->freeCount];
+    Shell *shell = &game->shell[index];
+
+    LaunchShell(shell, owner, trajectory, launchTime, bomblets, bounces);
+    PredictShell(game, shell);
+
+    game->liveShell[game->shellCount++] = index;
+
+    return shell;
+}
+
+// Give the shell of liveShell[live] back to the pool, the last shell in the list takes its place
+static void ReleaseShell(Game *game, int live)
+{
+    int index = game->liveShell[live];
+
+    game->shell[index].active = false;
+    game->freeShell[game->freeCount++] = index;
+    game->liveShell[live] = game->liveShell[--game->shellCount];
+}
+
+// Fly a copy of the shell to the end of its flight: its impact, or the split of a cluster shell
+static void PredictShell(const Game *game, Shell *shell)
+{
+    Shell flight = *shell;
+    float endTime = MAX_FLIGHT_TIME;
+    int hitIndex = -1;
+
+    if (shell->bomblets > 0)
+    {
+        endTime = TrajectoryTopTime(shell->trajectory);
+
+        if (endTime < CLUSTER_MIN_SPLIT_TIME) endTime = CLUSTER_MIN_SPLIT_TIME;
+    }
+
+    shell->endEvent = FlyShell(game, &flight, endTime, &hitIndex);
+    shell->endTime = flight.time;
+    shell->endHit = hitIndex;
+}
+
+// Compute again the flights ending on a new crater, or on a destroyed tank (crater: NULL).
+// Ground and tanks are only ever removed, so no other flight can change.
+static void ReviseShells(Game *game, const Vector2 *crater)
+{
+    for (int i = 0; i < game->shellCount; i++)
+    {
+        Shell *shell = &game->shell[game->liveShell[i]];
+        bool stale = false;
+
+        if (shell->endEvent == SHELL_HIT_PLAYER) stale = !game->player[shell->endHit].isAlive;
+        else if ((shell->endEvent == SHELL_HIT_BUILDING) && (crater != NULL))
+        {
+            Vector2 nose = ShellNose(TrajectoryPosition(shell->trajectory, shell->endTime), TrajectoryVelocity(shell->trajectory, shell->endTime), shell->radius);
+
+            stale = (hypotf(nose.x - crater->x, nose.y - crater->y) <= CRATER_REACH);
+        }
+
+        if (stale) PredictShell(game, shell);
+    }
+}
+
+// End the flight of the shell of liveShell[live]: it splits, explodes or has left the screen
+static ShellEvent EndShell(Game *game, int live)
+{
+    Player *player = game->player;
+    Shell shell = game->shell[game->liveShell[live]];
+    ShellEvent event = shell.endEvent;
+
+    ReleaseShell(game, live);
+    MoveShell(&shell, shell.endTime);
+
+    if ((event == SHELL_NONE) && (shell.bomblets > 0)) SplitShell(game, &shell);
+    else if ((event == SHELL_HIT_BUILDING) && (shell.bounces > 0))
+    {
+        BounceShell(game, &shell);
+        event = SHELL_NONE;
+    }
+    else
+    {
+        if (event == SHELL_NONE) event = SHELL_MISSED;     // Still flying after MAX_FLIGHT_TIME
+
+        if ((event == SHELL_HIT_PLAYER) || (event == SHELL_HIT_BUILDING))
+        {
+            // We set the impact point
+            player[shell.owner].impactPoint = ShellNose(shell.position, shell.speed, shell.radius);
+        }
+
+        if (event == SHELL_HIT_PLAYER)
+        {
+            player[shell.endHit].lives--;
+            player[shell.endHit].isAlive = false;
+        }
+        else if (event == SHELL_HIT_BUILDING)
+        {
+            // We dig the crater (unless a streaming world has no room left for it, see cratersLost)
+            if (CarveTerrainCircle(&game->terrain, player[shell.owner].impactPoint, CRATER_RADIUS)) ReviseShells(game, &player[shell.owner].impactPoint);
+        }
+
+        ApplyRules(game);
+
+        // A tank out of lives leaves the map, the shells that were going to hit it fly on
+        if ((event == SHELL_HIT_PLAYER) && !game->gameOver && game->shellOnAir)
+        {
+            UpdateGridTanks(game);
+            ReviseShells(game, NULL);
+        }
+    }
+
+    // Last shell of the volley (or a new map): next player still in play
+    if (!game->gameOver && (game->shellCount == 0))
+    {
+        game->shellOnAir = false;
+
+        do game->playerTurn = (game->playerTurn + 1)%game->playerCount;
+        while (!player[game->playerTurn].isAlive);
+    }
+
+    return event;
+}
+
+// Replace a cluster shell by its bomblets, fanned out around its velocity
+static void SplitShell(Game *game, const Shell *shell)
+{
+    float launchTime = shell->launchTime + shell->endTime;
+
+    for (int i = 0; i < shell->bomblets; i++)
+    {
+        Vector2 velocity = shell->speed;
+
+        if (shell->bomblets > 1) velocity.x += CLUSTER_SPREAD*(2.0f*i/(shell->bomblets - 1) - 1.0f);
+
+        SpawnShell(game, shell->owner, ResumeTrajectory(shell->trajectory, shell->position, velocity), launchTime, 0, shell->bounces);
+    }
+}
+
+// Replace a shell that met a building by a slower one going away from it
+static void BounceShell(Game *game, const Shell *shell)
+{
+    SpawnShell(game, shell->owner, BounceTrajectory(game, shell), shell->launchTime + shell->endTime, 0, shell->bounces - 1);
+}
+
+// Arc of a shell bounced off the building it met, from just before the contact. The ground
+// above the nose tells a roof (vertical speed reflected) from a wall (horizontal speed reflected)
+static Trajectory BounceTrajectory(const Game *game, const Shell *shell)
+{
+    Vector2 nose = ShellNose(shell->position, shell->speed, shell->radius);
+    float speed = sqrtf(shell->speed.x*shell->speed.x + shell->speed.y*shell->speed.y);
+    Vector2 origin = shell->position;
+    Vector2 velocity = shell->speed;
+
+    if (speed > 0.0f)
+    {
+        origin.x -= shell->speed.x*BALLISTICS_MAX_STEP/speed;
+        origin.y -= shell->speed.y*BALLISTICS_MAX_STEP/speed;
+    }
+
+    if (!IsTerrainSolid(&game->terrain, (int)floorf(nose.x), (int)floorf(nose.y) - (int)BALLISTICS_MAX_STEP - 1))
+    {
+        velocity.x *= PHYSICS_BOUNCE_FRICTION;
+        velocity.y = -fabsf(velocity.y)*PHYSICS_RESTITUTION;
+    }
+    else
+    {
+        velocity.x *= -PHYSICS_RESTITUTION;
+        velocity.y *= PHYSICS_BOUNCE_FRICTION;
+    }
+
+    return ResumeTrajectory(shell->trajectory, origin, velocity);
+}
+
+// Respawn and game over rules, after each impact
+static void ApplyRules(Game *game)
+{
+    // Game over logic
+    bool leftTeamAlive = false;
+    bool rightTeamAlive = false;
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        if (!game->player[i].isAlive && game->player[i].lives > 0)
+        {
+            game->player[i].isAlive = true;
+            InitGame(game);                     // New map, the shells still in the air are gone
+        }
+        if (game->player[i].isAlive)
+        {
+            if (game->player[i].isLeftTeam) leftTeamAlive = true;
+            if (!game->player[i].isLeftTeam) rightTeamAlive = true;
+        }
+    }
+
+    if (!leftTeamAlive || !rightTeamAlive)
+    {
+        game->gameOver = true;
+
+        if (leftTeamAlive) game->winner = 1;
+        if (rightTeamAlive) game->winner = 2;
+    }
+}
+
+// Put the shell where its trajectory is at the given flight time
+PHYSICS_INLINE void MoveShellArc(Shell *shell, float time, PhysicsMode physics)
+{
+    shell->time = time;
+    shell->position = ArcPosition(shell->trajectory, time, physics);
+    shell->speed = ArcVelocity(shell->trajectory, time, physics);
+    shell->rectangle.x = shell->position.x - shell->rectangle.width/2;
+    shell->rectangle.y = shell->position.y - shell->rectangle.height/2;
+    shell->rotation = atan2(shell->speed.y, shell->speed.x)*RAD2DEG;
+}
+
+static void MoveShell(Shell *shell, float time)
+{
+    switch (shell->trajectory.physics)
+    {
+        case PHYSICS_WIND: MoveShellArc(shell, time, PHYSICS_WIND); break;
+        case PHYSICS_DRAG: MoveShellArc(shell, time, PHYSICS_DRAG); break;
+        default: MoveShellArc(shell, time, PHYSICS_CLASSIC); break;
+    }
+}
+
+// Move the shells in the air to the volley time, with the ground around them built
+PHYSICS_INLINE void MoveShellsArc(Game *game, float volleyTime, PhysicsMode physics)
+{
+    game->volleyTime = volleyTime;
+
+    for (int i = 0; i < game->shellCount; i++)
+    {
+        Shell *shell = &game->shell[game->liveShell[i]];
+
+        MoveShellArc(shell, volleyTime - shell->launchTime, physics);
+        RequireTerrain(&game->terrain, (int)shell->position.x - TERRAIN_CHUNK_WIDTH/2, (int)shell->position.x + TERRAIN_CHUNK_WIDTH/2);
+    }
+}
+
+// Every shell of a game has its physics: one loop per integrator, picked once per step
+static void MoveShells(Game *game, float volleyTime)
+{
+    switch (game->physics)
+    {
+        case PHYSICS_WIND: MoveShellsArc(game, volleyTime, PHYSICS_WIND); break;
+        case PHYSICS_DRAG: MoveShellsArc(game, volleyTime, PHYSICS_DRAG); break;
+        default: MoveShellsArc(game, volleyTime, PHYSICS_CLASSIC); break;
+    }
+}
+
+// What the shell hits at the given flight time, hitIndex is set to the tank hit
+PHYSICS_INLINE ShellEvent CheckShellCollision(const Game *game, const Shell *shell, float time, int *hitIndex, PhysicsMode physics)
+{
+    const Player *player = game->player;
+    float radius = shell->radius;
+    Vector2 position = ArcPosition(shell->trajectory, time, physics);
+
+    // Collision
+    if (position.x + radius < 0) return SHELL_MISSED;                   // These two first cases are when the shell goes out of the world, either on the left or the right
+    else if (position.x - radius > game->worldWidth) return SHELL_MISSED;
+    else if (position.y - radius > screenHeight) return SHELL_MISSED;   // Fell through the craters at the bottom of the screen
+    else if (position.y + radius < game->skyline) return SHELL_NONE;    // Above everything
+    else
+    {
+        // Broadphase: the grid cell of the shell lists the tanks it may touch
+        int column = (int)floorf(position.x/GRID_CELL_SIZE);
+        int row = (int)floorf(position.y/GRID_CELL_SIZE);
+
+        if (column < 0) column = 0;
+        if (column >= GRID_COLUMNS) column = GRID_COLUMNS - 1;
+        if (row < 0) row = 0;
+        if (row >= GRID_ROWS) row = GRID_ROWS - 1;
+
+        // Player collision, lowest index first
+        unsigned int tanks = game->grid.tanks[row][column];
+
+        for (int i = 0; tanks != 0; i++, tanks >>= 1)
+        {
+            if (!(tanks & 1)) continue;
+
+            Rectangle box = { player[i].position.x - player[i].size.x/2, player[i].position.y + player[i].size.y/2 - TANK_SPRITE_HEIGHT, player[i].size.x, TANK_SPRITE_HEIGHT };
+
+            // We can't hit ourselves: the shell flies on while in the box of its own tank
+            if (i == shell->owner)
+            {
+                if (CheckCollisionCircleRec(position, radius, box)) return SHELL_NONE;
+            }
+            else if (CheckCollisionCircleMask(position, radius, GetTankMask(player[i].isLeftTeam), (Vector2){ box.x, box.y }))
+            {
+                *hitIndex = i;
+                return SHELL_HIT_PLAYER;
+            }
+        }
+
+        // Terrain collision: the nose of the shell against the ground bitmask, craters included,
+        // only looked up below the top of the ground of its column
+        Vector2 nose = ShellNose(position, ArcVelocity(shell->trajectory, time, physics), radius);
+        int noseX = (int)floorf(nose.x);
+        int noseY = (int)floorf(nose.y);
+        int noseColumn = noseX/GRID_CELL_SIZE;
+
+        if ((noseColumn >= 0) && (noseColumn < GRID_COLUMNS) && (noseY >= game->grid.groundTop[noseColumn]) &&
+            IsTerrainSolid(&game->terrain, noseX, noseY)) return SHELL_HIT_BUILDING;
+    }
+
+    return SHELL_NONE;
+}
+
+// Front point of the shell, radius ahead of its center along its velocity
+static Vector2 ShellNose(Vector2 position, Vector2 speed, float radius)
+{
+    float length = sqrtf(speed.x*speed.x + speed.y*speed.y);
+
+    if (length <= 0.0f) return (Vector2){ position.x, position.y + radius };
+
+    return (Vector2){ position.x + speed.x*radius/length, position.y + speed.y*radius/length };
+}
+
+// Next collision test time: one small step, or straight to the skyline (or the screen edge) while the shell flies above it
+PHYSICS_INLINE float NextShellSample(const Game *game, const Shell *shell, float time, PhysicsMode physics)
+{
+    Vector2 position = ArcPosition(shell->trajectory, time, physics);
+
+    if (position.y + shell->radius < game->skyline)
+    {
+        float skylineTime = ArcTimeAtY(shell->trajectory, game->skyline - shell->radius, physics);
+        float edgeTime = ArcTimeAtX(shell->trajectory, (shell->trajectory.velocity.x > 0.0f) ? game->worldWidth + shell->radius + 1 : -shell->radius - 1, physics);
+
+        if ((edgeTime > time) && ((skylineTime < 0.0f) || (edgeTime < skylineTime))) skylineTime = edgeTime;
+        if (skylineTime > time) return skylineTime;
+    }
+
+    return ArcNextTime(shell->trajectory, time, BALLISTICS_MAX_STEP, physics);
+}
+
+// Sweep the shell up to targetTime (or its impact), only the shell is modified
+PHYSICS_INLINE ShellEvent FlyShellArc(const Game *game, Shell *shell, float targetTime, int *hitIndex, PhysicsMode physics)
+{
+    ShellEvent event = SHELL_NONE;
+
+    // Swept test: collision samples are at most BALLISTICS_MAX_STEP apart along the path, so fast shells
+    // can't go through thin buildings. Sample times only depend on the trajectory, not on deltaTime,
+    // so the shell lands on the same spot whatever the frame rate.
+    while (shell->sampleTime < targetTime)
+    {
+        float sampleTime = NextShellSample(game, shell, shell->sampleTime, physics);
+
+        if (sampleTime > targetTime) break;         // Tested by a later frame
+
+        event = CheckShellCollision(game, shell, sampleTime, hitIndex, physics);
+
+        if (event != SHELL_NONE)
+        {
+            // Refine the contact time between the last free sample and this one
+            if (event != SHELL_MISSED)
+            {
+                float freeTime = shell->sampleTime;
+
+                for (int i = 0; i < BALLISTICS_REFINE_STEPS; i++)
+                {
+                    float middleTime = (freeTime + sampleTime)/2;
+                    int middleIndex = -1;
+                    ShellEvent middleEvent = CheckShellCollision(game, shell, middleTime, &middleIndex, physics);
+
+                    if (middleEvent == SHELL_NONE) freeTime = middleTime;
+                    else
+                    {
+                        sampleTime = middleTime;
+                        event = middleEvent;
+                        *hitIndex = middleIndex;
+                    }
+                }
+            }
+
+            targetTime = sampleTime;
+            break;
+        }
+
+        shell->sampleTime = sampleTime;
+    }
+
+    MoveShellArc(shell, targetTime, physics);
+
+    return event;
+}
+
+// One flight loop per integrator, picked once per flight: the physics is a constant in each
+static ShellEvent FlyShell(const Game *game, Shell *shell, float targetTime, int *hitIndex)
+{
+    switch (shell->trajectory.physics)
+    {
+        case PHYSICS_WIND: return FlyShellArc(game, shell, targetTime, hitIndex, PHYSICS_WIND);
+        case PHYSICS_DRAG: return FlyShellArc(game, shell, targetTime, hitIndex, PHYSICS_DRAG);
+        default: return FlyShellArc(game, shell, targetTime, hitIndex, PHYSICS_CLASSIC);
+    }
+}
+
+// Xorshift on the game state, so a seed always gives the same maps
+static int GetGameRandomValue(Game *game, int min, int max)
+{
+    return GetMapRandomValue(&game->randomState, min, max);
+}
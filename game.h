@@ -0,0 +1,237 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - game core
+*
+*   Game state and rules, with no window, input or audio dependency.
+*   The windowed game (main.c) and the headless runner (headless.c) both drive this module:
+*   they decide the angle and power of each shot and call FireShell(), then step the game
+*   with StepGame() until the shell lands, or jump straight to the impact with LandShell().
+*
+*   A game holds 2 to MAX_PLAYERS tanks in two teams, and a munition can put many shells in
+*   the air at once (FireMunition()). Shells come from a fixed pool in the game state, and
+*   collisions go through a uniform grid that lists the tanks and the top of the ground
+*   under each cell, so a shell only tests what is close to it.
+*
+*   Where each shell lands is computed once, when it is launched: stepping the game only
+*   moves the shells along their closed-form arcs and applies the impacts in time order.
+*   A crater or a destroyed tank only recomputes the shells that were going to land on it.
+*   The flight loop is compiled once per integrator of ballistics.h and picked once per
+*   flight from the physics of the match, the default physics flies the gravity-only copy.
+*
+*   A world can be several screens wide (SetWorldScreens()): each map comes from its own seed
+*   (mapgen.h), and the ground is streamed in chunks (terrain.h), built around
+*   the shells by StepGame() and around the view by the renderer. Wherever they are, shells
+*   always meet the same ground.
+*
+********************************************************************************************/
+
+#ifndef GAME_H
+#define GAME_H
+
+#if defined(GAME_HEADLESS)
+    #include "headless.h"       // Null platform: raylib types and helpers, no window nor audio device
+#else
+    #include "raylib.h"
+#endif
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define MAX_BUILDINGS                    15        // Buildings of each screen
+#define MAX_WORLD_SCREENS                16        // Widest world, in screens
+#define MAX_WORLD_BUILDINGS   (MAX_BUILDINGS*MAX_WORLD_SCREENS)
+#define MIN_PLAYERS                       2
+#define MAX_PLAYERS                      16        // Tanks a game can hold, Game.playerCount are in play
+#define MAX_SHELLS                      128        // Shells in the air at once, more are not fired
+
+// Balancing values, the ones guarded by #ifndef can be set at build time for tournaments (make headless TUNING="-DLIVES=5")
+#ifndef BUILDING_RELATIVE_ERROR
+    #define BUILDING_RELATIVE_ERROR      30        // Building size random range %
+#endif
+#ifndef BUILDING_MIN_RELATIVE_HEIGHT
+    #define BUILDING_MIN_RELATIVE_HEIGHT 20        // Minimum height in % of the screenHeight
+#endif
+#ifndef BUILDING_MAX_RELATIVE_HEIGHT
+    #define BUILDING_MAX_RELATIVE_HEIGHT 60        // Maximum height in % of the screenHeight
+#endif
+#define BUILDING_MIN_GREENSCALE_COLOR    120        // Minimum gray color for the buildings
+#define BUILDING_MAX_GREENSCALE_COLOR    200        // Maximum gray color for the buildings
+
+#ifndef MIN_PLAYER_POSITION
+    #define MIN_PLAYER_POSITION           5        // Minimum x position %
+#endif
+#ifndef MAX_PLAYER_POSITION
+    #define MAX_PLAYER_POSITION          20        // Maximum x position % of a lone tank, the zone of a team grows with its tanks
+#endif
+#ifndef MAX_TEAM_POSITION
+    #define MAX_TEAM_POSITION            45        // Maximum x position % of a whole team
+#endif
+
+#ifndef MAP_MIN_REACH_ANGLES
+    #define MAP_MIN_REACH_ANGLES          3        // Fairness: launch angles each tank must be able to hit an enemy with
+#endif
+#ifndef MAP_MAX_HEIGHT_GAP
+    #define MAP_MAX_HEIGHT_GAP           25        // Fairness: largest gap between the average heights of the teams, % of the screenHeight
+#endif
+#define MAP_MAX_ATTEMPTS                 16        // Maps drawn for a seed before settling for an unfair one
+
+#ifndef GRAVITY
+    #define GRAVITY                   9.81f
+#endif
+#define DELTA_FPS                        60        // Frame rate the arcs were tuned at, only a unit now (see SHELL_GRAVITY)
+#ifndef LIVES
+    #define LIVES                         3
+#endif
+
+#define TANK_SIZE                        50        // Tank width and height, where it stands on its building
+#define TANK_SPRITE_HEIGHT               30        // Height of the tank sprites, the tank hitbox uses it
+
+#define MAX_FLIGHT_TIME              600.0f        // Seconds, LandShell() flies the shell at most this long
+#define MAX_SHOT_ARCS     (PHYSICS_BOUNCES + 1)     // Arcs of a single shot: the launch, then one per bounce (TraceShot())
+
+#define SHELL_RADIUS                     10
+
+#define CLUSTER_MIN_SPLIT_TIME        0.25f        // A cluster shell splits at the top of its arc, or this long after launch if later
+#define CLUSTER_SPREAD                80.0f        // Horizontal speed (px/s) between the outer bomblets and the shell
+
+#define GRID_CELL_SIZE                   64        // Collision grid cell (px)
+#define GRID_COLUMNS       ((TERRAIN_MAX_WIDTH + GRID_CELL_SIZE - 1)/GRID_CELL_SIZE)
+#define GRID_ROWS         ((TERRAIN_HEIGHT + GRID_CELL_SIZE - 1)/GRID_CELL_SIZE)
+
+#include "ballistics.h"
+#include "terrain.h"
+#include "mapgen.h"
+
+#include <stddef.h>
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct Player {
+    Vector2 position;
+    Vector2 size;
+
+    Vector2 aimingPoint;
+    int aimingAngle;
+    int aimingPower;
+
+    Vector2 previousPoint;
+    int previousAngle;
+    int previousPower;
+
+    Vector2 impactPoint;
+
+    bool isLeftTeam;                // This player belongs to the left or to the right team
+    bool isPlayer;                  // If is a player or an AI, kept across maps and matches
+    bool isAlive;
+    int lives;
+} Player;
+
+// What happened to the shell during the last step, in increasing order of importance
+typedef enum ShellEvent {
+    SHELL_NONE = 0,                 // No shell in the air, or it is still flying
+    SHELL_MISSED,                   // The shell left the screen
+    SHELL_HIT_BUILDING,             // The shell exploded against a building
+    SHELL_HIT_PLAYER                // The shell destroyed a tank
+} ShellEvent;
+
+typedef struct Shell {
+    Vector2 position;
+    Vector2 speed;                  // Current velocity (px/s)
+    int radius;
+    bool active;
+    double rotation;
+    int length;
+    Rectangle rectangle;
+
+    Trajectory trajectory;          // Launch state, position and speed are computed from it
+    float time;                     // Flight time (s)
+    float sampleTime;               // Flight time of the last collision test, on a grid that only depends on the trajectory
+
+    int owner;                      // Player who fired it, its own tank does not stop it
+    int bomblets;                   // Splits into this many bomblets instead of landing (cluster munitions)
+    int bounces;                    // Bounces off the buildings left before it explodes (PHYSICS_BOUNCE)
+    float launchTime;               // Volley time of the launch, bomblets are launched mid-volley
+
+    float endTime;                  // Flight time of the impact (or of the split), computed at launch
+    ShellEvent endEvent;            // What happens then, SHELL_NONE: the cluster splits
+    int endHit;                     // Tank hit
+} Shell;
+
+// What a shot fires
+typedef enum Munition {
+    MUNITION_SHELL = 0,             // One shell
+    MUNITION_VOLLEY,                // A fan of shells
+    MUNITION_CLUSTER,               // One shell splitting into bomblets at the top of its arc
+    MUNITION_BARRAGE,               // A fan of cluster shells, fills the shell pool
+    MUNITION_COUNT
+} Munition;
+
+// Uniform grid over the world, the broadphase of the shell collisions
+typedef struct CollisionGrid {
+    unsigned short tanks[GRID_ROWS][GRID_COLUMNS];  // Bit i: a shell centered in the cell may touch tank i
+    int groundTop[GRID_COLUMNS];                    // Highest ground row of each column of cells (craters only dig below it)
+} CollisionGrid;
+
+// Whole game state: everything a round needs lives here, so several games can run side by side
+typedef struct Game {
+    Player player[MAX_PLAYERS];
+    int playerCount;                // Tanks in play, even ones in the left team (0 is played as MIN_PLAYERS)
+    int worldScreens;               // World width in screens, see SetWorldScreens() (0 is played as 1)
+    int worldWidth;                 // In pixels, set by InitGame()
+    PhysicsMode physics;            // Shell physics of the match, see SetPhysicsMode()
+    float wind;                     // Horizontal acceleration of the shells on this map (px/s^2), PHYSICS_WIND only
+    Building building[MAX_WORLD_BUILDINGS];        // In x order
+    int buildingCount;
+    Terrain terrain;                // Buildings with their craters, what the shell collides with
+    CollisionGrid grid;
+    float skyline;                  // Highest point of the buildings and tanks, nothing can be hit above it
+
+    Shell shell[MAX_SHELLS];        // Shell pool, the shells in the air are listed in liveShell
+    int liveShell[MAX_SHELLS];
+    int shellCount;                 // Shells in the air
+    int freeShell[MAX_SHELLS];      // Pool slots not in use
+    int freeCount;
+    float volleyTime;               // Time since the current player fired (s)
+
+    int playerTurn;
+    bool shellOnAir;                // Shells of the current player are in the air
+    bool gameOver;
+    int winner;                     // 1: left (blue) team, 2: right (red) team
+    int round;                      // Number of maps played since InitLives()
+
+    unsigned int randomState;       // Seeds of the maps, see SeedGame()
+    MapParams mapParams;            // Maps of the game, all zero: GetDefaultMapParams()
+    unsigned int mapSeed;           // Seed of the map in play
+    unsigned int previousMapSeed;   // and of the one before, InitPreviousMap()
+} Game;
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static const int screenWidth = 1280;
+static const int screenHeight = 720;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void SeedGame(Game *game, unsigned int seed);          // Seed the map generator: same seed and same shots, same match
+void SetPlayerCount(Game *game, int count);             // Number of tanks of the next match, before InitLives()
+void SetWorldScreens(Game *game, int screens);          // World width of the next maps, before InitGame()
+void SetMapParams(Game *game, const MapParams *params);    // Maps of the next InitGame() calls, NULL: the defaults
+void SetPhysicsMode(Game *game, PhysicsMode physics);   // Shell physics of the next match, before InitGame()
+void InitGame(Game *game);                              // Generate a new map and place the tanks, lives are kept
+void InitGameMap(Game *game, unsigned int mapSeed);     // Same with the map of a seed (rotations, restarts)
+void InitPreviousMap(Game *game);                       // Back to the map played before this one
+void InitLives(Game *game);                             // Reset the lives of every player and start a new match
+bool FireShell(Game *game, int angle, int power);       // Current player fires, returns false if its shells are already in the air
+bool FireMunition(Game *game, int angle, int power, Munition munition);    // Same as FireShell() with any munition
+const char *GetMunitionName(Munition munition);
+ShellEvent StepGame(Game *game, float deltaTime);       // Move the shells deltaTime seconds and apply the turn and game over rules, returns the main event
+ShellEvent LandShell(Game *game);                       // Move the shells straight to where they land and apply the rules
+ShellEvent SimulateShot(const Game *game, int angle, int power, Vector2 *impactPoint, int *hitIndex);   // Where a shot of the current player would land, read-only
+ShellEvent TraceShot(const Game *game, int angle, int power, Trajectory *trajectory, float *flightTime, int *arcCount);   // Arcs of the same shot (MAX_SHOT_ARCS at most) and their flight times up to the impact, read-only
+unsigned int GetGameChecksum(const Game *game);         // Hash of the state the next shots depend on, two games in step have the same
+unsigned int HashBytes(unsigned int hash, const void *data, size_t size);   // FNV-1a, from 2166136261u: checksums and keys of every module
+
+#endif // GAME_H
@@ -0,0 +1,1213 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - headless runner
+*
+*   Plays whole matches with the game core only: no window, no input, no audio device.
+*   The tanks are driven by a simple gunner through FireShell(): it picks an angle per round
+*   and corrects its power from where its previous shell landed on the closest enemy, like a
+*   human player would.
+*   This is enough for balancing statistics and regression runs on machines without a display.
+*   The tanks can also be played by the AI (ai.c), without time budget so runs stay reproducible.
+*
+*   Usage: headless [matches] [seed] [0: gunner, 1: easy AI, 2: medium AI, 3: hard AI] [players] [screens] [physics]
+*          headless bench [shells] [seed]      Shell throughput, SimulateShot() against shellbatch.c
+*          headless barrage [volleys] [players] [seed]     Step time with the whole shell pool in the air
+*          headless replay file...             Replay recorded matches at full speed and check their outcome
+*          headless net [matches] [seed] [players] [loss %] [screens] [physics]    Lockstep play between two peers over a loopback link
+*          headless rollback [matches] [seed] [players] [screens]       Roll matches back to earlier turns and play them again
+*          headless tournament [matches] [seed] [threads] [players] [screens] [AI level 1-3] [physics]   AI matches on every core, balancing statistics
+*          headless maps [maps] [seed] [players] [screens] [rotation]    Map generator: fairness rejections, generation and cache times
+*
+*   [physics] is 0: classic, 1: wind, 2: drag, 3: low gravity, 4: bounce (PhysicsMode of ballistics.h)
+*
+********************************************************************************************/
+
+#include "game.h"
+#include "ai.h"
+#include "shellbatch.h"
+#include "replay.h"
+#include "net.h"
+#include "snapshot.h"
+#include "scheduler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define DEFAULT_MATCHES               10000
+#define MAX_TURNS_PER_ROUND             500        // A round nobody can win is dropped and the map regenerated
+
+#define GUNNER_MIN_ANGLE                 30
+#define GUNNER_MAX_ANGLE                 75
+#define GUNNER_MIN_POWER                 50
+#define GUNNER_MAX_POWER               1000
+#define GUNNER_ERROR                     10        // Random power error, in % of the corrected power
+
+#define DEFAULT_BENCH_SHELLS         200000
+#define BENCH_MIN_POWER                  50
+#define BENCH_MAX_POWER                1000
+
+#define DEFAULT_BARRAGE_VOLLEYS         200
+#define BARRAGE_STEP            (1.0f/120)        // Physics step of the windowed game
+#define BARRAGE_FRAME_BUDGET    (1000.0/60)        // ms
+
+#define DEFAULT_NET_MATCHES             100
+#define NET_STALL_UPDATES              1000        // Network updates without a turn before a run is declared stalled
+
+#define DEFAULT_ROLLBACK_MATCHES        100
+#define ROLLBACK_RING                    16        // Turns kept
+#define ROLLBACK_INTERVAL                 7        // Turns between two rollbacks
+#define ROLLBACK_FILE      "rollback-check.tds"     // Resume file round trip, removed afterwards
+#define ROLLBACK_FILE_TURN                3        // Turn of the first round it is made at
+
+#define DEFAULT_TOURNAMENT_MATCHES     1000
+#define DEFAULT_TOURNAMENT_LEVEL          2        // Medium AI
+#define POSITION_STEP                     5        // Start position classes, in % of the world width from the own edge
+#define POSITION_CLASSES                 10
+#define CACHE_LINE_SIZE                  64
+
+#define DEFAULT_MAPS                   1000
+#define DEFAULT_ROTATION                  8        // Maps of the rotation played again from the cache
+#define ROTATION_LOOPS                  100
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct Gunner {
+    int angle;
+    float power;
+} Gunner;
+
+// Tournament results, each thread adds up its own and they are summed once every match is played
+typedef struct TournamentStats {
+    long long matches;
+    long long wins[2];              // Blue, red
+    long long firstWins;            // Matches won by the team that fired first
+    long long rounds;
+    long long droppedRounds;
+    long long turns;
+    long long missed;               // Shells that left the screen
+    long long kills;                // Enemy tanks destroyed
+    long long friendlyKills;
+    long long killTurns;            // Turns from the start of the map or the previous kill, summed over the kills
+    long long positionTanks[POSITION_CLASSES];     // Tanks placed in each start position class
+    long long positionKills[POSITION_CLASSES];     // Kills by a tank of the class
+    long long positionDeaths[POSITION_CLASSES];    // Kills of a tank of the class
+    char padding[CACHE_LINE_SIZE];  // The counters of two threads never share a cache line
+} TournamentStats;
+
+typedef struct Tournament {
+    unsigned int seed;
+    int players;
+    int screens;
+    PhysicsMode physics;
+    AIConfig config;
+    Game *game[MAX_JOB_THREADS];    // One per thread, allocated by its first match
+    TournamentStats stats[MAX_JOB_THREADS];
+} Tournament;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void InitGunners(Gunner *gunner, int count);
+static void AimGunner(const Game *game, Gunner *gunner, ShellEvent lastEvent);
+static int RunShellBenchmark(int shells, unsigned int seed);
+static int RunBarrageBenchmark(int volleys, int players, unsigned int seed);
+static int RunReplays(int count, char *fileName[]);
+static int RunNetMatches(int matches, unsigned int seed, int players, int lossPercent, int screens, PhysicsMode physics);
+static int RunRollbacks(int matches, unsigned int seed, int players, int screens);
+static int RunTournament(int matches, unsigned int seed, int threads, int players, int screens, int aiLevel, PhysicsMode physics);
+static void PlayTournamentMatch(int match, int thread, void *context);
+static int RunMaps(int maps, unsigned int seed, int players, int screens, int rotation);
+static void ClassifyPositions(const Game *game, int *positionClass);
+static unsigned int MixSeed(unsigned int seed, unsigned int value);
+
+//------------------------------------------------------------------------------------
+// Program main entry point
+//------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0))
+    {
+        int shells = (argc > 2) ? atoi(argv[2]) : DEFAULT_BENCH_SHELLS;
+        unsigned int seed = (argc > 3) ? (unsigned int)strtoul(argv[3], NULL, 10) : (unsigned int)time(NULL);
+
+        if (shells <= 0)
+        {
+            fprintf(stderr, "Usage: %s bench [shells] [seed]\n", argv[0]);
+            return 1;
+        }
+
+        return RunShellBenchmark(shells, seed);
+    }
+
+    if ((argc > 1) && (strcmp(argv[1], "barrage") == 0))
+    {
+        int volleys = (argc > 2) ? atoi(argv[2]) : DEFAULT_BARRAGE_VOLLEYS;
+        int players = (argc > 3) ? atoi(argv[3]) : MAX_PLAYERS;
+        unsigned int seed = (argc > 4) ? (unsigned int)strtoul(argv[4], NULL, 10) : (unsigned int)time(NULL);
+
+        if ((volleys <= 0) || (players < MIN_PLAYERS) || (players > MAX_PLAYERS))
+        {
+            fprintf(stderr, "Usage: %s barrage [volleys] [players %i-%i] [seed]\n", argv[0], MIN_PLAYERS, MAX_PLAYERS);
+            return 1;
+        }
+
+        return RunBarrageBenchmark(volleys, players, seed);
+    }
+
+    if ((argc > 1) && (strcmp(argv[1], "replay") == 0))
+    {
+        if (argc < 3)
+        {
+            fprintf(stderr, "Usage: %s replay file...\n", argv[0]);
+            return 1;
+        }
+
+        return RunReplays(argc - 2, argv + 2);
+    }
+
+    if ((argc > 1) && (strcmp(argv[1], "net") == 0))
+    {
+        int matches = (argc > 2) ? atoi(argv[2]) : DEFAULT_NET_MATCHES;
+        unsigned int seed = (argc > 3) ? (unsigned int)strtoul(argv[3], NULL, 10) : (unsigned int)time(NULL);
+        int players = (argc > 4) ? atoi(argv[4]) : MIN_PLAYERS;
+        int lossPercent = (argc > 5) ? atoi(argv[5]) : 0;
+        int screens = (argc > 6) ? atoi(argv[6]) : 1;
+        int physics = (argc > 7) ? atoi(argv[7]) : PHYSICS_CLASSIC;
+
+        if ((matches <= 0) || (players < MIN_PLAYERS) || (players > MAX_PLAYERS) || (lossPercent < 0) || (lossPercent > 90) || (screens < 1) || (screens > MAX_WORLD_SCREENS) ||
+            (physics < 0) || (physics >= PHYSICS_COUNT))
+        {
+            fprintf(stderr, "Usage: %s net [matches] [seed] [players %i-%i] [loss %% 0-90] [screens 1-%i] [physics 0-%i]\n", argv[0], MIN_PLAYERS, MAX_PLAYERS, MAX_WORLD_SCREENS, PHYSICS_COUNT - 1);
+            return 1;
+        }
+
+        return RunNetMatches(matches, seed, players, lossPercent, screens, (PhysicsMode)physics);
+    }
+
+    if ((argc > 1) && (strcmp(argv[1], "rollback") == 0))
+    {
+        int matches = (argc > 2) ? atoi(argv[2]) : DEFAULT_ROLLBACK_MATCHES;
+        unsigned int seed = (argc > 3) ? (unsigned int)strtoul(argv[3], NULL, 10) : (unsigned int)time(NULL);
+        int players = (argc > 4) ? atoi(argv[4]) : MIN_PLAYERS;
+        int screens = (argc > 5) ? atoi(argv[5]) : 1;
+
+        if ((matches <= 0) || (players < MIN_PLAYERS) || (players > MAX_PLAYERS) || (screens < 1) || (screens > MAX_WORLD_SCREENS))
+        {
+            fprintf(stderr, "Usage: %s rollback [matches] [seed] [players %i-%i] [screens 1-%i]\n", argv[0], MIN_PLAYERS, MAX_PLAYERS, MAX_WORLD_SCREENS);
+            return 1;
+        }
+
+        return RunRollbacks(matches, seed, players, screens);
+    }
+
+    if ((argc > 1) && (strcmp(argv[1], "tournament") == 0))
+    {
+        int matches = (argc > 2) ? atoi(argv[2]) : DEFAULT_TOURNAMENT_MATCHES;
+        unsigned int seed = (argc > 3) ? (unsigned int)strtoul(argv[3], NULL, 10) : (unsigned int)time(NULL);
+        int threads = (argc > 4) ? atoi(argv[4]) : 0;
+        int players = (argc > 5) ? atoi(argv[5]) : MIN_PLAYERS;
+        int screens = (argc > 6) ? atoi(argv[6]) : 1;
+        int aiLevel = (argc > 7) ? atoi(argv[7]) : DEFAULT_TOURNAMENT_LEVEL;
+        int physics = (argc > 8) ? atoi(argv[8]) : PHYSICS_CLASSIC;
+
+        if ((matches <= 0) || (threads < 0) || (threads > MAX_JOB_THREADS) || (players < MIN_PLAYERS) || (players > MAX_PLAYERS) ||
+            (screens < 1) || (screens > MAX_WORLD_SCREENS) || (aiLevel < 1) || (aiLevel > AI_LEVEL_COUNT) || (physics < 0) || (physics >= PHYSICS_COUNT))
+        {
+            fprintf(stderr, "Usage: %s tournament [matches] [seed] [threads 0-%i, 0: every core] [players %i-%i] [screens 1-%i] [1: easy AI, 2: medium AI, 3: hard AI] [physics 0-%i]\n",
+                    argv[0], MAX_JOB_THREADS, MIN_PLAYERS, MAX_PLAYERS, MAX_WORLD_SCREENS, PHYSICS_COUNT - 1);
+            return 1;
+        }
+
+        return RunTournament(matches, seed, threads, players, screens, aiLevel, (PhysicsMode)physics);
+    }
+
+    if ((argc > 1) && (strcmp(argv[1], "maps") == 0))
+    {
+        int maps = (argc > 2) ? atoi(argv[2]) : DEFAULT_MAPS;
+        unsigned int seed = (argc > 3) ? (unsigned int)strtoul(argv[3], NULL, 10) : (unsigned int)time(NULL);
+        int players = (argc > 4) ? atoi(argv[4]) : MIN_PLAYERS;
+        int screens = (argc > 5) ? atoi(argv[5]) : 1;
+        int rotation = (argc > 6) ? atoi(argv[6]) : DEFAULT_ROTATION;
+
+        if ((maps <= 0) || (players < MIN_PLAYERS) || (players > MAX_PLAYERS) || (screens < 1) || (screens > MAX_WORLD_SCREENS) || (rotation < 1) || (rotation > MAP_CACHE_SIZE))
+        {
+            fprintf(stderr, "Usage: %s maps [maps] [seed] [players %i-%i] [screens 1-%i] [rotation 1-%i]\n", argv[0], MIN_PLAYERS, MAX_PLAYERS, MAX_WORLD_SCREENS, MAP_CACHE_SIZE);
+            return 1;
+        }
+
+        return RunMaps(maps, seed, players, screens, rotation);
+    }
+
+    int matches = (argc > 1) ? atoi(argv[1]) : DEFAULT_MATCHES;
+    unsigned int seed = (argc > 2) ? (unsigned int)strtoul(argv[2], NULL, 10) : (unsigned int)time(NULL);
+    int aiLevel = (argc > 3) ? atoi(argv[3]) : 0;
+    int players = (argc > 4) ? atoi(argv[4]) : MIN_PLAYERS;
+    int screens = (argc > 5) ? atoi(argv[5]) : 1;
+    int physics = (argc > 6) ? atoi(argv[6]) : PHYSICS_CLASSIC;
+
+    if ((matches <= 0) || (aiLevel < 0) || (aiLevel > AI_LEVEL_COUNT) || (players < MIN_PLAYERS) || (players > MAX_PLAYERS) || (screens < 1) || (screens > MAX_WORLD_SCREENS) ||
+        (physics < 0) || (physics >= PHYSICS_COUNT))
+    {
+        fprintf(stderr, "Usage: %s [matches] [seed] [0: gunner, 1: easy AI, 2: medium AI, 3: hard AI] [players %i-%i] [screens 1-%i] [physics 0-%i]\n", argv[0], MIN_PLAYERS, MAX_PLAYERS, MAX_WORLD_SCREENS, PHYSICS_COUNT - 1);
+        fprintf(stderr, "       %s bench [shells] [seed]\n", argv[0]);
+        fprintf(stderr, "       %s barrage [volleys] [players] [seed]\n", argv[0]);
+        fprintf(stderr, "       %s replay file...\n", argv[0]);
+        fprintf(stderr, "       %s net [matches] [seed] [players] [loss %%] [screens] [physics]\n", argv[0]);
+        fprintf(stderr, "       %s rollback [matches] [seed] [players] [screens]\n", argv[0]);
+        fprintf(stderr, "       %s tournament [matches] [seed] [threads] [players] [screens] [AI level] [physics]\n", argv[0]);
+        fprintf(stderr, "       %s maps [maps] [seed] [players] [screens] [rotation]\n", argv[0]);
+        return 1;
+    }
+
+    srand(seed);
+
+    AIConfig aiConfig = { 0 };
+
+    if (aiLevel > 0)
+    {
+        aiConfig = GetAIConfig(aiLevel - 1);
+        aiConfig.timeBudget = 0.0f;
+        InitAI(0);
+    }
+
+    static Game game = { 0 };
+
+    long long rounds = 0;
+    long long turns = 0;
+    long long droppedRounds = 0;
+    int wins[2] = { 0 };
+
+    double startTime = GetTime();
+
+    for (int match = 0; match < matches; match++)
+    {
+        SeedGame(&game, (unsigned int)rand());
+        SetPlayerCount(&game, players);
+        SetWorldScreens(&game, screens);
+        SetPhysicsMode(&game, (PhysicsMode)physics);
+        InitLives(&game);
+        InitGame(&game);
+
+        Gunner gunner[MAX_PLAYERS] = { 0 };
+        ShellEvent lastEvent[MAX_PLAYERS] = { SHELL_NONE };
+
+        InitGunners(gunner, game.playerCount);
+
+        int roundTurns = 0;
+        int round = game.round;
+
+        while (!game.gameOver)
+        {
+            int shooter = game.playerTurn;
+
+            if (aiLevel > 0)
+            {
+                int angle = 0;
+                int power = 0;
+
+                AIChooseShot(&game, aiConfig, &angle, &power);
+                FireShell(&game, angle, power);
+            }
+            else
+            {
+                AimGunner(&game, &gunner[shooter], lastEvent[shooter]);
+                FireShell(&game, gunner[shooter].angle, (int)gunner[shooter].power);
+            }
+            turns++;
+            roundTurns++;
+
+            lastEvent[shooter] = LandShell(&game);
+
+            if (game.round != round)
+            {
+                round = game.round;
+                roundTurns = 0;
+                InitGunners(gunner, game.playerCount);
+            }
+            else if (roundTurns >= MAX_TURNS_PER_ROUND)
+            {
+                droppedRounds++;
+                roundTurns = 0;
+                InitGame(&game);
+                round = game.round;
+                InitGunners(gunner, game.playerCount);
+            }
+        }
+
+        rounds += game.round;
+        wins[game.winner - 1]++;
+    }
+
+    double elapsed = GetTime() - startTime;
+    if (elapsed <= 0.0) elapsed = 1e-9;
+
+    if (aiLevel > 0) CloseAI();
+
+    printf("seed:           %u\n", seed);
+    printf("players:        %i %s\n", players, (aiLevel > 0) ? GetAILevelName(aiLevel - 1) : "gunner");
+    printf("world:          %i screen%s, %s physics\n", screens, (screens > 1) ? "s" : "", GetPhysicsName((PhysicsMode)physics));
+    printf("matches:        %i (blue %i, red %i)\n", matches, wins[0], wins[1]);
+    printf("rounds:         %lli (%lli dropped after %i turns)\n", rounds, droppedRounds, MAX_TURNS_PER_ROUND);
+    printf("turns:          %lli\n", turns);
+    printf("elapsed:        %.3f s\n", elapsed);
+    printf("rounds/sec:     %.0f\n", rounds/elapsed);
+    printf("matches/sec:    %.0f\n", matches/elapsed);
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+// Pick a new angle for every gunner and reset their power (new map)
+static void InitGunners(Gunner *gunner, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        gunner[i].angle = GetRandomValue(GUNNER_MIN_ANGLE, GUNNER_MAX_ANGLE);
+        gunner[i].power = 0.0f;
+    }
+}
+
+// Correct the power of the gunner from where its previous shell landed, aiming at the closest enemy
+static void AimGunner(const Game *game, Gunner *gunner, ShellEvent lastEvent)
+{
+    const Player *shooter = &game->player[game->playerTurn];
+    float distance = (float)game->worldWidth;
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Player *target = &game->player[i];
+
+        if (target->isAlive && (target->isLeftTeam != shooter->isLeftTeam)) distance = fminf(distance, fabsf(target->position.x - shooter->position.x));
+    }
+
+    if (gunner->power <= 0.0f)
+    {
+        // First shot: flat ground range formula, range = v^2*sin(2*angle)/g
+        float speed = sqrtf(distance*SHELL_GRAVITY/sinf(2*gunner->angle*DEG2RAD));
+        gunner->power = speed/SHELL_SPEED_SCALE;
+    }
+    else if (lastEvent == SHELL_MISSED)
+    {
+        gunner->power *= 0.8f;                                          // Flew over the screen edge
+    }
+    else
+    {
+        float reached = fabsf(shooter->impactPoint.x - shooter->position.x);
+
+        if (reached < 1.0f) reached = 1.0f;
+
+        // Range grows with the square of the power
+        float correction = sqrtf(distance/reached);
+
+        if (correction > 1.5f) correction = 1.5f;
+        if (correction < 0.67f) correction = 0.67f;
+
+        // Stuck behind a building: lob the next shells higher
+        if ((correction > 1.2f) && (gunner->angle < GUNNER_MAX_ANGLE)) gunner->angle += 5;
+
+        gunner->power *= correction;
+    }
+
+    gunner->power *= (100.0f + GetRandomValue(-GUNNER_ERROR, GUNNER_ERROR))/100.0f;
+
+    if (gunner->power < GUNNER_MIN_POWER) gunner->power = GUNNER_MIN_POWER;
+    if (gunner->power > GUNNER_MAX_POWER) gunner->power = GUNNER_MAX_POWER;
+}
+
+// Fly the same random shots with SimulateShot() and with the batch kernel on every instruction set
+static int RunShellBenchmark(int shells, unsigned int seed)
+{
+    static Game game = { 0 };
+
+    srand(seed);
+    SeedGame(&game, seed);
+    InitLives(&game);
+    InitGame(&game);
+
+    const Player *shooter = &game.player[game.playerTurn];
+    int *angle = (int *)malloc(shells*sizeof(int));
+    int *power = (int *)malloc(shells*sizeof(int));
+    int *event = (int *)malloc(shells*sizeof(int));
+    ShellBatch batch = LoadShellBatch(shells);
+
+    for (int i = 0; i < shells; i++)
+    {
+        angle[i] = GetRandomValue(0, 90);
+        power[i] = GetRandomValue(BENCH_MIN_POWER, BENCH_MAX_POWER);
+    }
+
+    double startTime = GetTime();
+
+    for (int i = 0; i < shells; i++) event[i] = SimulateShot(&game, angle[i], power[i], NULL, NULL);
+
+    double exactTime = GetTime() - startTime;
+    if (exactTime <= 0.0) exactTime = 1e-9;
+
+    printf("seed:           %u\n", seed);
+    printf("shells:         %i\n", shells);
+    printf("SimulateShot:   %.0f shells/sec\n", shells/exactTime);
+
+    ShellBatchISA supported = SetShellBatchISA(SHELL_BATCH_AVX2);
+
+    for (int isa = SHELL_BATCH_SCALAR; isa <= (int)supported; isa++)
+    {
+        SetShellBatchISA(isa);
+        ClearShellBatch(&batch);
+
+        for (int i = 0; i < shells; i++) AddShellToBatch(&batch, LaunchTrajectory(shooter->position, angle[i], power[i], shooter->isLeftTeam, game.physics, game.wind));
+
+        startTime = GetTime();
+        int flying = SimulateShellBatch(&batch, &game, SHELL_BATCH_STEP, (int)(MAX_FLIGHT_TIME/SHELL_BATCH_STEP));
+        double batchTime = GetTime() - startTime;
+        if (batchTime <= 0.0) batchTime = 1e-9;
+
+        int agree = 0;
+        for (int i = 0; i < shells; i++) agree += (batch.event[i] == event[i]);
+
+        printf("batch %-8s  %.0f shells/sec (x%.1f), %.2f%% same event, %i still flying\n", GetShellBatchISAName(isa),
+               shells/batchTime, exactTime/batchTime, 100.0*agree/shells, flying);
+    }
+
+    UnloadShellBatch(&batch);
+    free(angle);
+    free(power);
+    free(event);
+
+    return 0;
+}
+
+// Fire barrages turn after turn, every shell of the pool in the air, and time each physics step of their flights
+static int RunBarrageBenchmark(int volleys, int players, unsigned int seed)
+{
+    static Game game = { 0 };
+
+    srand(seed);
+    SeedGame(&game, seed);
+    SetPlayerCount(&game, players);
+    InitLives(&game);
+    InitGame(&game);
+
+    Gunner gunner[MAX_PLAYERS] = { 0 };
+    ShellEvent lastEvent[MAX_PLAYERS] = { SHELL_NONE };
+    int round = game.round;
+
+    InitGunners(gunner, game.playerCount);
+
+    long long steps = 0;
+    int peakShells = 0;
+    double totalTime = 0.0;
+    double worstTime = 0.0;
+
+    for (int volley = 0; volley < volleys; volley++)
+    {
+        if (game.gameOver)
+        {
+            InitLives(&game);
+            InitGame(&game);
+        }
+
+        if (game.round != round)
+        {
+            round = game.round;
+            InitGunners(gunner, game.playerCount);
+        }
+
+        int shooter = game.playerTurn;
+
+        AimGunner(&game, &gunner[shooter], lastEvent[shooter]);
+
+        // The launch computes where every shell lands: counted in the first step
+        double startTime = GetTime();
+        FireMunition(&game, gunner[shooter].angle, (int)gunner[shooter].power, MUNITION_BARRAGE);
+
+        while (game.shellOnAir && !game.gameOver)
+        {
+            if (game.shellCount > peakShells) peakShells = game.shellCount;
+
+            ShellEvent event = StepGame(&game, BARRAGE_STEP);
+            double stepTime = GetTime() - startTime;
+
+            if (event != SHELL_NONE) lastEvent[shooter] = event;
+
+            totalTime += stepTime;
+            if (stepTime > worstTime) worstTime = stepTime;
+            steps++;
+
+            startTime = GetTime();
+        }
+    }
+
+    if (steps == 0) steps = 1;
+
+    printf("seed:           %u\n", seed);
+    printf("players:        %i\n", players);
+    printf("volleys:        %i (%s)\n", volleys, GetMunitionName(MUNITION_BARRAGE));
+    printf("peak shells:    %i (pool %i)\n", peakShells, MAX_SHELLS);
+    printf("steps:          %lli of %.2f ms\n", steps, BARRAGE_STEP*1000.0);
+    printf("step time:      %.3f ms avg, %.3f ms max (frame budget %.2f ms)\n", totalTime*1000.0/steps, worstTime*1000.0, BARRAGE_FRAME_BUDGET);
+
+    return 0;
+}
+
+// Replay every file as fast as possible, the recorded outcome must come out again
+static int RunReplays(int count, char *fileName[])
+{
+    static Game game = { 0 };
+    Replay replay = { 0 };
+
+    long long inputs = 0;
+    int failed = 0;
+    double elapsed = 0.0;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!LoadReplay(&replay, fileName[i]))
+        {
+            printf("%s: not a replay of version %i\n", fileName[i], REPLAY_VERSION);
+            failed++;
+            continue;
+        }
+
+        double startTime = GetTime();
+        bool same = PlayReplay(&replay, &game);
+        elapsed += GetTime() - startTime;
+
+        inputs += replay.inputCount;
+
+        if (!same)
+        {
+            printf("%s: MISMATCH, recorded winner %i after %i rounds, replayed winner %i after %i rounds\n",
+                   fileName[i], replay.winner, replay.rounds, game.winner, game.round);
+            failed++;
+        }
+    }
+
+    UnloadReplay(&replay);
+
+    if (elapsed <= 0.0) elapsed = 1e-9;
+
+    printf("replays:        %i (%i failed)\n", count, failed);
+    printf("inputs:         %lli\n", inputs);
+    printf("elapsed:        %.3f s\n", elapsed);
+    printf("matches/sec:    %.0f\n", (count - failed)/elapsed);
+
+    return (failed > 0) ? 1 : 0;
+}
+
+// Play matches between a host and a client over a lossy loopback link: each peer fires with the
+// gunner for its own team and simulates the whole game, only the inputs go through the link
+static int RunNetMatches(int matches, unsigned int seed, int players, int lossPercent, int screens, PhysicsMode physics)
+{
+    static Game game[2] = { 0 };
+    static NetSession net[2] = { 0 };
+    Replay replay[2] = { 0 };
+    Transport transport[2] = { 0 };
+
+    srand(seed);
+    OpenLoopback(&transport[0], &transport[1], lossPercent, seed);
+    InitNetSession(&net[0], transport[0], true);
+    InitNetSession(&net[1], transport[1], false);
+
+    double netTime = 0.0;           // Simulated clock of the link, a resend period per update
+    long long turns = 0;
+    int desyncs = 0;
+    int mismatches = 0;
+    bool stalled = false;
+
+    // Matches no game can start from, sent first: the client must drop every one of them
+    static const int badMatch[][4] = {      // Players, first turn, screens, physics
+        { 4, 4, 1, 0 }, { 2, 255, 1, 0 }, { 1, 0, 1, 0 }, { MAX_PLAYERS + 1, 0, 1, 0 },
+        { 2, 0, 0, 0 }, { 2, 0, MAX_WORLD_SCREENS + 1, 0 }, { 2, 0, 1, PHYSICS_COUNT }
+    };
+    int badCount = (int)(sizeof(badMatch)/sizeof(badMatch[0]));
+    int badAccepted = 0;
+
+    for (int i = 0; i < badCount; i++)
+    {
+        Replay bad = { 0 };
+
+        bad.playerCount = badMatch[i][0];
+        bad.firstTurn = badMatch[i][1];
+        bad.screens = badMatch[i][2];
+        bad.physics = (PhysicsMode)badMatch[i][3];
+
+        SendNetMatch(&net[0], &bad);
+    }
+
+    for (int updates = 0; (net[0].ackedCount != net[0].sentCount) && !stalled; updates++)
+    {
+        netTime += NET_RESEND_TIME;
+        UpdateNet(&net[0], netTime);
+        UpdateNet(&net[1], netTime);
+
+        stalled = (updates > NET_STALL_UPDATES);
+    }
+
+    while (ReceiveNetMatch(&net[1], &replay[1])) badAccepted++;
+
+    double startTime = GetTime();
+
+    for (int match = 0; (match < matches) && !stalled; match++)
+    {
+        // The host starts the match, the client starts it from the seed it receives
+        unsigned int matchSeed = (unsigned int)rand();
+
+        SeedGame(&game[0], matchSeed);
+        SetPlayerCount(&game[0], players);
+        SetWorldScreens(&game[0], screens);
+        SetPhysicsMode(&game[0], physics);
+        InitLives(&game[0]);
+        InitGame(&game[0]);
+        BeginReplay(&replay[0], &game[0], matchSeed);
+        SendNetMatch(&net[0], &replay[0]);
+
+        int updates = 0;
+
+        while (!ReceiveNetMatch(&net[1], &replay[1]) && !stalled)
+        {
+            netTime += NET_RESEND_TIME;
+            UpdateNet(&net[0], netTime);
+            UpdateNet(&net[1], netTime);
+
+            stalled = (++updates > NET_STALL_UPDATES);
+        }
+
+        if (stalled) break;
+
+        StartReplay(&replay[1], &game[1]);
+
+        Gunner gunner[2][MAX_PLAYERS] = { 0 };
+        ShellEvent lastEvent[2][MAX_PLAYERS] = { SHELL_NONE };
+        int round[2] = { game[0].round, game[1].round };
+        int roundTurns[2] = { 0 };
+
+        InitGunners(gunner[0], players);
+        InitGunners(gunner[1], players);
+
+        updates = 0;
+
+        while ((!game[0].gameOver || !game[1].gameOver) && !stalled)
+        {
+            bool played = false;
+
+            for (int p = 0; p < 2; p++)
+            {
+                Game *peerGame = &game[p];
+
+                if (peerGame->gameOver) continue;
+
+                int shooter = peerGame->playerTurn;
+                ReplayInput input = { 0 };
+
+                if (IsNetPlayer(&net[p], &peerGame->player[shooter]))
+                {
+                    if (roundTurns[p] >= MAX_TURNS_PER_ROUND) input.power = REPLAY_NEW_MAP;       // Nobody can win this map
+                    else
+                    {
+                        AimGunner(peerGame, &gunner[p][shooter], lastEvent[p][shooter]);
+                        input = (ReplayInput){ (short)gunner[p][shooter].angle, (short)gunner[p][shooter].power, MUNITION_SHELL };
+                    }
+
+                    SendNetInput(&net[p], input, GetGameChecksum(peerGame));
+                }
+                else if (!ReceiveNetInput(&net[p], peerGame, &input)) continue;
+
+                if (input.power == REPLAY_NEW_MAP) InitGame(peerGame);
+                else if (input.power == REPLAY_PREVIOUS_MAP) InitPreviousMap(peerGame);
+                else
+                {
+                    FireMunition(peerGame, input.angle, input.power, (Munition)input.munition);
+                    lastEvent[p][shooter] = LandShell(peerGame);
+                }
+
+                roundTurns[p]++;
+                played = true;
+                if (p == 0) turns++;
+
+                if (peerGame->round != round[p])
+                {
+                    round[p] = peerGame->round;
+                    roundTurns[p] = 0;
+                    InitGunners(gunner[p], players);
+                }
+            }
+
+            netTime += NET_RESEND_TIME;
+            UpdateNet(&net[0], netTime);
+            UpdateNet(&net[1], netTime);
+
+            updates = played ? 0 : updates + 1;
+            stalled = (updates > NET_STALL_UPDATES) || net[0].lost || net[1].lost;
+        }
+
+        if (net[0].desync || net[1].desync) desyncs++;
+        if ((game[0].winner != game[1].winner) || (game[0].round != game[1].round) || (GetGameChecksum(&game[0]) != GetGameChecksum(&game[1]))) mismatches++;
+    }
+
+    double elapsed = GetTime() - startTime;
+    if (elapsed <= 0.0) elapsed = 1e-9;
+    if (turns == 0) turns = 1;
+
+    long long packets = net[0].packetsSent + net[1].packetsSent;
+    long long bytes = net[0].bytesSent + net[1].bytesSent;
+
+    printf("seed:           %u\n", seed);
+    printf("players:        %i\n", players);
+    printf("world:          %i screen%s, %s physics\n", screens, (screens > 1) ? "s" : "", GetPhysicsName(physics));
+    printf("bad matches:    %i sent, %i accepted\n", badCount, badAccepted);
+    printf("matches:        %i (%i desynced, %i ended differently)%s\n", matches, desyncs, mismatches, stalled ? ", STALLED" : "");
+    printf("turns:          %lli\n", turns);
+    printf("link:           %i%% loss, %lli packets, %lli bytes, %.1f bytes/turn with acknowledgements\n", lossPercent, packets, bytes, (double)bytes/turns);
+    printf("elapsed:        %.3f s\n", elapsed);
+
+    CloseNetSession(&net[0]);
+    CloseNetSession(&net[1]);
+    UnloadReplay(&replay[0]);
+    UnloadReplay(&replay[1]);
+
+    return (stalled || (badAccepted > 0) || (desyncs > 0) || (mismatches > 0)) ? 1 : 0;
+}
+
+// Play matches with the gunner, snapshot every turn and now and then roll back a few turns: firing
+// the recorded shots again from there must lead to the same state. Each match also goes once
+// through a snapshot file, as a resumed match would
+static int RunRollbacks(int matches, unsigned int seed, int players, int screens)
+{
+    static Game game = { 0 };
+    static Game resumed = { 0 };
+    SnapshotRing ring = { 0 };
+    Replay replay = { 0 };
+
+    if (!InitSnapshotRing(&ring, ROLLBACK_RING))
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    srand(seed);
+
+    long long turns = 0;
+    long long replayedTurns = 0;
+    long long snapshotBytes = 0;
+    int rollbacks = 0;
+    int failed = 0;
+    int fileChecks = 0;
+    int fileFailed = 0;
+    double saveTime = 0.0;
+    double restoreTime = 0.0;
+
+    for (int match = 0; match < matches; match++)
+    {
+        unsigned int matchSeed = (unsigned int)rand();
+
+        SeedGame(&game, matchSeed);
+        SetPlayerCount(&game, players);
+        SetWorldScreens(&game, screens);
+        InitLives(&game);
+        InitGame(&game);
+        BeginReplay(&replay, &game, matchSeed);
+        ClearSnapshotRing(&ring);
+
+        Gunner gunner[MAX_PLAYERS] = { 0 };
+        ShellEvent lastEvent[MAX_PLAYERS] = { SHELL_NONE };
+
+        InitGunners(gunner, game.playerCount);
+
+        int roundTurns = 0;
+        int round = game.round;
+        bool fileChecked = false;
+
+        while (!game.gameOver)
+        {
+            int shooter = game.playerTurn;
+            double startTime = GetTime();
+
+            PushSnapshot(&ring, &game, replay.inputCount);
+            saveTime += GetTime() - startTime;
+            snapshotBytes += GetSnapshotSize(&game);
+
+            // A few turns in, once there are craters, the state goes through a file and back
+            if (!fileChecked && (roundTurns == ROLLBACK_FILE_TURN))
+            {
+                int tag = 0;
+
+                fileChecked = true;
+                fileChecks++;
+
+                if (!SaveSnapshotFile(&game, replay.inputCount, ROLLBACK_FILE) || !LoadSnapshotFile(ROLLBACK_FILE, &resumed, &tag) ||
+                    (tag != replay.inputCount) || (GetGameChecksum(&resumed) != GetGameChecksum(&game))) fileFailed++;
+
+                remove(ROLLBACK_FILE);
+            }
+
+            AimGunner(&game, &gunner[shooter], lastEvent[shooter]);
+            if (FireShell(&game, gunner[shooter].angle, (int)gunner[shooter].power)) RecordShot(&replay, gunner[shooter].angle, (int)gunner[shooter].power, MUNITION_SHELL);
+            turns++;
+            roundTurns++;
+
+            lastEvent[shooter] = LandShell(&game);
+
+            if ((turns%ROLLBACK_INTERVAL == 0) && (ring.count > 0))
+            {
+                unsigned int expected = GetGameChecksum(&game);
+                int depth = 1 + (int)(turns/ROLLBACK_INTERVAL)%ring.count;
+                int tag = 0;
+
+                for (int i = 1; i < depth; i++) PopSnapshot(&ring, NULL, NULL);
+
+                startTime = GetTime();
+                PopSnapshot(&ring, &game, &tag);
+                restoreTime += GetTime() - startTime;
+
+                for (int i = tag; i < replay.inputCount; i++) PlayReplayInput(&replay, &game, i);
+
+                rollbacks++;
+                replayedTurns += replay.inputCount - tag;
+
+                if (GetGameChecksum(&game) != expected)
+                {
+                    printf("match %i, turn %lli: MISMATCH after rolling back %i turns\n", match, turns, depth);
+                    failed++;
+                }
+            }
+
+            if (game.round != round)
+            {
+                round = game.round;
+                roundTurns = 0;
+                InitGunners(gunner, game.playerCount);
+            }
+            else if (roundTurns >= MAX_TURNS_PER_ROUND)
+            {
+                roundTurns = 0;
+                InitGame(&game);
+                RecordNewMap(&replay);
+                round = game.round;
+                InitGunners(gunner, game.playerCount);
+            }
+        }
+    }
+
+    UnloadReplay(&replay);
+    UnloadSnapshotRing(&ring);
+
+    if (turns == 0) turns = 1;
+    if (rollbacks == 0) rollbacks = 1;
+
+    printf("seed:           %u\n", seed);
+    printf("world:          %i screen%s, %i players\n", screens, (screens > 1) ? "s" : "", players);
+    printf("matches:        %i\n", matches);
+    printf("file trips:     %i (%i failed)\n", fileChecks, fileFailed);
+    printf("turns:          %lli\n", turns);
+    printf("rollbacks:      %i (%i failed), %lli turns played again\n", rollbacks, failed, replayedTurns);
+    printf("snapshot:       %lli bytes (Game %i bytes)\n", snapshotBytes/turns, (int)sizeof(Game));
+    printf("save:           %.2f us\n", saveTime*1e6/turns);
+    printf("restore:        %.2f us\n", restoreTime*1e6/rollbacks);
+
+    return ((failed > 0) || (fileFailed > 0)) ? 1 : 0;
+}
+
+// Play AI against AI matches on every thread, each match from its own seed so the results do not depend
+// on the number of threads nor on which thread played which match
+static int RunTournament(int matches, unsigned int seed, int threads, int players, int screens, int aiLevel, PhysicsMode physics)
+{
+    static Tournament tournament = { 0 };
+
+    tournament.seed = seed;
+    tournament.players = players;
+    tournament.screens = screens;
+    tournament.physics = physics;
+    tournament.config = GetAIConfig(aiLevel - 1);
+    tournament.config.timeBudget = 0.0f;
+
+    double startTime = GetTime();
+
+    threads = RunJobs(matches, threads, PlayTournamentMatch, &tournament);
+
+    double elapsed = GetTime() - startTime;
+    if (elapsed <= 0.0) elapsed = 1e-9;
+
+    // Sum up the threads, nothing was shared while playing
+    TournamentStats total = { 0 };
+
+    for (int i = 0; i < MAX_JOB_THREADS; i++)
+    {
+        const TournamentStats *stats = &tournament.stats[i];
+
+        total.matches += stats->matches;
+        total.wins[0] += stats->wins[0];
+        total.wins[1] += stats->wins[1];
+        total.firstWins += stats->firstWins;
+        total.rounds += stats->rounds;
+        total.droppedRounds += stats->droppedRounds;
+        total.turns += stats->turns;
+        total.missed += stats->missed;
+        total.kills += stats->kills;
+        total.friendlyKills += stats->friendlyKills;
+        total.killTurns += stats->killTurns;
+
+        for (int c = 0; c < POSITION_CLASSES; c++)
+        {
+            total.positionTanks[c] += stats->positionTanks[c];
+            total.positionKills[c] += stats->positionKills[c];
+            total.positionDeaths[c] += stats->positionDeaths[c];
+        }
+
+        free(tournament.game[i]);
+        tournament.game[i] = NULL;
+    }
+
+    double matchCount = (total.matches > 0) ? (double)total.matches : 1.0;
+    double shotCount = (total.turns > 0) ? (double)total.turns : 1.0;
+
+    printf("seed:           %u\n", seed);
+    printf("tuning:         GRAVITY %.2f, LIVES %i, buildings %i-%i%% high (+-%i%%), tanks %i-%i%% (team %i%%)\n", GRAVITY, LIVES,
+           BUILDING_MIN_RELATIVE_HEIGHT, BUILDING_MAX_RELATIVE_HEIGHT, BUILDING_RELATIVE_ERROR, MIN_PLAYER_POSITION, MAX_PLAYER_POSITION, MAX_TEAM_POSITION);
+    printf("players:        %i %s\n", players, GetAILevelName(aiLevel - 1));
+    printf("world:          %i screen%s, %s physics\n", screens, (screens > 1) ? "s" : "", GetPhysicsName(physics));
+    printf("matches:        %lli (blue %.1f%%, red %.1f%%, first to fire %.1f%%)\n", total.matches,
+           100.0*total.wins[0]/matchCount, 100.0*total.wins[1]/matchCount, 100.0*total.firstWins/matchCount);
+    printf("rounds:         %lli (%lli dropped after %i turns)\n", total.rounds, total.droppedRounds, MAX_TURNS_PER_ROUND);
+    printf("turns:          %lli, %.2f to kill\n", total.turns, (total.kills > 0) ? (double)total.killTurns/total.kills : 0.0);
+    printf("kills:          %lli (%lli friendly)\n", total.kills, total.friendlyKills);
+    printf("off-screen:     %lli shots (%.1f%%)\n", total.missed, 100.0*total.missed/shotCount);
+    printf("start position  tanks        kills        deaths       win rate\n");
+
+    for (int c = 0; c < POSITION_CLASSES; c++)
+    {
+        long long duels = total.positionKills[c] + total.positionDeaths[c];
+
+        if (total.positionTanks[c] == 0) continue;
+
+        printf("  %2i-%2i%%%s      %-12lli %-12lli %-12lli %.1f%%\n", c*POSITION_STEP, (c + 1)*POSITION_STEP, (c == POSITION_CLASSES - 1) ? "+" : " ",
+               total.positionTanks[c], total.positionKills[c], total.positionDeaths[c], (duels > 0) ? 100.0*total.positionKills[c]/duels : 0.0);
+    }
+
+    printf("threads:        %i of %i processors\n", threads, GetProcessorCount());
+    printf("elapsed:        %.3f s\n", elapsed);
+    printf("matches/sec:    %.1f (%.1f per thread)\n", total.matches/elapsed, total.matches/elapsed/threads);
+
+    return 0;
+}
+
+// One tournament match, on the game of the thread: only the stats of the thread are written
+static void PlayTournamentMatch(int match, int thread, void *context)
+{
+    Tournament *tournament = (Tournament *)context;
+    TournamentStats *stats = &tournament->stats[thread];
+
+    if (tournament->game[thread] == NULL) tournament->game[thread] = (Game *)malloc(sizeof(Game));
+
+    Game *game = tournament->game[thread];
+
+    if (game == NULL) return;
+
+    unsigned int matchSeed = MixSeed(tournament->seed, (unsigned int)match);
+    unsigned int aimState = MixSeed(matchSeed, 0x41494d);       // Aim noise, apart from the maps
+
+    // Nothing left from the previous match of the thread
+    memset(game, 0, sizeof(Game));
+
+    SeedGame(game, matchSeed);
+    SetPlayerCount(game, tournament->players);
+    SetWorldScreens(game, tournament->screens);
+    SetPhysicsMode(game, tournament->physics);
+    InitLives(game);
+    game->playerTurn = match%2;             // Blue and red fire first in turn
+    InitGame(game);
+
+    bool firstLeft = game->player[game->playerTurn].isLeftTeam;
+    int positionClass[MAX_PLAYERS] = { 0 };
+    int roundTurns = 0;
+    int killTurns = 0;
+    int round = game->round;
+
+    ClassifyPositions(game, positionClass);
+    for (int i = 0; i < game->playerCount; i++) if (game->player[i].isAlive) stats->positionTanks[positionClass[i]]++;
+
+    while (!game->gameOver)
+    {
+        int shooter = game->playerTurn;
+        int lives[MAX_PLAYERS] = { 0 };
+        int angle = 0;
+        int power = 0;
+
+        for (int i = 0; i < game->playerCount; i++) lives[i] = game->player[i].lives;
+
+        AIChooseShotLocal(game, tournament->config, &aimState, &angle, &power);
+        FireShell(game, angle, power);
+        stats->turns++;
+        roundTurns++;
+        killTurns++;
+
+        if (LandShell(game) == SHELL_MISSED) stats->missed++;
+
+        for (int i = 0; i < game->playerCount; i++)
+        {
+            if (game->player[i].lives == lives[i]) continue;
+
+            if (game->player[i].isLeftTeam == game->player[shooter].isLeftTeam) stats->friendlyKills++;
+            else
+            {
+                stats->kills++;
+                stats->killTurns += killTurns;
+                stats->positionKills[positionClass[shooter]]++;
+                stats->positionDeaths[positionClass[i]]++;
+            }
+
+            killTurns = 0;
+        }
+
+        if ((game->round == round) && (roundTurns >= MAX_TURNS_PER_ROUND) && !game->gameOver)
+        {
+            stats->droppedRounds++;
+            InitGame(game);
+        }
+
+        if (game->round != round)
+        {
+            round = game->round;
+            roundTurns = 0;
+            killTurns = 0;
+
+            ClassifyPositions(game, positionClass);
+            for (int i = 0; i < game->playerCount; i++) if (game->player[i].isAlive) stats->positionTanks[positionClass[i]]++;
+        }
+    }
+
+    stats->matches++;
+    stats->rounds += game->round;
+    stats->wins[game->winner - 1]++;
+    if ((game->winner == 1) == firstLeft) stats->firstWins++;
+}
+
+// Start position class of each tank: its distance to the edge of its own team, in % of the world width
+static void ClassifyPositions(const Game *game, int *positionClass)
+{
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Player *player = &game->player[i];
+        float center = player->position.x + player->size.x/2;
+        float distance = player->isLeftTeam ? center : game->worldWidth - center;
+        int c = (int)(distance*100/game->worldWidth)/POSITION_STEP;
+
+        if (c < 0) c = 0;
+        if (c >= POSITION_CLASSES) c = POSITION_CLASSES - 1;
+
+        positionClass[i] = c;
+    }
+}
+
+// Generate maps of fresh seeds without the cache, then play a rotation of maps again and again.
+// Fails if a map from the cache or from InitGameMap() is not the one its seed generates
+static int RunMaps(int maps, unsigned int seed, int players, int screens, int rotation)
+{
+    static GameMap map = { 0 };
+    static GameMap check = { 0 };
+    static Game game = { 0 };
+
+    MapParams params = GetDefaultMapParams();
+    MapParams unchecked = params;
+    unsigned int aliveMask = (1u << players) - 1;
+    long long attempts = 0;
+    int worstAttempts = 0;
+    int unfair = 0;
+    int firstFair = 0;
+    int failures = 0;
+
+    unchecked.minReachAngles = 0;
+    unchecked.maxHeightGap = 100;
+
+    double startTime = GetTime();
+
+    for (int i = 0; i < maps; i++)
+    {
+        GenerateMap(&map, &params, game.physics, MixSeed(seed, i), screens, players, aliveMask);
+
+        attempts += map.attempts;
+        if (map.attempts > worstAttempts) worstAttempts = map.attempts;
+        if (!map.fair) unfair++;
+        if (map.fair && (map.attempts == 1)) firstFair++;
+    }
+
+    double generateTime = GetTime() - startTime;
+
+    // Same draws with the check off: the cost of the check is the difference
+    startTime = GetTime();
+    for (int i = 0; i < maps; i++) GenerateMap(&map, &unchecked, game.physics, MixSeed(seed, i), screens, players, aliveMask);
+    double uncheckedTime = GetTime() - startTime;
+
+    // A rotation played ROTATION_LOOPS times: only its first pass generates
+    ClearMapCache();
+    SeedGame(&game, seed);
+    SetPlayerCount(&game, players);
+    SetWorldScreens(&game, screens);
+    InitLives(&game);
+
+    startTime = GetTime();
+
+    for (int loop = 0; loop < ROTATION_LOOPS; loop++)
+    {
+        for (int i = 0; i < rotation; i++) InitGameMap(&game, MixSeed(seed, i));
+    }
+
+    double rotationTime = GetTime() - startTime;
+    int hits = 0;
+    int misses = 0;
+
+    GetMapCacheStats(&hits, &misses);
+
+    // Maps from the cache and from the game are the ones of their seed
+    for (int i = 0; i < rotation; i++)
+    {
+        GetMap(&map, &params, game.physics, MixSeed(seed, i), screens, players, aliveMask);
+        GenerateMap(&check, &params, game.physics, MixSeed(seed, i), screens, players, aliveMask);
+        InitGameMap(&game, MixSeed(seed, i));
+
+        bool same = (map.buildingCount == check.buildingCount) && (memcmp(map.building, check.building, check.buildingCount*sizeof(Building)) == 0) &&
+                    (memcmp(map.spawn, check.spawn, players*sizeof(Vector2)) == 0) && (game.buildingCount == check.buildingCount);
+
+        for (int p = 0; same && (p < players); p++) same = (game.player[p].position.x == check.spawn[p].x) && (game.player[p].position.y == check.spawn[p].y);
+
+        if (!same)
+        {
+            printf("map %u: differs from the map of its seed\n", MixSeed(seed, i));
+            failures++;
+        }
+    }
+
+    printf("players:        %i\n", players);
+    printf("world:          %i screen%s\n", screens, (screens > 1) ? "s" : "");
+    printf("maps:           %i, %.1f%% fair at the first draw, %i unfair after %i draws\n", maps, 100.0*firstFair/maps, unfair, params.maxAttempts);
+    printf("draws:          %.2f per map avg, %i max\n", (double)attempts/maps, worstAttempts);
+    printf("generation:     %.1f us per map, %.1f us without the fairness check\n", generateTime*1e6/maps, uncheckedTime*1e6/maps);
+    printf("rotation:       %i maps x %i, %i generated, %i from the cache\n", rotation, ROTATION_LOOPS, misses, hits);
+    printf("map change:     %.1f us avg (InitGameMap())\n", rotationTime*1e6/(rotation*ROTATION_LOOPS));
+    printf("result:         %s\n", (failures == 0) ? "OK" : "MAPS DIFFER");
+
+    return (failures == 0) ? 0 : 1;
+}
+
+// Seed of a match from the tournament seed and the match number (murmur3 finalizer)
+static unsigned int MixSeed(unsigned int seed, unsigned int value)
+{
+    unsigned int x = seed ^ (value*0x9e3779b9u);
+
+    x ^= x >> 16;
+    x *= 0x85ebca6bu;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35u;
+    x ^= x >> 16;
+
+    return x;
+}
@@ -0,0 +1,46 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - null platform
+*
+*   The few raylib types and helpers the game core needs, so it can be built with
+*   GAME_HEADLESS and run without a window, a GPU or an audio device (see nullplatform.c).
+*   Definitions match raylib 2.5.
+*
+********************************************************************************************/
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdbool.h>
+
+#ifndef PI
+    #define PI 3.14159265358979323846f
+#endif
+
+#define DEG2RAD (PI/180.0f)
+#define RAD2DEG (180.0f/PI)
+
+typedef struct Vector2 {
+    float x;
+    float y;
+} Vector2;
+
+typedef struct Rectangle {
+    float x;
+    float y;
+    float width;
+    float height;
+} Rectangle;
+
+typedef struct Color {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+    unsigned char a;
+} Color;
+
+double GetTime(void);                                                              // Returns elapsed time in seconds (monotonic clock)
+int GetRandomValue(int min, int max);                                               // Returns a random value between min and max (both included)
+bool CheckCollisionCircleRec(Vector2 center, float radius, Rectangle rec);
+
+#endif // HEADLESS_H
@@ -0,0 +1,85 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - idle redraw
+*
+*   raylib measures GetFrameTime() between two EndDrawing(), so it knows nothing of the frames
+*   not drawn: NextIdleFrame() keeps the frame time of the game instead, from the start of
+*   one frame to the next. With idle redraw off it is GetFrameTime(), unchanged.
+*
+********************************************************************************************/
+
+#include "idle.h"
+
+#include "raylib.h"
+
+#if defined(PLATFORM_DESKTOP)
+    // NOTE: GLFW is built into libraylib, declared here as raylib.h does not include it
+    void glfwWaitEventsTimeout(double timeout);
+#elif !defined(PLATFORM_WEB)
+    #include <time.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define IDLE_WAKE_SHARE               0.9f         // A wait shorter than this share of IDLE_WAIT was cut short by an event
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static bool enabled = false;
+static double frameStart = -1.0;                        // Negative until the first frame starts
+static double lastDraw = 0.0;                           // Start of the last frame drawn
+static unsigned int drawnKey = 0;                       // Key of the last frame drawn
+static bool woken = false;                              // The last wait ended on an event
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void SetIdleRedraw(bool enable)
+{
+#if defined(PLATFORM_WEB)
+    enable = false;     // The browser calls the frames, and raylib only reads the input of the frames drawn
+#endif
+    enabled = enable;
+}
+
+bool IsIdleRedrawEnabled(void)
+{
+    return enabled;
+}
+
+float NextIdleFrame(void)
+{
+    double now = GetTime();
+    float frameTime = (frameStart < 0.0) ? 0.0f : (float)(now - frameStart);
+
+    frameStart = now;
+
+    return enabled ? frameTime : GetFrameTime();
+}
+
+bool NeedsRedraw(unsigned int frameKey, bool animating)
+{
+    if (enabled && !animating && !woken && (frameKey == drawnKey) && (frameStart - lastDraw < IDLE_REDRAW)) return false;
+
+    drawnKey = frameKey;
+    lastDraw = frameStart;
+    woken = false;
+
+    return true;
+}
+
+void WaitIdle(void)
+{
+    double start = GetTime();
+
+#if defined(PLATFORM_DESKTOP)
+    glfwWaitEventsTimeout(IDLE_WAIT);
+#elif !defined(PLATFORM_WEB)
+    struct timespec wait = { 0, (long)(IDLE_WAIT*1e9f) };
+    nanosleep(&wait, NULL);
+#endif
+
+    woken = (GetTime() - start < IDLE_WAKE_SHARE*IDLE_WAIT);
+}
@@ -0,0 +1,40 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - idle redraw
+*
+*   Opt-in power saving (--idle): a frame is only drawn when what it shows changed. The game
+*   sums up the state a frame shows in a key (mouse, view, aim, HUD values...), and says
+*   whether something is moving on its own (shells, particles, the view gliding). While the
+*   key stays the same and nothing moves, the frame is not drawn and the main loop sleeps
+*   until an input event arrives, or IDLE_WAIT at most: the game and the music are still
+*   updated on every wake, only the drawing is skipped.
+*
+*   The first frame after an input event is always drawn: raylib only reads the mouse
+*   position and the key edges when a frame ends, so the key only sees them a frame later.
+*
+*   NOTE: raylib 2.5 has no event waiting of its own, the desktop build waits with the GLFW
+*   built into raylib. Other platforms sleep IDLE_WAIT instead, and browsers draw every frame.
+*
+********************************************************************************************/
+
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define IDLE_WAIT                     0.05f        // s: longest sleep, the music stream needs feeding every ~90 ms
+#define IDLE_REDRAW                    1.0f        // s: a frame is drawn at least this often, in case the window was damaged
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void SetIdleRedraw(bool enabled);                       // Off by default: every frame is drawn
+bool IsIdleRedrawEnabled(void);
+float NextIdleFrame(void);                              // Call at the start of every frame, returns the s since the previous one started
+bool NeedsRedraw(unsigned int frameKey, bool animating);    // After the update of a frame: whether to draw it
+void WaitIdle(void);                                    // After a frame not drawn: sleep until an input event or IDLE_WAIT
+
+#endif // IDLE_H
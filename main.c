@@ -12,11 +12,24 @@
 ********************************************************************************************/
 
 #include "raylib.h"
+#include "game.h"
+#include "ai.h"
+#include "assets.h"
+#include "audio.h"
+#include "replay.h"
+#include "net.h"
+#include "profiler.h"
+#include "preview.h"
+#include "particles.h"
+#include "snapshot.h"
+#include "resolution.h"
+#include "idle.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <math.h>
+#include <string.h>
 
 #if defined(PLATFORM_WEB)
     #include <emscripten/emscripten.h>
@@ -25,162 +38,234 @@
 //----------------------------------------------------------------------------------
 // Some Defines
 //----------------------------------------------------------------------------------
-#define MAX_BUILDINGS                    15
-#define MAX_EXPLOSIONS                  200
-#define MAX_PLAYERS                       2
+#define AI_THINK_TIME                  0.8f        // Seconds the AI waits before firing, so its turn can be followed
 
-#define BUILDING_RELATIVE_ERROR          30        // Building size random range %
-#define BUILDING_MIN_RELATIVE_HEIGHT     20        // Minimum height in % of the screenHeight
-#define BUILDING_MAX_RELATIVE_HEIGHT     60        // Maximum height in % of the screenHeight
-#define BUILDING_MIN_GREENSCALE_COLOR    120        // Minimum gray color for the buildings
-#define BUILDING_MAX_GREENSCALE_COLOR    200        // Maximum gray color for the buildings
+#define SIMULATION_STEP         (1.0f/120)        // Fixed shell physics step (s), whatever the frame rate
+#define MAX_FRAME_TIME                0.25f        // Longer frames (window dragged, breakpoint) are not caught up
 
-#define MIN_PLAYER_POSITION               5        // Minimum x position %
-#define MAX_PLAYER_POSITION              20        // Maximum x position %
+#define CAMERA_SPEED                  5.0f        // Share of the way to its focus the view covers each second
+#define CAMERA_PAN_SPEED            900.0f        // [LEFT]/[RIGHT] panning while aiming (px/s)
+#define LAYER_CHUNKS                     4        // Terrain chunks with a layer, a screen spans at most 4 of them
 
-#define GRAVITY                       9.81f
-#define DELTA_FPS                        60
-#define LIVES                             3
-
-//----------------------------------------------------------------------------------
-// Types and Structures Definition
-//----------------------------------------------------------------------------------
-typedef struct Player {
-    Vector2 position;
-    Vector2 size;
-
-    Vector2 aimingPoint;
-    int aimingAngle;
-    int aimingPower;
-
-    Vector2 previousPoint;
-    int previousAngle;
-    int previousPower;
-
-    Vector2 impactPoint;
-
-    bool isLeftTeam;                // This player belongs to the left or to the right team
-    bool isPlayer;                  // If is a player or an AI
-    bool isAlive;
-    int lives;
-
-    Texture2D chassis;
-
-
-} Player;
-
-int frameWidth;
-int frameHeight;
-
-typedef struct Building {
-    Rectangle rectangle;
-    Color color;
-} Building;
-
-typedef struct Explosion {
-    Vector2 position;
-    int radius;
-    bool active;
-} Explosion;
-
-typedef struct Shell {
-    Vector2 position;
-    Vector2 speed;
-    int radius;
-    bool active;
-    double rotation;
-    int length;
-    Rectangle rectangle;
-    Sound fxBoom;
-} Shell;
+#define RESUME_SNAPSHOT       "resume.tds"        // State at the start of the last turn, --resume picks the match up there
+#define RESUME_REPLAY         "resume.tdr"        // Shots of the match so far, so it is still recorded once resumed
 
 //------------------------------------------------------------------------------------
 // Global Variables Declaration
 //------------------------------------------------------------------------------------
-static const int screenWidth = 1280;
-static const int screenHeight = 720;
-
-static bool gameOver = false;
 static bool pause = false;
-
-static Player player[MAX_PLAYERS] = { 0 };
-static Building building[MAX_BUILDINGS] = { 0 };
-static Explosion explosion[MAX_EXPLOSIONS] = { 0 };
-static Shell shell = { 0 };
-
-static int playerTurn = 0;
-static bool shellOnAir = false;
-static bool redemarrage = false;
-static int winner = 0;
+static bool showProfiler = false;               // [F3] frame time overlay
+
+static AILevel aiLevel = AI_MEDIUM;
+static float aiThinkTime = 0.0f;
+
+static int playerCount = MIN_PLAYERS;           // Tanks of each match, --players
+static int worldScreens = 1;                    // World width of each match, --screens
+static PhysicsMode physics = PHYSICS_CLASSIC;   // Shell flight of each match, --physics
+static Munition munition = MUNITION_SHELL;      // [M] munition of the human players
+static int previewShare = 100;                  // Share of the predicted arc shown while aiming (%), --preview
+static TrajectoryPreview preview = { 0 };       // Last arcs aimed, see preview.h
+
+static Game game = { 0 };
+static int polyphony = DEFAULT_VOICES;          // Explosions playing at once, --voices
+static bool audioStarted = false;               // The audio device is opened after the first frame
+
+static float frameTime = 0.0f;                  // s since the previous frame started, drawn or not (see NextIdleFrame())
+static bool frameDrawn = false;                 // The previous frame was drawn, --idle skips the frames that show nothing new
+static float simulationTime = 0.0f;             // Frame time not simulated yet, less than SIMULATION_STEP
+
+static Replay replay = { 0 };                   // Match being recorded, or played back
+static bool replaying = false;                  // Playing back a replay file given on the command line
+static int replayCursor = 0;                    // Next input to play back
+static unsigned int matchCount = 0;
+
+static NetSession net = { 0 };                  // Lockstep game with another machine, --host or --join
+static bool networked = false;
+static bool waitingMatch = false;               // Network client: the host has not started the next match yet
+
+static SnapshotRing history = { 0 };            // States at the start of the last turns, [U] goes back to them
+static bool turnSaved = false;                  // The turn being aimed is in history
+static bool resumeMatch = false;                // --resume: continue the match of the resume files
+
+static float cameraX = 0.0f;                    // Left edge of the view in the world, moving towards its focus
+static float cameraFocus = 0.0f;                // Point of the world the view centers on
+static int viewLeft = 0;                        // cameraX rounded, what is drawn and aimed with
+static int cameraTurn = -1;                     // Turn the view last went to the tank of, -1: after a flight
+static unsigned int cameraGeneration = 0;       // Map the view was placed on
+
+static RenderTexture2D terrainLayer[LAYER_CHUNKS] = { 0 };     // Sky, buildings and craters of the chunks in view, only redrawn when they change
+static int layerChunk[LAYER_CHUNKS] = { -1, -1, -1, -1 };     // Chunk baked in each layer, -1: none
+static Texture2D terrainMask = { 0 };           // Sky of a baked chunk (opaque where the ground is dug), drawn over its buildings
+static unsigned char terrainMaskPixels[TERRAIN_HEIGHT*TERRAIN_CHUNK_WIDTH*2] = { 0 };     // Gray and alpha of terrainMask
+static unsigned int terrainGeneration = 0;      // Terrain the layers were baked from
+static int terrainCraters = 0;                  // Craters already patched into the layers
 
 //------------------------------------------------------------------------------------
 // Module Functions Declaration (local)
 //------------------------------------------------------------------------------------
-static void InitGame(void);         // Initialize game
-static void InitLives(void);
+static void LoadGame(void);         // Load textures and sounds
 static void UpdateGame(void);       // Update game (one frame)
 static void DrawGame(void);         // Draw game (one frame)
 static void UnloadGame(void);       // Unload game
 static void UpdateDrawFrame(void);  // Update and Draw (one frame)
+static void StartAudio(void);       // Open the audio device and start the soundtrack
 
 // Additional module functions
-static void InitBuildings(void);
-static void InitPlayers(void);
-static bool UpdatePlayer(int playerTurn);
-static bool UpdateShell(int playerTurn);
+static void UpdatePlayer(int playerTurn);
+static void UpdateAI(int playerTurn);
+static void UpdateReplay(int playerTurn);
+static void UpdateRemote(int playerTurn);
+static void UpdateNetwork(void);
+static void FireShot(int angle, int power, Munition munition);
+static void NewMap(void);
+static void PreviousMap(void);
+static void StartMatch(void);
+static void SaveMatch(void);
+static void SaveTurn(void);
+static void UndoTurn(void);
+static bool ResumeMatch(void);
+static void ShowShot(int playerTurn, int angle, int power);
+static void UpdateFlight(void);
+static void EmitShot(int shooter);
+static void DrawShells(void);
+static void DrawPreview(int playerTurn);
+static void UpdateView(void);
+static void UpdateTerrainLayer(void);
+static void BakeTerrainChunk(int layer, int chunk);
+static void DrawTerrainLayer(void);
+static unsigned int GetFrameKey(void);
+static bool IsAnimating(void);
 
 //------------------------------------------------------------------------------------
 // Program main entry point
 //------------------------------------------------------------------------------------
-int main(void)
+int main(int argc, char *argv[])
 {
+    // Command line: [--fps N] [--scale %] [--fullscreen] [--idle] [--players N] [--screens N] [--physics NAME] [--preview %] [--voices N] [--host PORT | --join ADDRESS[:PORT]] [--profile frames.csv] [replay file]
+    const char *csvFileName = NULL;
+    int targetFPS = -1;             // Default: display refresh rate (vsync), 0: uncapped
+    int renderShare = 0;            // World resolution (% of the window), 0: follows the frame times
+    bool fullscreen = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--profile") == 0) && (i + 1 < argc)) csvFileName = argv[++i];
+        else if ((strcmp(argv[i], "--fps") == 0) && (i + 1 < argc)) targetFPS = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--scale") == 0) && (i + 1 < argc)) renderShare = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--fullscreen") == 0) fullscreen = true;
+        else if (strcmp(argv[i], "--idle") == 0) SetIdleRedraw(true);
+        else if ((strcmp(argv[i], "--players") == 0) && (i + 1 < argc)) playerCount = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--screens") == 0) && (i + 1 < argc)) worldScreens = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--physics") == 0) && (i + 1 < argc))
+        {
+            const char *name = argv[++i];
+            int mode = 0;
+
+            while ((mode < PHYSICS_COUNT) && (strcmp(name, GetPhysicsName((PhysicsMode)mode)) != 0)) mode++;
+
+            if (mode < PHYSICS_COUNT) physics = (PhysicsMode)mode;
+            else TraceLog(LOG_WARNING, "%s is not a physics (classic, wind, drag, low-gravity, bounce), classic game", name);
+        }
+        else if ((strcmp(argv[i], "--preview") == 0) && (i + 1 < argc)) previewShare = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--voices") == 0) && (i + 1 < argc)) polyphony = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--resume") == 0) resumeMatch = true;
+        else if ((strcmp(argv[i], "--host") == 0) && (i + 1 < argc))
+        {
+            Transport transport = { 0 };
+            int port = atoi(argv[++i]);
+
+            networked = OpenUdpHost(&transport, port);
+            if (networked) InitNetSession(&net, transport, true);
+            else TraceLog(LOG_WARNING, "Port %i could not be opened, hotseat game", port);
+        }
+        else if ((strcmp(argv[i], "--join") == 0) && (i + 1 < argc))
+        {
+            Transport transport = { 0 };
+            char address[256] = { 0 };
+            int port = NET_DEFAULT_PORT;
+
+            strncpy(address, argv[++i], sizeof(address) - 1);
+
+            char *colon = strrchr(address, ':');
+            if (colon != NULL)
+            {
+                *colon = '\0';
+                port = atoi(colon + 1);
+            }
+
+            networked = OpenUdpClient(&transport, address, port);
+            if (networked) InitNetSession(&net, transport, false);
+            else TraceLog(LOG_WARNING, "%s:%i could not be reached, hotseat game", address, port);
+        }
+        else
+        {
+            // A replay file is played back instead of a new match
+            replaying = LoadReplay(&replay, argv[i]);
+            if (!replaying) TraceLog(LOG_WARNING, "%s is not a replay (version %i)", argv[i], REPLAY_VERSION);
+        }
+    }
+
+    if (networked) replaying = false;
+
     // Initialization (Note windowTitle is unused on Android)
     //---------------------------------------------------------
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE | ((targetFPS < 0) ? FLAG_VSYNC_HINT : 0));
+
     InitWindow(screenWidth, screenHeight, "Tank Destroyer");
 
-    InitLives();
+    if (fullscreen) ToggleFullscreen();
 
-    InitGame();
+    InitResolution(screenWidth, screenHeight, targetFPS);
+    SetRenderScale(renderShare/100.0f);
 
-    InitAudioDevice();                                            //Initialize audio device
+    for (int i = 0; i < MAX_PLAYERS; i++) game.player[i].isPlayer = true;     // Hotseat by default, [A] hands the red team to the AI
 
-    Music music = LoadMusicStream("resources/soundtrack.mp3");    //Load la soundtrack
+    InitProfiler(csvFileName);
 
-    SetMasterVolume(0.1);                                        //On baisse le volume sinon ça pique les oreilles
+    InitSnapshotRing(&history, DEFAULT_SNAPSHOT_RING);
+
+    if (!resumeMatch || replaying || networked || !ResumeMatch()) StartMatch();
 
-    music.loopCount = 0;                                         //La musique jouera indéfiniment
+    InitAI(0);
 
-    PlayMusicStream(music);
+    LoadGame();                 // The audio device starts after the first frame (StartAudio())
 
 #if defined(PLATFORM_WEB)
-    emscripten_set_main_loop(UpdateDrawFrame, 60, 1);
+    emscripten_set_main_loop(UpdateDrawFrame, 0, 1);     // Browser refresh rate
 #else
 
-    SetTargetFPS(60);
+    if (targetFPS > 0) SetTargetFPS(targetFPS);
     //--------------------------------------------------------------------------------------
-    
+
     // Main game loop
     while (!WindowShouldClose())    // Detect window close button or ESC key
     {
         // Update and Draw
         //----------------------------------------------------------------------------------
         UpdateDrawFrame();
-
-        UpdateMusicStream(music);
         //----------------------------------------------------------------------------------
     }
 #endif
 
     // De-Initialization
     //--------------------------------------------------------------------------------------
+    if (!replaying && !game.gameOver && (replay.inputCount > 0)) SaveMatch();     // Unfinished match
+
+    UnloadReplay(&replay);
+
+    UnloadSnapshotRing(&history);
+
+    if (networked) CloseNetSession(&net);
+
     UnloadGame();         // Unload loaded data (textures, sounds, models...)
 
+    UnloadResolution();
 
-    UnloadMusicStream(music);
+    CloseProfiler();
 
-    UnloadSound(shell.fxBoom);
+    CloseAI();
 
-    CloseAudioDevice();
+    if (audioStarted) CloseAudioDevice();
 
     CloseWindow();        // Close window and OpenGL context
     //--------------------------------------------------------------------------------------
@@ -192,158 +277,141 @@ int main(void)
 // Module Functions Definitions (local)
 //------------------------------------------------------------------------------------
 
-// Initialize game variables
-void InitGame(void)
+// Load game resources, the sounds are only decoded: their voices wait for the audio device
+void LoadGame(void)
 {
-    // Init shoot
-    shell.radius = 10;
-    shell.rotation = 0.0;
-    shell.length = 15;
-    shell.rectangle.height = 5;
-    shell.rectangle.width = 10;
-    shell.rectangle.x = 0;
-    shell.rectangle.y = 0;
-    shellOnAir = false;
-    shell.active = false;
-    shell.fxBoom = LoadSound("resources/boom.wav");  
-
-    redemarrage = false;
-
-    InitBuildings();
-    InitPlayers();
-    
-    // Init explosions
-    for (int i = 0; i < MAX_EXPLOSIONS; i++)
-    {
-        explosion[i].position = (Vector2){ 0.0f, 0.0f };
-        explosion[i].radius = 30;
-        explosion[i].active = false;
-    }
-}
+    LoadAssets();
 
-//Initialize the player lives
-void InitLives(void)
-{
-    for (int i = 0; i < MAX_PLAYERS; i++)
-    {
-        player[i].lives = LIVES;
-    }
+    for (int i = 0; i < LAYER_CHUNKS; i++) terrainLayer[i] = LoadRenderTexture(TERRAIN_CHUNK_WIDTH, TERRAIN_HEIGHT);
+
+    terrainMask = LoadTextureFromImage((Image){ terrainMaskPixels, TERRAIN_CHUNK_WIDTH, TERRAIN_HEIGHT, 1, UNCOMPRESSED_GRAY_ALPHA });
 }
 
 // Update game (one frame)
 void UpdateGame(void)
 {
-    if (!gameOver)
+    if (IsKeyPressed(KEY_F11)) ToggleFullscreen();
+
+    if (networked)
+    {
+        UpdateNetwork();
+
+        if (waitingMatch || !net.connected) return;
+    }
+
+    if (!game.gameOver)
     {
         if (IsKeyPressed('P')) pause = !pause;
+        if (IsKeyPressed(KEY_F3)) showProfiler = !showProfiler;
+
+        if (!replaying)
+        {
+            if (IsKeyPressed('R')) NewMap();        // Refresh the map in case it's too hard to touch the enemy tank
+            if (IsKeyPressed('B')) PreviousMap();   // Back to the map before it
+            if (IsKeyPressed('U')) UndoTurn();      // Take back the last shot (or new map) of a player
 
-        if (IsKeyPressed('R')) InitGame();  // Refresh the map in case it's too hard to touch the enemy tank
+            if (IsKeyPressed('A'))                  // Play against the AI, or let it play for this machine in a network game
+            {
+                int first = (networked && net.isHost) ? 0 : 1;
+
+                for (int i = first; i < MAX_PLAYERS; i += 2) game.player[i].isPlayer = !game.player[i].isPlayer;
+            }
+
+            if (IsKeyPressed('L')) aiLevel = (aiLevel + 1)%AI_LEVEL_COUNT;                   // AI difficulty
+            if (IsKeyPressed('M')) munition = (munition + 1)%MUNITION_COUNT;                 // Munition of the next shots
+        }
 
         if (!pause)
         {
-            if (!shellOnAir) shellOnAir = UpdatePlayer(playerTurn); // If we are aiming
+            if (!game.shellOnAir)                                           // If we are aiming
+            {
+                int shooter = game.playerTurn;
+
+                if (!turnSaved) SaveTurn();
+
+                if (replaying) UpdateReplay(game.playerTurn);
+                else if (networked && !IsNetPlayer(&net, &game.player[game.playerTurn])) UpdateRemote(game.playerTurn);
+                else if (game.player[game.playerTurn].isPlayer) UpdatePlayer(game.playerTurn);
+                else UpdateAI(game.playerTurn);
+
+                if (game.shellOnAir)
+                {
+                    EmitShot(shooter);
+                    turnSaved = false;
+                }
+            }
             else
             {
-                if (UpdateShell(playerTurn))                       // If collision
+                UpdateFlight();
+
+                if (game.gameOver && !replaying)
                 {
-                    // Game over logic
-                    bool leftTeamAlive = false;
-                    bool rightTeamAlive = false;
-
-                    for (int i = 0; i < MAX_PLAYERS; i++)
-                    {
-                        if (!player[i].isAlive && player[i].lives >0)
-                        {
-                            player[i].isAlive = true;
-                            InitGame();
-                            
-                        }
-                        if (player[i].isAlive)
-                        {
-                            if (player[i].isLeftTeam) leftTeamAlive = true;
-                            if (!player[i].isLeftTeam) rightTeamAlive = true;
-                        }
-                        
-                    }
-                    if (leftTeamAlive && rightTeamAlive)
-                    {
-                        shellOnAir = false;
-                        shell.active = false;
-
-                        playerTurn++;
-
-                        if (playerTurn == MAX_PLAYERS) playerTurn = 0;
-                    }
-                    else
-                    {
-                        gameOver = true;
-                        
-                        if (leftTeamAlive) winner = 1;
-                        if (rightTeamAlive) winner = 2;
-                    }
+                    SaveMatch();
+                    remove(RESUME_SNAPSHOT);        // Nothing left to resume
+                    remove(RESUME_REPLAY);
                 }
             }
+
+            UpdateParticles(frameTime);
         }
     }
     else
     {
-        if (IsKeyPressed(KEY_ENTER))
-        {
-            InitLives();
-            InitGame();
-            gameOver = false;
-        }
+        if (IsKeyPressed(KEY_ENTER) && (!networked || net.isHost)) StartMatch();
     }
 }
 
 // Draw game (one frame)
 void DrawGame(void)
 {
-    BeginDrawing();
+    Player *player = game.player;
+    int playerTurn = game.playerTurn;
 
-        ClearBackground(RAYWHITE);
+    UpdateResolution(frameDrawn ? frameTime : 0.0f);      // The time of a frame after a skipped one is not the GPU
 
-        if (!gameOver)
-        {
-            //Draw background
-            DrawRectangle(0,0, screenWidth, screenHeight, SKYBLUE);
+    BeginProfilePhase(PROFILE_TERRAIN);
+    UpdateTerrainLayer();
+    EndProfilePhase(PROFILE_TERRAIN);
 
-            DrawText(TextFormat("%i LIVES",player[0].lives), screenWidth /2 - 100, 20 , 20,DARKBLUE);
-            DrawText("---", screenWidth /2, 20 , 20,BLACK);
-            DrawText(TextFormat("%i LIVES ",player[1].lives), screenWidth /2 + 50, 20 , 20, RED);
+    // The world is drawn shifted by the view, at the render scale, into a texture stretched to the window
+    BeginWorldMode(viewLeft);
 
-            // Draw buildings
-            for (int i = 0; i < MAX_BUILDINGS; i++) DrawRectangleRec(building[i].rectangle, building[i].color);
+        if (!game.gameOver)
+        {
+            // Draw background, buildings and explosions
+            BeginProfilePhase(PROFILE_TERRAIN);
+            DrawTerrainLayer();
+            EndProfilePhase(PROFILE_TERRAIN);
+
+            BeginProfilePhase(PROFILE_SPRITES);
 
-            // Draw explosions
-            for (int i = 0; i < MAX_EXPLOSIONS; i++)
-            {
-                if (explosion[i].active) DrawCircle(explosion[i].position.x, explosion[i].position.y, explosion[i].radius, SKYBLUE);
-            }
-            
             // Draw players
-            for (int i = 0; i < MAX_PLAYERS; i++)
+            for (int i = 0; i < game.playerCount; i++)
             {
                 if (player[i].isAlive)
                 {
-                    if (player[i].isLeftTeam){
-                        DrawTexture(player[i].chassis, player[i].position.x - player[i].size.x/2, player[i].position.y + player[i].size.y/2 -player[i].chassis.height , RAYWHITE );              
-                    }
-                    else {
-                        DrawTexture(player[i].chassis, player[i].position.x - player[i].size.x/2, player[i].position.y + player[i].size.y/2 -player[i].chassis.height , RAYWHITE );
-                    }
+                    SpriteId sprite = player[i].isLeftTeam ? SPRITE_TANK_BLUE : SPRITE_TANK_RED;
+
+                    DrawSprite(sprite, (Vector2){ player[i].position.x - player[i].size.x/2, player[i].position.y + player[i].size.y/2 - GetSpriteRec(sprite).height }, RAYWHITE);
+                    CountDrawCalls(1);
                 }
             }
 
-            // Draw shell
-            if (shell.active){
-                    DrawRectanglePro(shell.rectangle, (Vector2){0,0},shell.rotation, MAROON);
-            } 
+            // Draw shells
+            DrawShells();
+
+            // Draw debris and smoke, in a few batches
+            CountDrawCalls(DrawParticles((Rectangle){ viewLeft, 0, screenWidth, screenHeight }));
 
+            EndProfilePhase(PROFILE_SPRITES);
+
+            BeginProfilePhase(PROFILE_HUD);
 
             // Draw the angle and the power of the aim, and the previous ones
-            if (!shellOnAir)
+            if (!game.shellOnAir)
             {
+                DrawPreview(playerTurn);
+
                 // Draw aim
                 if (player[playerTurn].isLeftTeam)
                 {
@@ -366,284 +434,717 @@ void DrawGame(void)
                     DrawLineEx((Vector2){ player[playerTurn].position.x, player[playerTurn].position.y },
                                player[playerTurn].aimingPoint,2 , MAROON);
                 }
+
+                CountDrawCalls(2);
             }
 
+            EndProfilePhase(PROFILE_HUD);
+        }
+
+    EndWorldMode();
+
+    BeginDrawing();
+
+        ClearBackground(BLACK);     // Sides left by a window of another shape
+
+        BeginProfilePhase(PROFILE_PRESENT);
+        DrawWorld();
+        EndProfilePhase(PROFILE_PRESENT);
+        CountDrawCalls(1);
+
+        // The HUD is drawn over it in the window, at its resolution
+        BeginHudMode();
+
+        if (!game.gameOver)
+        {
+            BeginProfilePhase(PROFILE_HUD);
+
+            int teamLives[2] = { 0 };
+
+            for (int i = 0; i < game.playerCount; i++) teamLives[player[i].isLeftTeam ? 0 : 1] += player[i].lives;
+
+            DrawText(TextFormat("%i LIVES",teamLives[0]), screenWidth /2 - 100, 20 , 20,DARKBLUE);
+            DrawText("---", screenWidth /2, 20 , 20,BLACK);
+            DrawText(TextFormat("%i LIVES ",teamLives[1]), screenWidth /2 + 50, 20 , 20, RED);
+            CountDrawCalls(4);
+
+            if (replaying) DrawText(TextFormat("REPLAY %i/%i", replayCursor, replay.inputCount), 20, 20, 20, DARKGRAY);
+            else
+            {
+                const Player *current = &game.player[game.playerTurn];
+
+                DrawText(GetMunitionName(munition), 20, 20, 20, DARKGRAY);
+                if (!current->isPlayer) DrawText(TextFormat("AI %s", GetAILevelName(aiLevel)), screenWidth - MeasureText(TextFormat("AI %s", GetAILevelName(aiLevel)), 20) - 20, 20, 20, current->isLeftTeam ? DARKBLUE : RED);
+                CountDrawCalls(current->isPlayer ? 0 : 1);
+            }
+
+            if (game.physics == PHYSICS_WIND) DrawText(TextFormat("WIND %s %i", (game.wind < 0.0f) ? "<" : ">", (int)fabsf(game.wind)), 20, 45, 20, DARKGRAY);
+            CountDrawCalls((game.physics == PHYSICS_WIND) ? 1 : 0);
+
             if (pause) DrawText("GAME PAUSED", screenWidth/2 - MeasureText("GAME PAUSED", 40)/2, screenHeight/2 - 40, 40, GRAY);
+            CountDrawCalls(pause ? 1 : 0);
+
+            if (networked)
+            {
+                const char *status = net.isHost ? "HOST, BLUE TEAM" : "CLIENT, RED TEAM";
+                Color color = DARKGRAY;
 
+                if (!net.connected) status = net.isHost ? "WAITING FOR THE OTHER PLAYER" : "CONNECTING TO THE HOST";
+                else if (waitingMatch) status = "WAITING FOR THE HOST";
+                else if (net.lost) { status = "CONNECTION LOST"; color = RED; }
+                else if (net.desync) { status = TextFormat("DESYNC AT TURN %i", net.desyncTurn); color = RED; }
 
+                DrawText(status, screenWidth/2 - MeasureText(status, 20)/2, 50, 20, color);
+                CountDrawCalls(1);
+            }
+
+            EndProfilePhase(PROFILE_HUD);
         }
-        else 
+        else
         {
-            DrawText("PRESS [ENTER] TO PLAY AGAIN", GetScreenWidth()/2 - MeasureText("PRESS [ENTER] TO PLAY AGAIN", 20)/2, GetScreenHeight()/2 - 50, 20, GRAY);
-            if (winner == 1)
+            BeginProfilePhase(PROFILE_HUD);
+            const char *again = (networked && !net.isHost) ? "WAITING FOR THE HOST TO PLAY AGAIN" : "PRESS [ENTER] TO PLAY AGAIN";
+
+            DrawText(again, screenWidth/2 - MeasureText(again, 20)/2, screenHeight/2 - 50, 20, GRAY);
+            if (game.winner == 1)
             {
-                DrawText("BLUE TEAM WINS",GetScreenWidth()/2 - MeasureText("BLUE TEAM WINS", 20)/2, 40, 20, BLUE );
+                DrawText("BLUE TEAM WINS",screenWidth/2 - MeasureText("BLUE TEAM WINS", 20)/2, 40, 20, BLUE );
             }
             else {
-                DrawText("RED TEAM WINS",GetScreenWidth()/2 - MeasureText("RED TEAM WINS", 20)/2, 40, 20, RED );
+                DrawText("RED TEAM WINS",screenWidth/2 - MeasureText("RED TEAM WINS", 20)/2, 40, 20, RED );
             }
+            CountDrawCalls(2);
+            EndProfilePhase(PROFILE_HUD);
         }
-            
 
+        EndHudMode();
+
+        if (showProfiler)
+        {
+            Vector2 renderSize = GetRenderSize();
+
+            // At the pixels of the window, whatever its size
+            BeginProfilePhase(PROFILE_HUD);
+            DrawProfilerOverlay(20, 50);
+            DrawText(TextFormat("world %ix%i (%i%%)", (int)renderSize.x, (int)renderSize.y, (int)(GetRenderScale()*100.0f + 0.5f)), 26, 190, 10, DARKGRAY);
+            CountDrawCalls(1);
+            EndProfilePhase(PROFILE_HUD);
+        }
+
+    BeginProfilePhase(PROFILE_PRESENT);
     EndDrawing();
+    EndProfilePhase(PROFILE_PRESENT);
 }
 
 // Unload game variables
 void UnloadGame(void)
 {
-   for (int i = 0; i < MAX_PLAYERS; i++)
-   {
-       UnloadTexture(player[i].chassis);
-   }
+   CloseAudio();
+
+   UnloadAssets();
 
+   for (int i = 0; i < LAYER_CHUNKS; i++) UnloadRenderTexture(terrainLayer[i]);
+   UnloadTexture(terrainMask);
 }
 
 // Update and Draw (one frame)
 void UpdateDrawFrame(void)
 {
+    frameTime = NextIdleFrame();
+
+    NextProfileFrame();
+
+    BeginProfilePhase(PROFILE_UPDATE);
     UpdateGame();
-    DrawGame();
+    UpdateView();
+    EndProfilePhase(PROFILE_UPDATE);
+
+    // With --idle, a frame showing the same as the last one drawn is skipped
+    bool drawn = NeedsRedraw(GetFrameKey(), IsAnimating());
+
+    if (drawn) DrawGame();
+
+    BeginProfilePhase(PROFILE_MUSIC);
+    UpdateAudio();
+    EndProfilePhase(PROFILE_MUSIC);
+
+    // Opening the audio device and the soundtrack takes a while: the first frame is shown before
+    if (!audioStarted)
+    {
+        TraceLog(LOG_INFO, "First frame on screen %.1f ms after the window opened", GetTime()*1000.0);
+        StartAudio();
+    }
+
+    if (!drawn) WaitIdle();     // Until an input event, the game and the music are still updated every IDLE_WAIT
+
+    frameDrawn = drawn;
+}
+
+// Open the audio device and start the soundtrack
+void StartAudio(void)
+{
+    InitAudioDevice();                                           //Initialize audio device
+
+    InitAudio(polyphony);
+
+    SetMasterVolume(0.1);                                        //On baisse le volume sinon ça pique les oreilles
+
+    PlayMusic(MUSIC_SOUNDTRACK);                                 //La soundtrack, jouée indéfiniment
+
+    audioStarted = true;
 }
 
 //--------------------------------------------------------------------------------------
 // Additional module functions
 //--------------------------------------------------------------------------------------
-static void InitBuildings(void)
+
+// Aim with the mouse and fire on left click
+static void UpdatePlayer(int playerTurn)
 {
-    // Horizontal generation
-    int currentWidth = 0;
+    Player *player = game.player;
+    Vector2 mouse = GetGameMousePosition();
 
-    // We make sure the absolute error randomly generated for each building, has as a minimum value the screenWidth.
-    // This way all the screen will be filled with buildings. Each building will have a different, random width.
+    mouse.x += viewLeft;        // In the world
+
+    // The aim is only computed again when the mouse moves
+    if ((mouse.x != player[playerTurn].aimingPoint.x) || (mouse.y != player[playerTurn].aimingPoint.y))
+    {
+        // If we are aiming at the firing quadrant, we calculate the angle
+        if ((mouse.y <= player[playerTurn].position.y) &&
+            (( player[playerTurn].isLeftTeam && mouse.x >= player[playerTurn].position.x) ||       // Left team
+             (!player[playerTurn].isLeftTeam && mouse.x <= player[playerTurn].position.x)))        // Right team
+        {
+            float power = hypotf(player[playerTurn].position.x - mouse.x, player[playerTurn].position.y - mouse.y);
+
+            // Distance (calculating the fire power)
+            player[playerTurn].aimingPower = power;
+            // Calculates the angle via arcsin
+            player[playerTurn].aimingAngle = (power > 0.0f) ? asinf((player[playerTurn].position.y - mouse.y)/power)*RAD2DEG : 0;
+            // Point of the world we are aiming at
+            player[playerTurn].aimingPoint = mouse;
+        }
+        else
+        {
+            player[playerTurn].aimingPoint = player[playerTurn].position;
+            player[playerTurn].aimingPower = 0;
+            player[playerTurn].aimingAngle = 0;
+        }
+    }
 
-    float relativeWidth = 100/(100 - BUILDING_RELATIVE_ERROR);
-    float buildingWidthMean = (screenWidth*relativeWidth/MAX_BUILDINGS) + 1;        // We add one to make sure we will cover the whole screen.
+    // Shell fired
+    if ((player[playerTurn].aimingPower > 0) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+    {
+        player[playerTurn].previousPoint = player[playerTurn].aimingPoint;
+        FireShot(player[playerTurn].aimingAngle, player[playerTurn].aimingPower, munition);
+    }
+}
 
-    // Vertical generation
-    int currentHeighth = 0;
-    int greenLevel;
+// Let the AI aim and fire after a short pause
+static void UpdateAI(int playerTurn)
+{
+    aiThinkTime += frameTime;
 
-    // Creation
-    for (int i = 0; i < MAX_BUILDINGS; i++)
+    if (aiThinkTime >= AI_THINK_TIME)
     {
-        // Horizontal
-        building[i].rectangle.x = currentWidth;
-        building[i].rectangle.width = GetRandomValue(buildingWidthMean*(100 - BUILDING_RELATIVE_ERROR/2)/100 + 1, buildingWidthMean*(100 + BUILDING_RELATIVE_ERROR)/100);
+        int angle = 0;
+        int power = 0;
+
+        aiThinkTime = 0.0f;
 
-        currentWidth += building[i].rectangle.width;
+        AIChooseShot(&game, GetAIConfig(aiLevel), &angle, &power);
 
-        // Vertical
-        currentHeighth = GetRandomValue(BUILDING_MIN_RELATIVE_HEIGHT, BUILDING_MAX_RELATIVE_HEIGHT);
-        building[i].rectangle.y = screenHeight - (screenHeight*currentHeighth/100);
-        building[i].rectangle.height = screenHeight*currentHeighth/100 + 1;
+        ShowShot(playerTurn, angle, power);
 
-        // Color
-        greenLevel = GetRandomValue(BUILDING_MIN_GREENSCALE_COLOR, BUILDING_MAX_GREENSCALE_COLOR);
-        building[i].color = (Color){ 0, greenLevel, greenLevel/4, 255 };
+        FireShot(angle, power, MUNITION_SHELL);
     }
 }
 
-static void InitPlayers(void)
+// Play back the next recorded input, at the pace of the AI
+static void UpdateReplay(int playerTurn)
 {
-    for (int i = 0; i < MAX_PLAYERS; i++)
-    {
-        player[i].isAlive = true;
-        // Decide the team of this player
-        if (i % 2 == 0) {
-            player[i].isLeftTeam = true;
-            player[i].chassis = LoadTexture("C:/MLOD/Projets/mini-projet-language-c/resources/TankBleu.png");
-            }
-        else {
-            player[i].isLeftTeam = false;
-            player[i].chassis = LoadTexture("C:/MLOD/Projets/mini-projet-language-c/resources/TankRouge.png");
-            }
+    if (replayCursor >= replay.inputCount) return;
 
+    aiThinkTime += frameTime;
 
-        // Now there is no AI
-        player[i].isPlayer = true;
-
-        // Set size, by default by now
-        player[i].size = (Vector2){ 50, 50 };
+    if (aiThinkTime >= AI_THINK_TIME)
+    {
+        ReplayInput input = replay.inputs[replayCursor++];
 
-        // Set position
-        if (player[i].isLeftTeam) player[i].position.x = GetRandomValue(screenWidth*MIN_PLAYER_POSITION/100, screenWidth*MAX_PLAYER_POSITION/100);
-        else player[i].position.x = screenWidth - GetRandomValue(screenWidth*MIN_PLAYER_POSITION/100, screenWidth*MAX_PLAYER_POSITION/100);
+        aiThinkTime = 0.0f;
 
-        for (int j = 0; j < MAX_BUILDINGS; j++)
+        if (input.power == REPLAY_NEW_MAP) InitGame(&game);
+        else if (input.power == REPLAY_PREVIOUS_MAP) InitPreviousMap(&game);
+        else
         {
-            if (building[j].rectangle.x > player[i].position.x)
-            {
-                // Set the player in the center of the building
-                player[i].position.x = building[j-1].rectangle.x + building[j-1].rectangle.width/2;
-                // Set the player at the top of the building
-                player[i].position.y = building[j-1].rectangle.y - player[i].size.y/2;
-                break;
-            }
+            ShowShot(playerTurn, input.angle, input.power);
+            FireMunition(&game, input.angle, input.power, (Munition)input.munition);
         }
+    }
+}
+
+// Apply the next input of the other machine, as soon as it arrives
+static void UpdateRemote(int playerTurn)
+{
+    ReplayInput input = { 0 };
 
-        // Set statistics to 0
-        player[i].aimingPoint = player[i].position;
-        player[i].previousAngle = 0;
-        player[i].previousPower = 0;
-        player[i].previousPoint = player[i].position;
-        player[i].aimingAngle = 0;
-        player[i].aimingPower = 0;
+    if (!ReceiveNetInput(&net, &game, &input)) return;
 
-        player[i].impactPoint = (Vector2){ -100, -100 };
+    if (input.power == REPLAY_NEW_MAP)
+    {
+        InitGame(&game);
+        RecordNewMap(&replay);
+    }
+    else if (input.power == REPLAY_PREVIOUS_MAP)
+    {
+        InitPreviousMap(&game);
+        RecordPreviousMap(&replay);
+    }
+    else
+    {
+        ShowShot(playerTurn, input.angle, input.power);
+        if (FireMunition(&game, input.angle, input.power, (Munition)input.munition)) RecordShot(&replay, input.angle, input.power, (Munition)input.munition);
     }
 }
 
-static bool UpdatePlayer(int playerTurn)
+// Exchange the network messages, and start the match of the host when it comes
+static void UpdateNetwork(void)
 {
-    // If we are aiming at the firing quadrant, we calculate the angle
-    if (GetMousePosition().y <= player[playerTurn].position.y)
+    UpdateNet(&net, GetTime());
+
+    if (!net.isHost && (waitingMatch || game.gameOver) && ReceiveNetMatch(&net, &replay))
     {
-        // Left team
-        if (player[playerTurn].isLeftTeam && GetMousePosition().x >= player[playerTurn].position.x)
-        {
-            // Distance (calculating the fire power)
-            player[playerTurn].aimingPower = sqrt(pow(player[playerTurn].position.x - GetMousePosition().x, 2) + pow(player[playerTurn].position.y - GetMousePosition().y, 2));
-            // Calculates the angle via arcsin
-            player[playerTurn].aimingAngle = asin((player[playerTurn].position.y - GetMousePosition().y)/player[playerTurn].aimingPower)*RAD2DEG;
-            // Point of the screen we are aiming at
-            player[playerTurn].aimingPoint = GetMousePosition();
+        StartReplay(&replay, &game);
+        BeginReplay(&replay, &game, replay.seed);
+        waitingMatch = false;
+    }
+}
 
-            // Shell fired
-            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
-            {
-                player[playerTurn].previousPoint = player[playerTurn].aimingPoint;
-                player[playerTurn].previousPower = player[playerTurn].aimingPower;
-                player[playerTurn].previousAngle = player[playerTurn].aimingAngle;
-                shell.position = player[playerTurn].position;
-                shell.rotation = player[playerTurn].aimingAngle;
+// Fire a shot of the current player: recorded, and sent to the other machine in a network game
+static void FireShot(int angle, int power, Munition munition)
+{
+    unsigned int checksum = networked ? GetGameChecksum(&game) : 0;
 
-                return true;
-            }
-        }
-        // Right team
-        else if (!player[playerTurn].isLeftTeam && GetMousePosition().x <= player[playerTurn].position.x)
-        {
-            // Distance (calculating the fire power)
-            player[playerTurn].aimingPower = sqrt(pow(player[playerTurn].position.x - GetMousePosition().x, 2) + pow(player[playerTurn].position.y - GetMousePosition().y, 2));
-            // Calculates the angle via arcsin
-            player[playerTurn].aimingAngle = asin((player[playerTurn].position.y - GetMousePosition().y)/player[playerTurn].aimingPower)*RAD2DEG;
-            // Point of the screen we are aiming at
-            player[playerTurn].aimingPoint = GetMousePosition();
+    if (!FireMunition(&game, angle, power, munition)) return;
 
-            // Shell fired
-            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
-            {
-                player[playerTurn].previousPoint = player[playerTurn].aimingPoint;
-                player[playerTurn].previousPower = player[playerTurn].aimingPower;
-                player[playerTurn].previousAngle = player[playerTurn].aimingAngle;
-                shell.position = player[playerTurn].position;
-                shell.rectangle.x = shell.position.x - shell.rectangle.width/2;
-                shell.rectangle.y = shell.position.y - shell.rectangle.height/2;
-                shell.rotation = player[playerTurn].aimingAngle;
-
-                return true;
-            }
-        }
-        else
-        {
-            player[playerTurn].aimingPoint = player[playerTurn].position;
-            player[playerTurn].aimingPower = 0;
-            player[playerTurn].aimingAngle = 0;
-        }
+    if (!RecordShot(&replay, angle, power, munition)) TraceLog(LOG_WARNING, "Shot could not be recorded, the replay of match %u is incomplete", replay.seed);
+    if (networked) SendNetInput(&net, (ReplayInput){ (short)angle, (short)power, (unsigned char)munition }, checksum);
+}
+
+// Generate a new map, on the turn of this machine in a network game
+static void NewMap(void)
+{
+    if (networked)
+    {
+        if (game.shellOnAir || !IsNetPlayer(&net, &game.player[game.playerTurn])) return;
+
+        SendNetInput(&net, (ReplayInput){ 0, REPLAY_NEW_MAP, 0 }, GetGameChecksum(&game));
+    }
+
+    InitGame(&game);
+    RecordNewMap(&replay);
+    turnSaved = false;
+}
+
+// Play the previous map again from its seed, as a new map
+static void PreviousMap(void)
+{
+    if (networked)
+    {
+        if (game.shellOnAir || !IsNetPlayer(&net, &game.player[game.playerTurn])) return;
+
+        SendNetInput(&net, (ReplayInput){ 0, REPLAY_PREVIOUS_MAP, 0 }, GetGameChecksum(&game));
+    }
+
+    InitPreviousMap(&game);
+    RecordPreviousMap(&replay);
+    turnSaved = false;
+}
+
+// Start a match: a new recorded one, the one of the replay again, or the next one of the network host
+static void StartMatch(void)
+{
+    if (replaying)
+    {
+        StartReplay(&replay, &game);
+        replayCursor = 0;
     }
+    else if (networked && !net.isHost) waitingMatch = true;
     else
     {
-        player[playerTurn].aimingPoint = player[playerTurn].position;
-        player[playerTurn].aimingPower = 0;
-        player[playerTurn].aimingAngle = 0;
+        unsigned int seed = (unsigned int)time(NULL) + matchCount++;
+
+        SeedGame(&game, seed);
+        SetPlayerCount(&game, playerCount);
+        SetWorldScreens(&game, worldScreens);
+        SetPhysicsMode(&game, physics);
+        InitLives(&game);
+        InitGame(&game);
+        BeginReplay(&replay, &game, seed);
+
+        if (networked) SendNetMatch(&net, &replay);
     }
 
-    return false;
+    ClearSnapshotRing(&history);
+    turnSaved = false;
+}
+
+// Write the recorded match in the working directory, named after its seed
+static void SaveMatch(void)
+{
+    EndReplay(&replay, &game);
+
+    if (!SaveReplay(&replay, TextFormat("replay-%u.tdr", replay.seed))) TraceLog(LOG_WARNING, "Replay of match %u could not be saved", replay.seed);
 }
 
-static bool UpdateShell(int playerTurn)
+// Keep the state at the start of the turn, and write it out to resume the match after a crash
+// NOTE: The tag of a snapshot is the number of inputs recorded before it
+static void SaveTurn(void)
 {
-    static int explosionNumber = 0;
+    turnSaved = true;
 
-    // Activate shell
-    if (!shell.active)
+    if (replaying || networked) return;
+
+    PushSnapshot(&history, &game, replay.inputCount);
+
+    if (!SaveSnapshotFile(&game, replay.inputCount, RESUME_SNAPSHOT) || !SaveReplay(&replay, RESUME_REPLAY)) TraceLog(LOG_WARNING, "Match could not be saved to resume it");
+}
+
+// Go back to the start of the previous turn of a human player, the inputs since are forgotten
+static void UndoTurn(void)
+{
+    if (networked || game.shellOnAir || (history.count < 2)) return;
+
+    unsigned int generation = game.terrain.generation;
+    bool isPlayer[MAX_PLAYERS];
+    int inputCount = 0;
+
+    for (int i = 0; i < MAX_PLAYERS; i++) isPlayer[i] = game.player[i].isPlayer;
+
+    PopSnapshot(&history, NULL, NULL);          // The turn being aimed
+
+    while (PopSnapshot(&history, &game, &inputCount) && !isPlayer[game.playerTurn] && (history.count > 0));
+
+    // The AI and human players stay as they are now, the renderers and the preview redraw everything
+    for (int i = 0; i < MAX_PLAYERS; i++) game.player[i].isPlayer = isPlayer[i];
+
+    game.terrain.generation = generation + 1;
+    replay.inputCount = inputCount;
+    aiThinkTime = 0.0f;
+    simulationTime = 0.0f;
+    turnSaved = false;
+}
+
+// Continue the match of the resume files, false if there is none or it does not check out
+static bool ResumeMatch(void)
+{
+    int inputCount = 0;
+
+    if (!LoadReplay(&replay, RESUME_REPLAY)) return false;
+
+    if (!LoadSnapshotFile(RESUME_SNAPSHOT, &game, &inputCount) || (inputCount > replay.inputCount) || game.gameOver)
+    {
+        TraceLog(LOG_WARNING, "%s does not continue %s, a new match starts", RESUME_SNAPSHOT, RESUME_REPLAY);
+        UnloadReplay(&replay);
+        return false;
+    }
+
+    replay.inputCount = inputCount;
+
+    return true;
+}
+
+// Fly the shells in fixed steps, the frame time left is carried over to the next frame
+static void UpdateFlight(void)
+{
+    simulationTime += frameTime;
+    if (simulationTime > MAX_FRAME_TIME) simulationTime = MAX_FRAME_TIME;
+
+    while (game.shellOnAir && !game.gameOver && (simulationTime >= SIMULATION_STEP))
     {
-        if (player[playerTurn].isLeftTeam)
+        simulationTime -= SIMULATION_STEP;
+
+        int craters = game.terrain.craterCount;
+        int lost = game.terrain.cratersLost;
+
+        StepGame(&game, SIMULATION_STEP);
+
+        if (game.terrain.cratersLost > lost) TraceLog(LOG_WARNING, "No room left in the terrain for %i more crater(s), not dug", game.terrain.cratersLost - lost);
+
+        // One explosion per crater, a barrage digs several in a step
+        for (int i = craters; i < game.terrain.craterCount; i++)
         {
-            shell.speed.x = cos(player[playerTurn].previousAngle*DEG2RAD)*player[playerTurn].previousPower*3/DELTA_FPS;
-            shell.speed.y = -sin(player[playerTurn].previousAngle*DEG2RAD)*player[playerTurn].previousPower*3/DELTA_FPS;
-            shell.active = true;
+            PlayVoice(SOUND_BOOM);
+            EmitExplosion(game.terrain.crater[i%TERRAIN_CRATER_LOG]);
         }
-        else
+    }
+
+    if (!game.shellOnAir) simulationTime = 0.0f;
+}
+
+// Muzzle flash at the tank that just fired, along its barrel
+static void EmitShot(int shooter)
+{
+    const Player *player = &game.player[shooter];
+    float direction = player->isLeftTeam ? 1.0f : -1.0f;
+    Vector2 barrel = { direction*cosf(player->previousAngle*DEG2RAD), -sinf(player->previousAngle*DEG2RAD) };
+
+    EmitMuzzleFlash(player->position, barrel);
+}
+
+// Draw the shells one step behind the physics, by how far the frame is into the next step:
+// the arcs are closed-form, so this is where they were between their last two physics states
+static void DrawShells(void)
+{
+    for (int i = 0; i < game.shellCount; i++)
+    {
+        const Shell *shell = &game.shell[game.liveShell[i]];
+        float time = shell->time - (SIMULATION_STEP - simulationTime);
+
+        if (time < 0.0f) time = 0.0f;                       // Just fired
+
+        Vector2 position = TrajectoryPosition(shell->trajectory, time);
+        Vector2 speed = TrajectoryVelocity(shell->trajectory, time);
+        Rectangle rectangle = { position.x - shell->rectangle.width/2, position.y - shell->rectangle.height/2, shell->rectangle.width, shell->rectangle.height };
+
+        DrawRectanglePro(rectangle, (Vector2){ 0, 0 }, atan2f(speed.y, speed.x)*RAD2DEG, MAROON);
+    }
+
+    CountDrawCalls(game.shellCount);
+}
+
+// Dot the arc the mouse aim would fly, the part of it the --preview option shows
+static void DrawPreview(int playerTurn)
+{
+    const Player *player = &game.player[playerTurn];
+
+    if ((previewShare <= 0) || (player->aimingPower <= 0) || !player->isPlayer || replaying) return;
+    if (networked && !IsNetPlayer(&net, player)) return;
+
+    const PreviewArc *arc = GetPreviewArc(&preview, &game, player->aimingAngle, player->aimingPower);
+    int shown = (previewShare >= 100) ? arc->pointCount : arc->pointCount*previewShare/100;
+    Color color = player->isLeftTeam ? DARKBLUE : MAROON;
+
+    for (int i = 1; i < shown; i++) DrawCircleV(arc->point[i], 2, Fade(color, 0.6f));
+
+    CountDrawCalls((shown > 1) ? shown - 1 : 0);
+
+    // Where it lands, when the whole arc is shown
+    if ((shown == arc->pointCount) && (arc->event != SHELL_MISSED))
+    {
+        DrawCircleLines(arc->point[shown - 1].x, arc->point[shown - 1].y, 6, color);
+        CountDrawCalls(1);
+    }
+}
+
+// Show a shot that was not aimed with the mouse like a mouse aim would have
+static void ShowShot(int playerTurn, int angle, int power)
+{
+    Player *player = game.player;
+    float direction = player[playerTurn].isLeftTeam ? 1.0f : -1.0f;
+
+    player[playerTurn].previousPoint.x = player[playerTurn].position.x + direction*cosf(angle*DEG2RAD)*power;
+    player[playerTurn].previousPoint.y = player[playerTurn].position.y - sinf(angle*DEG2RAD)*power;
+}
+
+// Follow the shells in flight, otherwise the tank whose turn it is, that [LEFT] and [RIGHT] pan away from
+static void UpdateView(void)
+{
+    float halfScreen = screenWidth/2.0f;
+
+    if (game.shellOnAir)
+    {
+        float sum = 0.0f;
+
+        for (int i = 0; i < game.shellCount; i++) sum += game.shell[game.liveShell[i]].position.x;
+
+        if (game.shellCount > 0) cameraFocus = sum/game.shellCount;
+        cameraTurn = -1;
+    }
+    else
+    {
+        if ((cameraTurn != game.playerTurn) || (cameraGeneration != game.terrain.generation))
         {
-            shell.speed.x = -cos(player[playerTurn].previousAngle*DEG2RAD)*player[playerTurn].previousPower*3/DELTA_FPS;
-            shell.speed.y = -sin(player[playerTurn].previousAngle*DEG2RAD)*player[playerTurn].previousPower*3/DELTA_FPS;
-            shell.active = true;
+            cameraFocus = game.player[game.playerTurn].position.x;
+            cameraTurn = game.playerTurn;
         }
+
+        if (IsKeyDown(KEY_LEFT)) cameraFocus -= CAMERA_PAN_SPEED*frameTime;
+        if (IsKeyDown(KEY_RIGHT)) cameraFocus += CAMERA_PAN_SPEED*frameTime;
     }
 
-    shell.position.x += shell.speed.x;
-    shell.position.y += shell.speed.y;
-    shell.rectangle.x = shell.position.x - shell.rectangle.width/2;
-    shell.rectangle.y = shell.position.y - shell.rectangle.height/2;
-    shell.speed.y += GRAVITY/DELTA_FPS;
-    shell.rotation = atan2(shell.speed.y, shell.speed.x)*RAD2DEG;
+    if (cameraFocus > game.worldWidth - halfScreen) cameraFocus = game.worldWidth - halfScreen;
+    if (cameraFocus < halfScreen) cameraFocus = halfScreen;
 
-    // Collision
-    if (shell.position.x + shell.radius < 0) return true;                        // These two first cases are when the shell goes out of the window, either on the left or the right
-    else if (shell.position.x - shell.radius > screenWidth) return true;
-    else
+    // A new map is shown at once, without the effects of the previous one, the view glides otherwise
+    if (cameraGeneration != game.terrain.generation)
+    {
+        cameraGeneration = game.terrain.generation;
+        cameraX = cameraFocus - halfScreen;
+        ClearParticles();
+    }
+    else cameraX += (cameraFocus - halfScreen - cameraX)*fminf(1.0f, CAMERA_SPEED*frameTime);
+
+    viewLeft = (int)cameraX;
+}
+
+// Bake the chunks coming into view on a free layer, then only patch the new craters in
+static void UpdateTerrainLayer(void)
+{
+    int first = viewLeft/TERRAIN_CHUNK_WIDTH;
+    int last = (viewLeft + screenWidth - 1)/TERRAIN_CHUNK_WIDTH;
+
+    if (last >= game.terrain.chunkCount) last = game.terrain.chunkCount - 1;
+
+    if (game.terrain.generation != terrainGeneration)
+    {
+        terrainGeneration = game.terrain.generation;
+        terrainCraters = game.terrain.craterCount;         // Baked in with the rest
+
+        for (int i = 0; i < LAYER_CHUNKS; i++) layerChunk[i] = -1;
+    }
+
+    if (game.terrain.craterCount > terrainCraters)
     {
-        // Player collision
-      for (int i = 0; i < MAX_PLAYERS; i++)
+        if (game.terrain.craterCount - terrainCraters > TERRAIN_CRATER_LOG) terrainCraters = game.terrain.craterCount - TERRAIN_CRATER_LOG;
+
+        for (int i = terrainCraters; i < game.terrain.craterCount; i++)
         {
-            if (CheckCollisionCircleRec(shell.position, shell.radius,  (Rectangle){ player[i].position.x - player[i].size.x/2, player[i].position.y + player[i].size.y/2 - player[i].chassis.height ,
-                                                                                  player[i].size.x, player[i].chassis.height }))
+            Vector2 crater = game.terrain.crater[i%TERRAIN_CRATER_LOG];
+
+            for (int j = 0; j < LAYER_CHUNKS; j++)
             {
-                // We can't hit ourselves
-                if (i == playerTurn) return false;
-                else
-                {
-                    // We set the impact point
-                    player[playerTurn].impactPoint.x = shell.position.x;
-                    player[playerTurn].impactPoint.y = shell.position.y + shell.radius;
+                int chunkX = layerChunk[j]*TERRAIN_CHUNK_WIDTH;
 
-                    player[i].lives --;
-                    player[i].isAlive = false;
-                    return true;
-                }
+                if ((layerChunk[j] < 0) || (crater.x + CRATER_RADIUS < chunkX) || (crater.x - CRATER_RADIUS >= chunkX + TERRAIN_CHUNK_WIDTH)) continue;
+
+                BeginTextureMode(terrainLayer[j]);
+                    DrawCircle(crater.x - chunkX, crater.y, CRATER_RADIUS, SKYBLUE);
+                EndTextureMode();
+
+                CountDrawCalls(1);
             }
         }
 
-        // Building collision
-        // NOTE: We only check building collision if we are not inside an explosion
-        for (int i = 0; i < MAX_BUILDINGS; i++)
+        terrainCraters = game.terrain.craterCount;
+    }
+
+    // The bits of the chunks in view are kept for the next frames, the baked ones are drawn from them
+    RequireTerrain(&game.terrain, first*TERRAIN_CHUNK_WIDTH, (last + 1)*TERRAIN_CHUNK_WIDTH - 1);
+
+    for (int chunk = first; chunk <= last; chunk++)
+    {
+        int free = -1;
+        bool baked = false;
+
+        for (int i = 0; i < LAYER_CHUNKS; i++)
         {
-            if (CheckCollisionCircles(shell.position, shell.radius, explosion[i].position, explosion[i].radius - shell.radius))
-            {
-                return false;
-            }
+            if (layerChunk[i] == chunk) baked = true;
+            else if ((layerChunk[i] < first) || (layerChunk[i] > last)) free = i;
+        }
+
+        if (!baked && (free >= 0)) BakeTerrainChunk(free, chunk);
+    }
+}
+
+// Draw the sky, the buildings and the craters of a chunk from its plan: one rectangle per building and
+// one circle per crater, or the sky of its bits uploaded as a mask once the chunk was baked and has no plan left
+static void BakeTerrainChunk(int layer, int chunk)
+{
+    const Terrain *terrain = &game.terrain;
+    int chunkX = chunk*TERRAIN_CHUNK_WIDTH;
+    bool baked = (terrain->bakedSlot[chunk] >= 0);
+
+    BeginTextureMode(terrainLayer[layer]);
+        ClearBackground(SKYBLUE);
+
+        for (int i = 0; i < game.buildingCount; i++)
+        {
+            Rectangle rec = game.building[i].rectangle;
+            int x0 = ((int)rec.x > chunkX) ? (int)rec.x : chunkX;                  // Same rounding as FillTerrainRec()
+            int x1 = (int)(rec.x + rec.width) - 1;
+            int y0 = ((int)rec.y > 0) ? (int)rec.y : 0;
+            int y1 = (int)(rec.y + rec.height) - 1;
+
+            if (x1 >= chunkX + TERRAIN_CHUNK_WIDTH) x1 = chunkX + TERRAIN_CHUNK_WIDTH - 1;
+            if (y1 >= TERRAIN_HEIGHT) y1 = TERRAIN_HEIGHT - 1;
+            if ((x0 > x1) || (y0 > y1)) continue;
+
+            DrawRectangle(x0 - chunkX, y0, x1 - x0 + 1, y1 - y0 + 1, game.building[i].color);
+            CountDrawCalls(1);
         }
 
-        for (int i = 0; i < MAX_BUILDINGS; i++)
+        if (baked)
         {
-            if (CheckCollisionCircleRec(shell.position, shell.radius, building[i].rectangle))
+            for (int y = 0; y < TERRAIN_HEIGHT; y++)
             {
-                // We set the impact point
-                player[playerTurn].impactPoint.x = shell.position.x;
-                player[playerTurn].impactPoint.y = shell.position.y + shell.radius;
+                unsigned char *pixel = terrainMaskPixels + y*TERRAIN_CHUNK_WIDTH*2;
 
-                // We create an explosion
-                explosion[explosionNumber].position = player[playerTurn].impactPoint;
-                explosion[explosionNumber].active = true;
-                explosionNumber++;
+                for (int x = 0; x < TERRAIN_CHUNK_WIDTH; x++, pixel += 2)
+                {
+                    pixel[0] = 255;
+                    pixel[1] = IsTerrainSolid(terrain, chunkX + x, y) ? 0 : 255;
+                }
+            }
 
-                PlaySound(shell.fxBoom);
+            UpdateTexture(terrainMask, terrainMaskPixels);
+            DrawTexture(terrainMask, 0, 0, SKYBLUE);
+            CountDrawCalls(1);
+        }
 
-                return true;
-            }
+        for (int i = terrain->firstCrater[chunk]; i >= 0; i = terrain->planCrater[i].next)
+        {
+            const TerrainCrater *crater = &terrain->planCrater[i];
+
+            DrawCircle(crater->x - chunkX, crater->y, (float)crater->radius, SKYBLUE);
+            CountDrawCalls(1);
         }
+    EndTextureMode();
+
+    layerChunk[layer] = chunk;
+}
+
+// Draw the layers of the chunks in view
+// NOTE: Render texture must be y-flipped due to default OpenGL coordinates (left-bottom)
+static void DrawTerrainLayer(void)
+{
+    for (int i = 0; i < LAYER_CHUNKS; i++)
+    {
+        if (layerChunk[i] < 0) continue;
+
+        float x = (float)layerChunk[i]*TERRAIN_CHUNK_WIDTH;
+
+        if ((x + TERRAIN_CHUNK_WIDTH <= viewLeft) || (x >= viewLeft + screenWidth)) continue;
+
+        DrawTextureRec(terrainLayer[i].texture, (Rectangle){ 0, 0, TERRAIN_CHUNK_WIDTH, -TERRAIN_HEIGHT }, (Vector2){ x, 0 }, WHITE);
+        CountDrawCalls(1);
+    }
+}
+
+// Everything a frame shows besides what moves on its own (IsAnimating()): same key, same picture
+static unsigned int GetFrameKey(void)
+{
+    int state[] = { viewLeft, GetScreenWidth(), GetScreenHeight(), (int)(GetRenderScale()*100.0f + 0.5f), showProfiler,
+                    pause, game.gameOver, game.winner, game.playerTurn, munition, aiLevel, replayCursor,
+                    (int)game.terrain.generation, game.terrain.craterCount, net.connected, net.lost, net.desync, waitingMatch, (int)game.wind };
+    unsigned int key = HashBytes(2166136261u, state, sizeof(state));
+
+    for (int i = 0; i < game.playerCount; i++)
+    {
+        const Player *player = &game.player[i];
+        int status[3] = { player->isAlive, player->lives, player->isPlayer };     // isPlayer: the AI label of its turns
+
+        key = HashBytes(key, &player->aimingPoint, sizeof(Vector2));
+        key = HashBytes(key, &player->previousPoint, sizeof(Vector2));
+        key = HashBytes(key, status, sizeof(status));
     }
 
-    return false;
-}
\ No newline at end of file
+    return key;
+}
+
+// Shells, debris and smoke, the view gliding and the frame times overlay change every frame
+static bool IsAnimating(void)
+{
+    bool playing = !game.gameOver && !pause && (game.shellOnAir || (GetParticleCount() > 0));
+
+    return playing || showProfiler || (fabsf(cameraFocus - screenWidth/2.0f - cameraX) >= 1.0f);
+}
@@ -0,0 +1,451 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - map generator
+*
+*   Each attempt at a map and each screen of it draws from its own stream of the map seed
+*   (MixSeed()), so a wide world is not longer to find than a narrow one, and the attempt
+*   that passed the check is found again from the seed alone.
+*
+*   The cache is guarded by a mutex: it is only held to look a key up or to copy a map in or
+*   out, generating and checking a map happens outside of it.
+*
+********************************************************************************************/
+
+#include "game.h"
+
+#include <string.h>
+#include <math.h>
+
+#if defined(PLATFORM_WEB) && !defined(MAPGEN_NO_THREADS)
+    #define MAPGEN_NO_THREADS           // Emscripten builds are single threaded
+#endif
+
+#if !defined(MAPGEN_NO_THREADS)
+    #include <pthread.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define MAP_STREAMS  (MAX_WORLD_SCREENS + 1)        // Streams of an attempt: the spawns, then one per screen
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct MapCacheEntry {
+    MapParams params;               // Key
+    PhysicsMode physics;
+    unsigned int seed;
+    int screens;
+    int playerCount;
+    unsigned int aliveMask;
+
+    unsigned int lastUse;           // Cache clock of the last GetMap() of it, 0: free
+    GameMap map;
+} MapCacheEntry;
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static MapCacheEntry cache[MAP_CACHE_SIZE] = { 0 };
+static unsigned int cacheClock = 0;
+static int cacheHits = 0;
+static int cacheMisses = 0;
+#if !defined(MAPGEN_NO_THREADS)
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static int GenerateBuildings(const MapParams *params, unsigned int *state, Building *building, int x);
+static void PlaceTanks(GameMap *map, const MapParams *params, unsigned int *state, int worldWidth, int playerCount, unsigned int aliveMask);
+static bool IsMapFair(const GameMap *map, const MapParams *params, float gravity, int playerCount, unsigned int aliveMask);
+static int CountReachAngles(const GameMap *map, int shooter, int playerCount, unsigned int aliveMask, int enough, float gravity);
+static bool IsArcClear(const GameMap *map, Vector2 from, Vector2 to, int angle, float gravity);
+static MapCacheEntry *FindMap(const MapParams *params, PhysicsMode physics, unsigned int seed, int screens, int playerCount, unsigned int aliveMask);
+static void LockCache(void);
+static void UnlockCache(void);
+static unsigned int MixSeed(unsigned int seed, unsigned int stream);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+MapParams GetDefaultMapParams(void)
+{
+    MapParams params = { 0 };
+
+    params.buildingCount = MAX_BUILDINGS;
+    params.widthError = BUILDING_RELATIVE_ERROR;
+    params.minHeight = BUILDING_MIN_RELATIVE_HEIGHT;
+    params.maxHeight = BUILDING_MAX_RELATIVE_HEIGHT;
+    params.minGreen = BUILDING_MIN_GREENSCALE_COLOR;
+    params.maxGreen = BUILDING_MAX_GREENSCALE_COLOR;
+    params.minPlayerPosition = MIN_PLAYER_POSITION;
+    params.maxPlayerPosition = MAX_PLAYER_POSITION;
+    params.maxTeamPosition = MAX_TEAM_POSITION;
+    params.minReachAngles = MAP_MIN_REACH_ANGLES;
+    params.maxHeightGap = MAP_MAX_HEIGHT_GAP;
+    params.maxAttempts = MAP_MAX_ATTEMPTS;
+
+    return params;
+}
+
+// Draw maps from the streams of the seed until one is fair, or keep the last one
+void GenerateMap(GameMap *map, const MapParams *params, PhysicsMode physics, unsigned int seed, int screens, int playerCount, unsigned int aliveMask)
+{
+    MapParams valid = *params;
+
+    if (valid.buildingCount < 1) valid.buildingCount = 1;
+    if (valid.buildingCount > MAX_BUILDINGS) valid.buildingCount = MAX_BUILDINGS;
+    if (valid.widthError > 99) valid.widthError = 99;
+    if (valid.maxAttempts < 1) valid.maxAttempts = 1;
+
+    map->seed = seed;
+    map->fair = false;
+
+    for (int attempt = 0; (attempt < valid.maxAttempts) && !map->fair; attempt++)
+    {
+        unsigned int stream = (unsigned int)attempt*MAP_STREAMS;
+
+        map->attempts = attempt + 1;
+        map->buildingCount = 0;
+
+        for (int i = 0; i < screens; i++)
+        {
+            unsigned int state = SeedMapState(MixSeed(seed, stream + 1 + i));
+
+            map->buildingCount += GenerateBuildings(&valid, &state, map->building + map->buildingCount, i*screenWidth);
+        }
+
+        unsigned int state = SeedMapState(MixSeed(seed, stream));
+
+        PlaceTanks(map, &valid, &state, screens*screenWidth, playerCount, aliveMask);
+
+        map->wind = (float)GetMapRandomValue(&state, -PHYSICS_MAX_WIND, PHYSICS_MAX_WIND);      // Drawn last, the buildings and spawns do not depend on it
+
+        map->fair = IsMapFair(map, &valid, GetPhysicsGravity(physics), playerCount, aliveMask);
+    }
+}
+
+void GetMap(GameMap *map, const MapParams *params, PhysicsMode physics, unsigned int seed, int screens, int playerCount, unsigned int aliveMask)
+{
+    LockCache();
+
+    MapCacheEntry *entry = FindMap(params, physics, seed, screens, playerCount, aliveMask);
+
+    if (entry != NULL)
+    {
+        entry->lastUse = ++cacheClock;
+        cacheHits++;
+        memcpy(map, &entry->map, sizeof(GameMap));
+    }
+    else cacheMisses++;
+
+    UnlockCache();
+
+    if (entry != NULL) return;
+
+    GenerateMap(map, params, physics, seed, screens, playerCount, aliveMask);
+
+    LockCache();
+
+    // Another thread may have stored it meanwhile, otherwise it replaces the least recently used
+    entry = FindMap(params, physics, seed, screens, playerCount, aliveMask);
+
+    if (entry == NULL)
+    {
+        entry = &cache[0];
+
+        for (int i = 1; i < MAP_CACHE_SIZE; i++)
+        {
+            if (cache[i].lastUse < entry->lastUse) entry = &cache[i];
+        }
+
+        entry->params = *params;
+        entry->physics = physics;
+        entry->seed = seed;
+        entry->screens = screens;
+        entry->playerCount = playerCount;
+        entry->aliveMask = aliveMask;
+        memcpy(&entry->map, map, sizeof(GameMap));
+    }
+
+    entry->lastUse = ++cacheClock;
+
+    UnlockCache();
+}
+
+void ClearMapCache(void)
+{
+    LockCache();
+
+    for (int i = 0; i < MAP_CACHE_SIZE; i++) cache[i].lastUse = 0;
+
+    cacheHits = 0;
+    cacheMisses = 0;
+
+    UnlockCache();
+}
+
+void GetMapCacheStats(int *hits, int *misses)
+{
+    LockCache();
+
+    *hits = cacheHits;
+    *misses = cacheMisses;
+
+    UnlockCache();
+}
+
+// Xorshift, so a seed always gives the same maps
+int GetMapRandomValue(unsigned int *state, int min, int max)
+{
+    unsigned int x = *state ? *state : 0x9e3779b9u;     // Zero is a fixed point
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    if (min > max)
+    {
+        int tmp = max;
+        max = min;
+        min = tmp;
+    }
+
+    return min + (int)(x%(unsigned int)(max - min + 1));
+}
+
+// Spread close seeds apart
+unsigned int SeedMapState(unsigned int seed)
+{
+    return seed*2654435761u ^ 0x9e3779b9u;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+// Buildings of one screen from x on, cut at the end of the screen (the next one has its own)
+static int GenerateBuildings(const MapParams *params, unsigned int *state, Building *building, int x)
+{
+    int count = 0;
+
+    // Horizontal generation
+    int currentWidth = x;
+
+    // We make sure the absolute error randomly generated for each building, has as a minimum value the screenWidth.
+    // This way all the screen will be filled with buildings. Each building will have a different, random width.
+
+    float relativeWidth = 100/(100 - params->widthError);
+    float buildingWidthMean = (screenWidth*relativeWidth/params->buildingCount) + 1;        // We add one to make sure we will cover the whole screen.
+
+    // Vertical generation
+    int currentHeighth = 0;
+    int greenLevel;
+
+    // Creation
+    for (int i = 0; i < params->buildingCount; i++)
+    {
+        Building *current = &building[count];
+
+        // Horizontal
+        current->rectangle.x = currentWidth;
+        current->rectangle.width = GetMapRandomValue(state, buildingWidthMean*(100 - params->widthError/2)/100 + 1, buildingWidthMean*(100 + params->widthError)/100);
+
+        currentWidth += current->rectangle.width;
+
+        // Vertical
+        currentHeighth = GetMapRandomValue(state, params->minHeight, params->maxHeight);
+        current->rectangle.y = screenHeight - (screenHeight*currentHeighth/100);
+        current->rectangle.height = screenHeight*currentHeighth/100 + 1;
+
+        // Color
+        greenLevel = GetMapRandomValue(state, params->minGreen, params->maxGreen);
+        current->color = (Color){ 0, greenLevel, greenLevel/4, 255 };
+
+        if (current->rectangle.x + current->rectangle.width > x + screenWidth) current->rectangle.width = x + screenWidth - current->rectangle.x;
+        if (current->rectangle.width > 0) count++;
+    }
+
+    return count;
+}
+
+// Each tank in its own slot of the zone of its team, at the center of the building below it unless a tank stands there already
+static void PlaceTanks(GameMap *map, const MapParams *params, unsigned int *state, int worldWidth, int playerCount, unsigned int aliveMask)
+{
+    const Building *building = map->building;
+    bool buildingTaken[MAX_WORLD_BUILDINGS] = { false };
+
+    for (int i = 0; i < playerCount; i++)
+    {
+        bool leftTeam = (i%2 == 0);
+        int teamSize = leftTeam ? (playerCount + 1)/2 : playerCount/2;
+        int slot = i/2;
+        int zoneEnd = params->minPlayerPosition + (params->maxPlayerPosition - params->minPlayerPosition)*teamSize;
+
+        if (zoneEnd > params->maxTeamPosition) zoneEnd = params->maxTeamPosition;
+
+        int zoneStart = worldWidth*params->minPlayerPosition/100;
+        int zoneWidth = worldWidth*zoneEnd/100 - zoneStart;
+        int position = GetMapRandomValue(state, zoneStart + zoneWidth*slot/teamSize, zoneStart + zoneWidth*(slot + 1)/teamSize);
+
+        Vector2 *spawn = &map->spawn[i];
+
+        spawn->x = leftTeam ? position : worldWidth - position;
+
+        // Building below the tank
+        int j = 1;
+
+        while ((j < map->buildingCount) && (building[j].rectangle.x <= spawn->x)) j++;
+
+        if (!buildingTaken[j-1]) spawn->x = building[j-1].rectangle.x + building[j-1].rectangle.width/2;
+        if (aliveMask & (1u << i)) buildingTaken[j-1] = true;
+
+        spawn->y = building[j-1].rectangle.y - TANK_SIZE/2;
+    }
+}
+
+// The teams stand at close heights, and every tank has enough angles to hit an enemy
+static bool IsMapFair(const GameMap *map, const MapParams *params, float gravity, int playerCount, unsigned int aliveMask)
+{
+    float height[2] = { 0 };
+    int count[2] = { 0 };
+
+    for (int i = 0; i < playerCount; i++)
+    {
+        if (!(aliveMask & (1u << i))) continue;
+
+        height[i%2] += map->spawn[i].y;
+        count[i%2]++;
+    }
+
+    if ((count[0] == 0) || (count[1] == 0)) return true;
+
+    if (fabsf(height[0]/count[0] - height[1]/count[1]) > screenHeight*params->maxHeightGap/100.0f) return false;
+
+    if (params->minReachAngles <= 0) return true;
+
+    for (int i = 0; i < playerCount; i++)
+    {
+        if ((aliveMask & (1u << i)) && (CountReachAngles(map, i, playerCount, aliveMask, params->minReachAngles, gravity) < params->minReachAngles)) return false;
+    }
+
+    return true;
+}
+
+// Launch angles the tank hits at least one enemy with, over the roofs in between, counted up to enough
+static int CountReachAngles(const GameMap *map, int shooter, int playerCount, unsigned int aliveMask, int enough, float gravity)
+{
+    int count = 0;
+
+    for (int angle = MAP_REACH_MIN_ANGLE; (angle <= MAP_REACH_MAX_ANGLE) && (count < enough); angle += MAP_REACH_ANGLE_STEP)
+    {
+        for (int i = (shooter + 1)%2; i < playerCount; i += 2)
+        {
+            if ((aliveMask & (1u << i)) && IsArcClear(map, map->spawn[shooter], map->spawn[i], angle, gravity))
+            {
+                count++;
+                break;
+            }
+        }
+    }
+
+    return count;
+}
+
+// Arc launched at angle from one tank center through the other, with the power it takes:
+// altitude(d) = d*tan(angle) - k*d^2 at a distance d. Between the tanks the altitude is concave,
+// so over a building it is lowest at one of its edges: only those are tested against the roof
+static bool IsArcClear(const GameMap *map, Vector2 from, Vector2 to, int angle, float gravity)
+{
+    float distance = fabsf(to.x - from.x);
+    float slope = tanf(angle*DEG2RAD);
+    float drop = distance*slope - (from.y - to.y);      // Below the launch line at the target
+
+    if ((distance <= TANK_SIZE) || (drop <= 0.0f)) return false;
+
+    float k = drop/(distance*distance);                 // gravity/(2*speed^2*cos^2)
+    float cosine = cosf(angle*DEG2RAD);
+    float speed = sqrtf(gravity/(2.0f*k*cosine*cosine));
+
+    if (speed > MAP_REACH_MAX_POWER*SHELL_SPEED_SCALE) return false;
+
+    // The tanks themselves do not count, the shell leaves one and lands on the other
+    float low = fminf(from.x, to.x) + TANK_SIZE/2;
+    float high = fmaxf(from.x, to.x) - TANK_SIZE/2;
+
+    // First building under the arc, the buildings are in x order
+    int first = 0;
+    int last = map->buildingCount;
+
+    while (first < last)
+    {
+        int middle = (first + last)/2;
+
+        if (map->building[middle].rectangle.x + map->building[middle].rectangle.width <= low) first = middle + 1;
+        else last = middle;
+    }
+
+    for (int i = first; i < map->buildingCount; i++)
+    {
+        Rectangle rec = map->building[i].rectangle;
+
+        if (rec.x >= high) break;
+
+        float edge[2] = { fmaxf(rec.x, low), fminf(rec.x + rec.width, high) };
+
+        for (int e = 0; e < 2; e++)
+        {
+            float d = fabsf(edge[e] - from.x);
+
+            if (from.y - (d*slope - k*d*d) + SHELL_RADIUS > rec.y) return false;
+        }
+    }
+
+    return true;
+}
+
+// Entry of the key, NULL if it is not in the cache, under the lock
+static MapCacheEntry *FindMap(const MapParams *params, PhysicsMode physics, unsigned int seed, int screens, int playerCount, unsigned int aliveMask)
+{
+    for (int i = 0; i < MAP_CACHE_SIZE; i++)
+    {
+        MapCacheEntry *entry = &cache[i];
+
+        if ((entry->lastUse != 0) && (entry->seed == seed) && (entry->screens == screens) && (entry->playerCount == playerCount) &&
+            (entry->aliveMask == aliveMask) && (entry->physics == physics) && (memcmp(&entry->params, params, sizeof(MapParams)) == 0)) return entry;
+    }
+
+    return NULL;
+}
+
+static void LockCache(void)
+{
+#if !defined(MAPGEN_NO_THREADS)
+    pthread_mutex_lock(&cacheLock);
+#endif
+}
+
+static void UnlockCache(void)
+{
+#if !defined(MAPGEN_NO_THREADS)
+    pthread_mutex_unlock(&cacheLock);
+#endif
+}
+
+// Seed of a stream of a map seed (murmur3 finalizer), close streams give unrelated seeds
+static unsigned int MixSeed(unsigned int seed, unsigned int stream)
+{
+    unsigned int x = seed ^ (stream*0x9e3779b9u);
+
+    x ^= x >> 16;
+    x *= 0x85ebca6bu;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35u;
+    x ^= x >> 16;
+
+    return x;
+}
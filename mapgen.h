@@ -0,0 +1,82 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - map generator
+*
+*   A map (buildings and tank spawns) only depends on its seed, the world width, the tanks
+*   in play and a block of parameters, so any map can be played again from its seed: curated
+*   rotations, restarts, the previous map.
+*
+*   Maps are checked for fairness before they are played: the two teams must stand at close
+*   heights, and every tank must have enough launch angles that reach an enemy over the
+*   buildings in between. The check solves the arc through the enemy for each angle and
+*   tests it against the roofs, so it costs a few microseconds. A map failing it is drawn
+*   again from a seed derived from its own, the same each time.
+*
+*   Maps are kept in a small LRU cache keyed by all of the above, shared by every game and
+*   thread: a map played again is copied out of it instead of generated and checked.
+*
+*   NOTE: Included by game.h, after its limits (MAX_PLAYERS, MAX_WORLD_BUILDINGS...)
+*
+********************************************************************************************/
+
+#ifndef MAPGEN_H
+#define MAPGEN_H
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define MAP_CACHE_SIZE                   32        // Maps kept, 5 KB each
+#define MAP_REACH_MIN_ANGLE               5        // Launch angles tried by the fairness check, as the AI grid
+#define MAP_REACH_MAX_ANGLE              85
+#define MAP_REACH_ANGLE_STEP              5
+#define MAP_REACH_ANGLES   ((MAP_REACH_MAX_ANGLE - MAP_REACH_MIN_ANGLE)/MAP_REACH_ANGLE_STEP + 1)
+#define MAP_REACH_MAX_POWER            1000        // Strongest shot the check allows, as the AI
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct Building {
+    Rectangle rectangle;
+    Color color;
+} Building;
+
+// What maps look like, all zero plays GetDefaultMapParams()
+typedef struct MapParams {
+    int buildingCount;              // Buildings of each screen, 1 to MAX_BUILDINGS
+    int widthError;                 // Building width random range %
+    int minHeight;                  // Building heights, % of the screen height
+    int maxHeight;
+    int minGreen;                   // Building colors, level of green
+    int maxGreen;
+    int minPlayerPosition;          // Tank zones, % of the world width from the edge of their team
+    int maxPlayerPosition;          // Zone of a lone tank, it grows with the tanks of the team
+    int maxTeamPosition;            // Zone of a whole team
+    int minReachAngles;             // Fairness: angles (of MAP_REACH_ANGLES) each tank can hit an enemy with, 0: not checked
+    int maxHeightGap;               // Fairness: largest gap between the average heights of the teams, % of the screen height
+    int maxAttempts;                // Maps drawn for a seed before settling for an unfair one
+} MapParams;
+
+typedef struct GameMap {
+    unsigned int seed;              // Seed it was asked for
+    int attempts;                   // Maps drawn to find it
+    bool fair;                      // False if none of them passed the fairness check
+    int buildingCount;
+    Building building[MAX_WORLD_BUILDINGS];         // In x order
+    Vector2 spawn[MAX_PLAYERS];                     // Tank centers, the tanks out of lives do not take a building
+    float wind;                     // px/s^2, played in PHYSICS_WIND only (the fairness check is done in still air)
+} GameMap;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+MapParams GetDefaultMapParams(void);                    // The balancing values of game.h, fairness checked
+void GenerateMap(GameMap *map, const MapParams *params, PhysicsMode physics, unsigned int seed, int screens, int playerCount, unsigned int aliveMask);    // Bit i of aliveMask: tank i is in play, the reach is checked under the gravity of physics
+void GetMap(GameMap *map, const MapParams *params, PhysicsMode physics, unsigned int seed, int screens, int playerCount, unsigned int aliveMask);         // Same map, from the cache when it is there
+void ClearMapCache(void);
+void GetMapCacheStats(int *hits, int *misses);          // Since the start or ClearMapCache()
+int GetMapRandomValue(unsigned int *state, int min, int max);      // Xorshift step, the generator of the maps and of the games
+unsigned int SeedMapState(unsigned int seed);           // Generator state of a seed
+
+#endif // MAPGEN_H
@@ -0,0 +1,292 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - lockstep network play
+*
+*   Reliability is the simplest that fits a turn based game: every unacknowledged message
+*   is resent every NET_RESEND_TIME, and the receiver only takes the next one in sequence,
+*   acknowledging how many it took. There are never more than a few messages in flight.
+*
+********************************************************************************************/
+
+#include "net.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define NET_JOIN_SIZE                     2
+#define NET_ACK_SIZE                      5
+#define NET_MATCH_SIZE                   13
+#define NET_TURN_SIZE                    14
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void SendMessage(NetSession *net, const unsigned char *data, int size);
+static void QueueMessage(NetSession *net, unsigned char *data, int size);
+static void HandlePacket(NetSession *net, const unsigned char *data, int size, double time);
+static bool IsMatchValid(const NetMessage *message);
+static void SendAck(NetSession *net);
+static void WriteU16(unsigned char *data, unsigned int value);
+static void WriteU32(unsigned char *data, unsigned int value);
+static unsigned int ReadU16(const unsigned char *data);
+static unsigned int ReadU32(const unsigned char *data);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void InitNetSession(NetSession *net, Transport transport, bool isHost)
+{
+    memset(net, 0, sizeof(NetSession));
+
+    net->transport = transport;
+    net->isHost = isHost;
+}
+
+void CloseNetSession(NetSession *net)
+{
+    CloseTransport(&net->transport);
+
+    net->connected = false;
+}
+
+void UpdateNet(NetSession *net, double time)
+{
+    unsigned char packet[TRANSPORT_MAX_PACKET];
+    int size = 0;
+
+    while ((size = ReceivePacket(&net->transport, packet, TRANSPORT_MAX_PACKET)) > 0) HandlePacket(net, packet, size, time);
+
+    if (time >= net->resendTime)
+    {
+        net->resendTime = time + NET_RESEND_TIME;
+
+        if (!net->isHost && !net->connected)
+        {
+            unsigned char join[NET_JOIN_SIZE] = { NET_JOIN, NET_PROTOCOL_VERSION };
+
+            SendMessage(net, join, NET_JOIN_SIZE);
+        }
+
+        for (unsigned int i = net->ackedCount; i != net->sentCount; i++)
+        {
+            SendMessage(net, net->pending[i%NET_MAX_PENDING], net->pendingSize[i%NET_MAX_PENDING]);
+        }
+
+        if (net->connected && (net->ackedCount == net->sentCount)) SendAck(net);       // Keepalive
+    }
+
+    if (net->connected && (time - net->receiveTime > NET_TIMEOUT)) net->lost = true;
+}
+
+bool IsNetPlayer(const NetSession *net, const Player *player)
+{
+    return (player->isLeftTeam == net->isHost);
+}
+
+void SendNetMatch(NetSession *net, const Replay *replay)
+{
+    unsigned char data[NET_MATCH_SIZE] = { NET_MATCH };
+
+    WriteU32(data + 5, replay->seed);
+    data[9] = (unsigned char)replay->playerCount;
+    data[10] = (unsigned char)replay->firstTurn;
+    data[11] = (unsigned char)replay->screens;
+    data[12] = (unsigned char)replay->physics;
+
+    QueueMessage(net, data, NET_MATCH_SIZE);
+
+    net->turn = 0;
+    net->desync = false;
+}
+
+bool ReceiveNetMatch(NetSession *net, Replay *replay)
+{
+    if ((net->inboxCount == 0) || (net->inbox[net->inboxFirst].type != NET_MATCH)) return false;
+
+    NetMessage *message = &net->inbox[net->inboxFirst];
+
+    replay->seed = message->seed;
+    replay->playerCount = message->playerCount;
+    replay->firstTurn = message->firstTurn;
+    replay->screens = message->screens;
+    replay->physics = message->physics;
+
+    net->inboxFirst = (net->inboxFirst + 1)%NET_MAX_INBOX;
+    net->inboxCount--;
+
+    net->turn = 0;
+    net->desync = false;
+
+    return true;
+}
+
+bool SendNetInput(NetSession *net, ReplayInput input, unsigned int checksum)
+{
+    unsigned char data[NET_TURN_SIZE] = { NET_TURN };
+
+    if (net->sentCount - net->ackedCount >= NET_MAX_PENDING)
+    {
+        net->lost = true;
+        return false;
+    }
+
+    WriteU16(data + 5, (unsigned short)input.angle);
+    WriteU16(data + 7, (unsigned short)input.power);
+    data[9] = input.munition;
+    WriteU32(data + 10, checksum);
+
+    QueueMessage(net, data, NET_TURN_SIZE);
+
+    net->turn++;
+
+    return true;
+}
+
+bool ReceiveNetInput(NetSession *net, const Game *game, ReplayInput *input)
+{
+    if ((net->inboxCount == 0) || (net->inbox[net->inboxFirst].type != NET_TURN)) return false;
+
+    NetMessage *message = &net->inbox[net->inboxFirst];
+
+    if (!net->desync && (message->checksum != GetGameChecksum(game)))
+    {
+        net->desync = true;
+        net->desyncTurn = net->turn;
+    }
+
+    *input = message->input;
+
+    net->inboxFirst = (net->inboxFirst + 1)%NET_MAX_INBOX;
+    net->inboxCount--;
+    net->turn++;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+static void SendMessage(NetSession *net, const unsigned char *data, int size)
+{
+    if (!SendPacket(&net->transport, data, size)) return;
+
+    net->packetsSent++;
+    net->bytesSent += size;
+}
+
+// Number a reliable message, keep it for the resends and send it now
+static void QueueMessage(NetSession *net, unsigned char *data, int size)
+{
+    int slot = net->sentCount%NET_MAX_PENDING;
+
+    WriteU32(data + 1, net->sentCount);
+
+    memcpy(net->pending[slot], data, size);
+    net->pendingSize[slot] = size;
+    net->sentCount++;
+
+    SendMessage(net, data, size);
+}
+
+static void HandlePacket(NetSession *net, const unsigned char *data, int size, double time)
+{
+    int type = data[0];
+
+    if ((type == NET_JOIN) && ((size != NET_JOIN_SIZE) || !net->isHost || (data[1] != NET_PROTOCOL_VERSION))) return;
+    if ((type == NET_ACK) && (size != NET_ACK_SIZE)) return;
+    if ((type == NET_MATCH) && (size != NET_MATCH_SIZE)) return;
+    if ((type == NET_TURN) && (size != NET_TURN_SIZE)) return;
+    if ((type < NET_JOIN) || (type > NET_TURN)) return;
+
+    net->connected = true;
+    net->receiveTime = time;
+
+    switch (type)
+    {
+        case NET_JOIN: net->resendTime = time; break;          // Anything pending goes out on this update
+        case NET_ACK:
+        {
+            unsigned int count = ReadU32(data + 1);
+
+            // Acknowledgements can arrive out of order, only the ones moving forward count
+            if ((count - net->ackedCount <= net->sentCount - net->ackedCount) && (count != net->ackedCount)) net->ackedCount = count;
+        } break;
+        default:
+        {
+            unsigned int sequence = ReadU32(data + 1);
+
+            if ((sequence == net->receivedCount) && (net->inboxCount < NET_MAX_INBOX))
+            {
+                NetMessage *message = &net->inbox[(net->inboxFirst + net->inboxCount)%NET_MAX_INBOX];
+
+                memset(message, 0, sizeof(NetMessage));
+                message->type = (NetMessageType)type;
+
+                if (type == NET_MATCH)
+                {
+                    message->seed = ReadU32(data + 5);
+                    message->playerCount = data[9];
+                    message->firstTurn = data[10];
+                    message->screens = data[11];
+                    message->physics = (PhysicsMode)data[12];
+                }
+                else
+                {
+                    message->input.angle = (short)ReadU16(data + 5);
+                    message->input.power = (short)ReadU16(data + 7);
+                    message->input.munition = data[9];
+                    message->checksum = ReadU32(data + 10);
+                }
+
+                // A match no game can start from is dropped, it still counts as received so the link moves on
+                if ((type != NET_MATCH) || IsMatchValid(message)) net->inboxCount++;
+                net->receivedCount++;
+            }
+
+            SendAck(net);                                       // Duplicates too: the previous acknowledgement may be lost
+        } break;
+    }
+}
+
+// Same checks as LoadReplay(): the first turn indexes the players of the game
+static bool IsMatchValid(const NetMessage *message)
+{
+    if ((message->playerCount < MIN_PLAYERS) || (message->playerCount > MAX_PLAYERS)) return false;
+    if ((message->firstTurn < 0) || (message->firstTurn >= message->playerCount)) return false;
+    if ((message->screens < 1) || (message->screens > MAX_WORLD_SCREENS)) return false;
+
+    return ((int)message->physics >= 0) && (message->physics < PHYSICS_COUNT);
+}
+
+static void SendAck(NetSession *net)
+{
+    unsigned char data[NET_ACK_SIZE] = { NET_ACK };
+
+    WriteU32(data + 1, net->receivedCount);
+
+    SendMessage(net, data, NET_ACK_SIZE);
+}
+
+static void WriteU16(unsigned char *data, unsigned int value)
+{
+    data[0] = value & 0xff;
+    data[1] = (value >> 8) & 0xff;
+}
+
+static void WriteU32(unsigned char *data, unsigned int value)
+{
+    WriteU16(data, value & 0xffff);
+    WriteU16(data + 2, value >> 16);
+}
+
+static unsigned int ReadU16(const unsigned char *data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+static unsigned int ReadU32(const unsigned char *data)
+{
+    return ReadU16(data) | (ReadU16(data + 2) << 16);
+}
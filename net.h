@@ -0,0 +1,102 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - lockstep network play
+*
+*   The game core is deterministic, so two peers stay in step by exchanging only what a
+*   replay records: the seed of each match and the input of each turn. Every peer simulates
+*   the whole game locally, no game state ever goes over the network. The host plays the
+*   left (blue) team and starts the matches, the other peer plays the right (red) team.
+*
+*   Each turn message carries a checksum of the state it was fired from (GetGameChecksum()):
+*   the peer compares it with its own before applying the input, so a desync is caught on
+*   the turn it happens.
+*
+*   Messages (little endian), sent over any transport of transport.h:
+*       JOIN   type (u8), version (u8)                                          client, until answered
+*       ACK    type (u8), messages received (u32)                               answer and keepalive
+*       MATCH  type (u8), sequence (u32), seed (u32), players (u8), first turn (u8), screens (u8), physics (u8)
+*       TURN   type (u8), sequence (u32), angle (i16), power (i16), munition (u8), checksum (u32)
+*
+*   MATCH and TURN are resent until acknowledged, and applied in sequence order. A MATCH out of
+*   the ranges of the game (players, first turn, screens, physics) is acknowledged and dropped.
+*
+********************************************************************************************/
+
+#ifndef NET_H
+#define NET_H
+
+#include "game.h"
+#include "replay.h"
+#include "transport.h"
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define NET_PROTOCOL_VERSION              5        // 4: maps from their own seed, [B] previous map, 5: physics of the match
+#define NET_DEFAULT_PORT               7777
+#define NET_MAX_PENDING                  64        // Messages sent and not acknowledged yet
+#define NET_MAX_INBOX                    64        // Messages received and not applied yet
+#define NET_RESEND_TIME               0.10        // s between two resends (and keepalives)
+#define NET_TIMEOUT                   10.0        // s without a packet before the peer is considered gone
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum NetMessageType {
+    NET_JOIN = 1,
+    NET_ACK,
+    NET_MATCH,
+    NET_TURN
+} NetMessageType;
+
+typedef struct NetMessage {
+    NetMessageType type;            // NET_MATCH or NET_TURN
+    unsigned int seed;              // Match
+    int playerCount;
+    int firstTurn;
+    int screens;
+    PhysicsMode physics;
+    ReplayInput input;              // Turn
+    unsigned int checksum;
+} NetMessage;
+
+typedef struct NetSession {
+    Transport transport;
+    bool isHost;                    // Plays the left team and starts the matches
+    bool connected;                 // The peer answered
+    bool lost;                      // Nothing from the peer for NET_TIMEOUT, or too many messages unacknowledged
+    bool desync;                    // The peer fired from another state, see desyncTurn
+    int turn;                       // Inputs applied in the current match
+    int desyncTurn;
+
+    unsigned char pending[NET_MAX_PENDING][TRANSPORT_MAX_PACKET];       // Sent messages, resent until acknowledged
+    int pendingSize[NET_MAX_PENDING];
+    unsigned int sentCount;
+    unsigned int ackedCount;
+
+    NetMessage inbox[NET_MAX_INBOX];
+    int inboxFirst;
+    int inboxCount;
+    unsigned int receivedCount;     // Messages received in order
+
+    double resendTime;
+    double receiveTime;             // Last packet from the peer
+
+    long long packetsSent;          // Statistics, resends included
+    long long bytesSent;
+} NetSession;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void InitNetSession(NetSession *net, Transport transport, bool isHost);    // The session owns the transport
+void CloseNetSession(NetSession *net);
+void UpdateNet(NetSession *net, double time);                              // Receive, acknowledge and resend, once per frame
+bool IsNetPlayer(const NetSession *net, const Player *player);             // The player is played on this machine
+
+void SendNetMatch(NetSession *net, const Replay *replay);                  // Host: a match started, after BeginReplay()
+bool ReceiveNetMatch(NetSession *net, Replay *replay);                     // Client: the next match of the host, sets seed, playerCount, firstTurn, screens and physics for StartReplay()
+bool SendNetInput(NetSession *net, ReplayInput input, unsigned int checksum);  // Input applied locally, checksum: GetGameChecksum() before it
+bool ReceiveNetInput(NetSession *net, const Game *game, ReplayInput *input);    // Next input of the peer, before applying it to game
+
+#endif // NET_H
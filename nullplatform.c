@@ -0,0 +1,70 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - null platform
+*
+*   The raylib helpers used by the game core, for the builds without raylib (headless
+*   runner, benchmarks). Same behaviour as raylib 2.5.
+*
+********************************************************************************************/
+
+#include "headless.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+
+#if defined(_WIN32)
+    // NOTE: Declared here instead of including windows.h, its Rectangle() function clashes with the Rectangle type
+    __declspec(dllimport) int __stdcall QueryPerformanceCounter(unsigned long long *lpPerformanceCount);
+    __declspec(dllimport) int __stdcall QueryPerformanceFrequency(unsigned long long *lpFrequency);
+#endif
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+double GetTime(void)
+{
+#if defined(_WIN32)
+    unsigned long long frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter/(double)frequency;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec*1e-9;
+#endif
+}
+
+int GetRandomValue(int min, int max)
+{
+    if (min > max)
+    {
+        int tmp = max;
+        max = min;
+        min = tmp;
+    }
+
+    return (rand()%(abs(max - min) + 1) + min);
+}
+
+bool CheckCollisionCircleRec(Vector2 center, float radius, Rectangle rec)
+{
+    int recCenterX = (int)(rec.x + rec.width/2.0f);
+    int recCenterY = (int)(rec.y + rec.height/2.0f);
+
+    float dx = (float)fabs(center.x - recCenterX);
+    float dy = (float)fabs(center.y - recCenterY);
+
+    if (dx > (rec.width/2.0f + radius)) { return false; }
+    if (dy > (rec.height/2.0f + radius)) { return false; }
+
+    if (dx <= (rec.width/2.0f)) { return true; }
+    if (dy <= (rec.height/2.0f)) { return true; }
+
+    float cornerDistanceSq = (dx - rec.width/2.0f)*(dx - rec.width/2.0f) +
+                             (dy - rec.height/2.0f)*(dy - rec.height/2.0f);
+
+    return (cornerDistanceSq <= (radius*radius));
+}
+
@@ -0,0 +1,257 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - asset packer
+*
+*   Build tool: converts the files of the resources directory into assetdata.c (see
+*   assetdata.h). PNG images are decoded to R8G8B8A8 pixels, PCM wav files are reduced to
+*   their samples, any other file is kept as it is. The data is written as string literals,
+*   which compilers parse much faster than lists of numbers.
+*
+*   Runs on the build machine: it only needs stb_image, from raylib src/external.
+*
+*   Usage: packassets output.c file...
+*
+********************************************************************************************/
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#include "stb_image.h"          // Found in raylib src/external
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define BYTES_PER_LINE                   64        // Bytes of each string literal line
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct Wave {
+    unsigned int offset;            // Of the samples in the file
+    unsigned int size;
+    int sampleRate;
+    int sampleSize;
+    int channels;
+} Wave;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static unsigned char *LoadFileData(const char *fileName, unsigned int *size);
+static bool ParseWave(const unsigned char *data, unsigned int size, Wave *wave);
+static void WriteData(FILE *output, int index, const unsigned char *data, unsigned int size);
+static const char *GetBaseName(const char *fileName);
+static bool HasExtension(const char *fileName, const char *extension);
+
+//------------------------------------------------------------------------------------
+// Program main entry point
+//------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s output.c file...\n", argv[0]);
+        return 1;
+    }
+
+    FILE *output = fopen(argv[1], "wb");
+
+    if (output == NULL)
+    {
+        fprintf(stderr, "%s could not be written\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(output, "// Generated by packassets from the files of the resources directory, do not edit (see assetdata.h)\n\n");
+    fprintf(output, "#include \"assetdata.h\"\n\n");
+
+    int count = argc - 2;
+    char (*entry)[256] = calloc(count, sizeof(*entry));
+    bool failed = (entry == NULL);
+
+    for (int i = 0; (i < count) && !failed; i++)
+    {
+        const char *fileName = argv[i + 2];
+        unsigned int size = 0;
+        unsigned char *data = LoadFileData(fileName, &size);
+
+        if (data == NULL)
+        {
+            fprintf(stderr, "%s could not be read\n", fileName);
+            failed = true;
+            break;
+        }
+
+        if (HasExtension(fileName, ".png"))
+        {
+            int width = 0;
+            int height = 0;
+            int components = 0;
+            unsigned char *pixels = stbi_load_from_memory(data, (int)size, &width, &height, &components, 4);
+
+            if (pixels == NULL)
+            {
+                fprintf(stderr, "%s: %s\n", fileName, stbi_failure_reason());
+                failed = true;
+            }
+            else
+            {
+                WriteData(output, i, pixels, (unsigned int)(width*height*4));
+                snprintf(entry[i], sizeof(entry[i]), "{ \"%s\", EMBEDDED_IMAGE, asset%i, %u, %i, %i, 0, 0, 0, 0 }",
+                         GetBaseName(fileName), i, (unsigned int)(width*height*4), width, height);
+                stbi_image_free(pixels);
+            }
+        }
+        else if (HasExtension(fileName, ".wav"))
+        {
+            Wave wave = { 0 };
+
+            if (!ParseWave(data, size, &wave))
+            {
+                fprintf(stderr, "%s: not a PCM wav file\n", fileName);
+                failed = true;
+            }
+            else
+            {
+                int sampleCount = (int)(wave.size/(wave.sampleSize/8)/wave.channels);
+
+                WriteData(output, i, data + wave.offset, wave.size);
+                snprintf(entry[i], sizeof(entry[i]), "{ \"%s\", EMBEDDED_WAVE, asset%i, %u, 0, 0, %i, %i, %i, %i }",
+                         GetBaseName(fileName), i, wave.size, sampleCount, wave.sampleRate, wave.sampleSize, wave.channels);
+            }
+        }
+        else
+        {
+            WriteData(output, i, data, size);
+            snprintf(entry[i], sizeof(entry[i]), "{ \"%s\", EMBEDDED_FILE, asset%i, %u, 0, 0, 0, 0, 0, 0 }", GetBaseName(fileName), i, size);
+        }
+
+        free(data);
+    }
+
+    if (!failed)
+    {
+        fprintf(output, "const EmbeddedAsset embeddedAssets[] = {\n");
+        for (int i = 0; i < count; i++) fprintf(output, "    %s,\n", entry[i]);
+        fprintf(output, "};\n\nconst int embeddedAssetCount = %i;\n", count);
+    }
+
+    free(entry);
+
+    if ((fclose(output) != 0) || failed)
+    {
+        remove(argv[1]);        // No half written file for make to take as up to date
+        return 1;
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+static unsigned char *LoadFileData(const char *fileName, unsigned int *size)
+{
+    FILE *file = fopen(fileName, "rb");
+
+    if (file == NULL) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    unsigned char *data = (length > 0) ? (unsigned char *)malloc(length) : NULL;
+
+    if ((data != NULL) && (fread(data, 1, length, file) != (size_t)length))
+    {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+
+    *size = (unsigned int)length;
+
+    return data;
+}
+
+// Find the format and the samples of a RIFF wav file, uncompressed PCM only
+static bool ParseWave(const unsigned char *data, unsigned int size, Wave *wave)
+{
+    if ((size < 12) || (memcmp(data, "RIFF", 4) != 0) || (memcmp(data + 8, "WAVE", 4) != 0)) return false;
+
+    bool format = false;
+    unsigned int position = 12;
+
+    while (position + 8 <= size)
+    {
+        const unsigned char *chunk = data + position;
+        unsigned int chunkSize = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((unsigned int)chunk[7] << 24);
+
+        if (chunkSize > size - position - 8) chunkSize = size - position - 8;
+
+        if ((memcmp(chunk, "fmt ", 4) == 0) && (chunkSize >= 16))
+        {
+            int audioFormat = chunk[8] | (chunk[9] << 8);
+
+            wave->channels = chunk[10] | (chunk[11] << 8);
+            wave->sampleRate = chunk[12] | (chunk[13] << 8) | (chunk[14] << 16) | (chunk[15] << 24);
+            wave->sampleSize = chunk[22] | (chunk[23] << 8);
+
+            format = (audioFormat == 1) && (wave->channels > 0) && ((wave->sampleSize == 8) || (wave->sampleSize == 16) || (wave->sampleSize == 32));
+        }
+        else if ((memcmp(chunk, "data", 4) == 0) && format)
+        {
+            wave->offset = position + 8;
+            wave->size = chunkSize;
+            return true;
+        }
+
+        position += 8 + chunkSize + (chunkSize & 1);        // Chunks are word aligned
+    }
+
+    return false;
+}
+
+// Printable characters as they are, the others as octal escapes (always 3 digits, so a digit can follow)
+static void WriteData(FILE *output, int index, const unsigned char *data, unsigned int size)
+{
+    fprintf(output, "static const unsigned char asset%i[%u] =", index, (size > 0) ? size : 1);
+
+    if (size == 0) fprintf(output, " \"\"");
+
+    for (unsigned int i = 0; i < size; i++)
+    {
+        if (i%BYTES_PER_LINE == 0) fprintf(output, "%s\n    \"", (i > 0) ? "\"" : "");
+
+        unsigned char c = data[i];
+
+        // NOTE: '?' is escaped too, so no trigraph can appear
+        if ((c >= 0x20) && (c < 0x7f) && (c != '"') && (c != '\\') && (c != '?')) fputc(c, output);
+        else fprintf(output, "\\%03o", c);
+    }
+
+    fprintf(output, "%s;\n\n", (size > 0) ? "\"" : "");
+}
+
+static const char *GetBaseName(const char *fileName)
+{
+    const char *separator = strrchr(fileName, '/');
+    const char *backslash = strrchr(fileName, '\\');
+
+    if ((separator == NULL) || ((backslash != NULL) && (backslash > separator))) separator = backslash;
+
+    return (separator != NULL) ? separator + 1 : fileName;
+}
+
+static bool HasExtension(const char *fileName, const char *extension)
+{
+    size_t length = strlen(fileName);
+    size_t extensionLength = strlen(extension);
+
+    return (length >= extensionLength) && (strcmp(fileName + length - extensionLength, extension) == 0);
+}
@@ -0,0 +1,231 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - particles
+*
+*   Each kind of particle differs only by its parameters (gravity, drag, growth), so every
+*   particle goes through the same integration, whatever its kind. The random values of the
+*   emitters come from their own xorshift, the game generator is left alone.
+*
+*   NOTE: rlgl.h is found in raylib src, like the headers of its external libraries.
+*
+********************************************************************************************/
+
+#include "particles.h"
+
+#include "rlgl.h"
+
+#include <math.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define DEBRIS_COUNT                    240        // Particles of an explosion
+#define EXPLOSION_SMOKE_COUNT            60
+#define FLASH_COUNT                      24        // Particles of a muzzle flash
+#define FLASH_SMOKE_COUNT                16
+
+#define DEBRIS_GRAVITY               500.0f        // px/s^2
+#define SMOKE_GRAVITY                -40.0f        // Smoke rises
+#define SMOKE_DRAG                     1.5f        // Share of the speed lost each second
+#define FLASH_DRAG                     6.0f
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct ParticlePool {
+    float x[MAX_PARTICLES];
+    float y[MAX_PARTICLES];
+    float vx[MAX_PARTICLES];
+    float vy[MAX_PARTICLES];
+    float age[MAX_PARTICLES];       // Seconds since emitted
+    float life[MAX_PARTICLES];      // Seconds it lives
+    float size[MAX_PARTICLES];      // Side of its quad (px) when emitted
+    float growth[MAX_PARTICLES];    // px/s added to its side
+    float gravity[MAX_PARTICLES];
+    float drag[MAX_PARTICLES];
+    Color color[MAX_PARTICLES];     // Faded out over its life
+    int count;                      // Particles [0, count) are alive
+} ParticlePool;
+
+typedef struct ParticleKind {
+    float minSpeed, maxSpeed;
+    float minLife, maxLife;
+    float minSize, maxSize;
+    float growth;
+    float gravity;
+    float drag;
+    Color color;
+} ParticleKind;
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static ParticlePool pool = { 0 };
+static unsigned int randomState = 0x9e3779b9u;
+
+static const ParticleKind debris = { 120.0f, 420.0f, 0.6f, 1.4f, 2.0f, 4.0f, 0.0f, DEBRIS_GRAVITY, 0.3f, { 90, 70, 50, 255 } };
+static const ParticleKind explosionSmoke = { 10.0f, 60.0f, 1.2f, 2.5f, 8.0f, 14.0f, 18.0f, SMOKE_GRAVITY, SMOKE_DRAG, { 110, 110, 110, 160 } };
+static const ParticleKind flash = { 80.0f, 260.0f, 0.08f, 0.2f, 3.0f, 6.0f, 10.0f, 0.0f, FLASH_DRAG, { 255, 200, 60, 255 } };
+static const ParticleKind flashSmoke = { 20.0f, 80.0f, 0.5f, 1.0f, 4.0f, 8.0f, 12.0f, SMOKE_GRAVITY, SMOKE_DRAG, { 170, 170, 170, 140 } };
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void Emit(const ParticleKind *kind, int count, Vector2 position, Vector2 direction, float spread);
+static float RandomFloat(float min, float max);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void ClearParticles(void)
+{
+    pool.count = 0;
+}
+
+void EmitExplosion(Vector2 position)
+{
+    Emit(&debris, DEBRIS_COUNT, position, (Vector2){ 0.0f, -1.0f }, 1.2f);
+    Emit(&explosionSmoke, EXPLOSION_SMOKE_COUNT, position, (Vector2){ 0.0f, -1.0f }, PI);
+}
+
+void EmitMuzzleFlash(Vector2 position, Vector2 direction)
+{
+    Emit(&flash, FLASH_COUNT, position, direction, 0.35f);
+    Emit(&flashSmoke, FLASH_SMOKE_COUNT, position, direction, 0.8f);
+}
+
+void UpdateParticles(float deltaTime)
+{
+    int i = 0;
+
+    while (i < pool.count)
+    {
+        pool.age[i] += deltaTime;
+
+        if (pool.age[i] >= pool.life[i])
+        {
+            // Swap-remove: the last particle takes the slot, and is updated next
+            int last = --pool.count;
+
+            pool.x[i] = pool.x[last];
+            pool.y[i] = pool.y[last];
+            pool.vx[i] = pool.vx[last];
+            pool.vy[i] = pool.vy[last];
+            pool.age[i] = pool.age[last];
+            pool.life[i] = pool.life[last];
+            pool.size[i] = pool.size[last];
+            pool.growth[i] = pool.growth[last];
+            pool.gravity[i] = pool.gravity[last];
+            pool.drag[i] = pool.drag[last];
+            pool.color[i] = pool.color[last];
+            continue;
+        }
+
+        float keep = 1.0f - pool.drag[i]*deltaTime;
+
+        if (keep < 0.0f) keep = 0.0f;
+
+        pool.vx[i] *= keep;
+        pool.vy[i] = pool.vy[i]*keep + pool.gravity[i]*deltaTime;
+        pool.x[i] += pool.vx[i]*deltaTime;
+        pool.y[i] += pool.vy[i]*deltaTime;
+        i++;
+    }
+}
+
+int DrawParticles(Rectangle view)
+{
+    int drawCalls = 0;
+    int quads = 0;
+
+    rlEnableTexture(GetTextureDefault().id);     // Quads are textured, the default texture is plain white
+
+    for (int i = 0; i < pool.count; i++)
+    {
+        float t = pool.age[i]/pool.life[i];
+        float half = (pool.size[i] + pool.growth[i]*pool.age[i])/2;
+        float x = pool.x[i];
+        float y = pool.y[i];
+
+        if ((x + half < view.x) || (x - half > view.x + view.width) || (y + half < view.y) || (y - half > view.y + view.height)) continue;
+
+        if (quads == 0)
+        {
+            if (rlCheckBufferLimit(4*PARTICLE_BATCH)) rlglDraw();
+
+            rlBegin(RL_QUADS);
+            drawCalls++;
+        }
+
+        Color color = pool.color[i];
+
+        rlColor4ub(color.r, color.g, color.b, (unsigned char)(color.a*(1.0f - t)));
+
+        rlTexCoord2f(0.0f, 0.0f);
+        rlVertex2f(x - half, y - half);
+        rlTexCoord2f(0.0f, 1.0f);
+        rlVertex2f(x - half, y + half);
+        rlTexCoord2f(1.0f, 1.0f);
+        rlVertex2f(x + half, y + half);
+        rlTexCoord2f(1.0f, 0.0f);
+        rlVertex2f(x + half, y - half);
+
+        if (++quads == PARTICLE_BATCH)
+        {
+            rlEnd();
+            quads = 0;
+        }
+    }
+
+    if (quads > 0) rlEnd();
+
+    rlDisableTexture();
+
+    return drawCalls;
+}
+
+int GetParticleCount(void)
+{
+    return pool.count;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+// Particles thrown within spread radians of direction, a full pool drops the rest
+static void Emit(const ParticleKind *kind, int count, Vector2 position, Vector2 direction, float spread)
+{
+    float heading = atan2f(direction.y, direction.x);
+
+    if (count > MAX_PARTICLES - pool.count) count = MAX_PARTICLES - pool.count;
+
+    for (int n = 0; n < count; n++)
+    {
+        int i = pool.count++;
+        float angle = heading + RandomFloat(-spread, spread);
+        float speed = RandomFloat(kind->minSpeed, kind->maxSpeed);
+
+        pool.x[i] = position.x;
+        pool.y[i] = position.y;
+        pool.vx[i] = cosf(angle)*speed;
+        pool.vy[i] = sinf(angle)*speed;
+        pool.age[i] = 0.0f;
+        pool.life[i] = RandomFloat(kind->minLife, kind->maxLife);
+        pool.size[i] = RandomFloat(kind->minSize, kind->maxSize);
+        pool.growth[i] = kind->growth;
+        pool.gravity[i] = kind->gravity;
+        pool.drag[i] = kind->drag;
+        pool.color[i] = kind->color;
+    }
+}
+
+// Xorshift, uniform in [min, max]
+static float RandomFloat(float min, float max)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    return min + (max - min)*(randomState >> 8)*(1.0f/16777216.0f);
+}
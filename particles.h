@@ -0,0 +1,37 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - particles
+*
+*   Debris, smoke and muzzle flashes. The particles live in a fixed pool kept as a structure
+*   of arrays, so updating them walks a few dense arrays and nothing is allocated after
+*   startup. A dead particle is replaced by the last one, so the living ones always fill
+*   the start of the pool. They are drawn as quads in a few rlgl batches, not one draw call
+*   each.
+*
+*   Particles are only an effect: the game core never reads them, and they do not change
+*   what a replay or a network peer sees.
+*
+********************************************************************************************/
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "raylib.h"
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define MAX_PARTICLES                 65536        // Particles alive at once, more are not emitted
+#define PARTICLE_BATCH                 1024        // Quads drawn per rlgl batch
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void ClearParticles(void);                              // Remove every particle (new map)
+void EmitExplosion(Vector2 position);                   // Debris thrown up and smoke rising from an impact
+void EmitMuzzleFlash(Vector2 position, Vector2 direction);  // Flash and smoke of a shot, direction: unit vector of the barrel
+void UpdateParticles(float deltaTime);                  // Age, move and remove the particles
+int DrawParticles(Rectangle view);                      // Draw the particles inside view (world coordinates), returns the draw calls made
+int GetParticleCount(void);
+
+#endif // PARTICLES_H
@@ -0,0 +1,118 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - trajectory preview
+*
+*   The impact comes from TraceShot(), the same swept flight as the real shell, and the
+*   points in between straight from the closed-form arcs, one more per bounce.
+*
+********************************************************************************************/
+
+#include "preview.h"
+
+#include <math.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static unsigned int GetAliveMask(const Game *game);
+static void FlyArc(PreviewArc *arc, const Game *game);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void ClearPreview(TrajectoryPreview *preview)
+{
+    memset(preview, 0, sizeof(*preview));
+}
+
+const PreviewArc *GetPreviewArc(TrajectoryPreview *preview, const Game *game, int angle, int power)
+{
+    unsigned int aliveMask = GetAliveMask(game);
+    PreviewArc *oldest = &preview->arc[0];
+
+    preview->useCount++;
+
+    for (int i = 0; i < PREVIEW_CACHE_ARCS; i++)
+    {
+        PreviewArc *arc = &preview->arc[i];
+
+        if ((arc->lastUse > 0) && (arc->angle == angle) && (arc->power == power) && (arc->playerTurn == game->playerTurn) &&
+            (arc->generation == game->terrain.generation) && (arc->craterCount == game->terrain.craterCount) && (arc->aliveMask == aliveMask))
+        {
+            arc->lastUse = preview->useCount;
+            preview->hits++;
+
+            return arc;
+        }
+
+        if (arc->lastUse < oldest->lastUse) oldest = arc;
+    }
+
+    oldest->angle = angle;
+    oldest->power = power;
+    oldest->playerTurn = game->playerTurn;
+    oldest->generation = game->terrain.generation;
+    oldest->craterCount = game->terrain.craterCount;
+    oldest->aliveMask = aliveMask;
+    oldest->lastUse = preview->useCount;
+
+    FlyArc(oldest, game);
+    preview->misses++;
+
+    return oldest;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+// Tanks a shell can still hit, bit i for player i
+static unsigned int GetAliveMask(const Game *game)
+{
+    unsigned int mask = 0;
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        if (game->player[i].isAlive) mask |= 1u << i;
+    }
+
+    return mask;
+}
+
+// Points PREVIEW_SPACING apart at most, or fewer further apart on arcs too long for PREVIEW_MAX_POINTS,
+// shared by the arcs of a bouncing shell in proportion to their lengths
+static void FlyArc(PreviewArc *arc, const Game *game)
+{
+    Trajectory trajectory[MAX_SHOT_ARCS] = { 0 };
+    float flightTime[MAX_SHOT_ARCS] = { 0 };
+    int steps[MAX_SHOT_ARCS] = { 0 };
+    int arcCount = 0;
+    int totalSteps = 0;
+
+    arc->event = TraceShot(game, arc->angle, arc->power, trajectory, flightTime, &arcCount);
+
+    for (int i = 0; i < arcCount; i++)
+    {
+        // The arc is no longer than the flight at its fastest speed
+        float launchSpeed = sqrtf(trajectory[i].velocity.x*trajectory[i].velocity.x + trajectory[i].velocity.y*trajectory[i].velocity.y);
+        float length = (launchSpeed + trajectory[i].gravity*flightTime[i])*flightTime[i];
+
+        steps[i] = (int)ceilf(length/PREVIEW_SPACING);
+        if (steps[i] < 1) steps[i] = 1;
+        totalSteps += steps[i];
+    }
+
+    // Each arc has its first point too, and keeps a step whatever the scaling
+    int maxSteps = PREVIEW_MAX_POINTS - 2*arcCount;
+
+    arc->pointCount = 0;
+
+    for (int i = 0; i < arcCount; i++)
+    {
+        if (totalSteps > maxSteps) steps[i] = steps[i]*maxSteps/totalSteps;
+        if (steps[i] < 1) steps[i] = 1;
+
+        for (int j = 0; j <= steps[i]; j++) arc->point[arc->pointCount++] = TrajectoryPosition(trajectory[i], flightTime[i]*j/steps[i]);
+    }
+}
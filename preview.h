@@ -0,0 +1,56 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - trajectory preview
+*
+*   The arc a shot would fly, up to the first building or tank it meets (the last one it
+*   bounces to with PHYSICS_BOUNCE), drawn while aiming.
+*   Shots are whole degrees and whole points of power, so most frames aim the same shot as
+*   the previous one: the last arcs flown are kept, and an arc is only flown again when the
+*   aim moves to another angle or power, or when a crater or a destroyed tank changed what
+*   it would meet.
+*
+********************************************************************************************/
+
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include "game.h"
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define PREVIEW_CACHE_ARCS                8        // Arcs kept, the least recently used is flown over
+#define PREVIEW_MAX_POINTS              256        // Points of an arc, whatever its length
+#define PREVIEW_SPACING               12.0f        // Distance between two points (px) of arcs short enough
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct PreviewArc {
+    int angle;
+    int power;
+    int playerTurn;
+    unsigned int generation;        // Map, craters and tanks the arc was flown against
+    int craterCount;
+    unsigned int aliveMask;
+    unsigned int lastUse;           // 0: no arc yet
+
+    ShellEvent event;               // What the shell meets at the end of the arc
+    int pointCount;
+    Vector2 point[PREVIEW_MAX_POINTS];      // Evenly spaced in flight time along each arc, the last one is the impact
+} PreviewArc;
+
+typedef struct TrajectoryPreview {
+    PreviewArc arc[PREVIEW_CACHE_ARCS];
+    unsigned int useCount;
+    int hits;                       // Statistics: arcs served from the cache
+    int misses;                     // and arcs flown
+} TrajectoryPreview;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void ClearPreview(TrajectoryPreview *preview);                                              // Forget every arc
+const PreviewArc *GetPreviewArc(TrajectoryPreview *preview, const Game *game, int angle, int power);   // Arc of a shot of the current player, valid until the next call
+
+#endif // PREVIEW_H
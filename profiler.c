@@ -0,0 +1,202 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - frame profiler
+*
+*   Times are kept in milliseconds. The overlay statistics are only recomputed every
+*   PROFILER_REFRESH frames, so showing them costs next to nothing.
+*
+********************************************************************************************/
+
+#include "profiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define PROFILE_ROWS        (PROFILE_PHASE_COUNT + 1)       // Phases and the whole frame
+#define PROFILE_FRAME_ROW    PROFILE_PHASE_COUNT
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct ProfileStats {
+    float min;
+    float avg;
+    float p99;
+    float max;
+} ProfileStats;
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static const char *rowNames[PROFILE_ROWS] = { "update", "terrain", "sprites", "hud", "present", "music", "frame" };
+
+static FILE *csvFile = NULL;
+static long long frameCount = 0;
+static double frameStart = -1.0;                        // Negative until the first frame starts
+static double phaseStart[PROFILE_PHASE_COUNT] = { 0 };
+static double phaseTime[PROFILE_PHASE_COUNT] = { 0 };  // Seconds spent in each phase this frame
+static int drawCalls = 0;                               // Draw calls of this frame
+static int lastDrawCalls = 0;                           // and of the previous one, shown on the overlay
+
+static float history[PROFILE_ROWS][PROFILER_HISTORY] = { 0 };  // Last frames, ms
+static int historyCount = 0;
+static int historyIndex = 0;
+
+static ProfileStats stats[PROFILE_ROWS] = { 0 };
+static int framesSinceRefresh = 0;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void UpdateStats(void);
+static int CompareFloat(const void *a, const void *b);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void InitProfiler(const char *csvFileName)
+{
+    if (csvFileName != NULL)
+    {
+        csvFile = fopen(csvFileName, "w");
+
+        if (csvFile == NULL) TraceLog(LOG_WARNING, "Profiler: %s could not be created", csvFileName);
+        else
+        {
+            fprintf(csvFile, "frame");
+            for (int i = 0; i < PROFILE_ROWS; i++) fprintf(csvFile, ",%s_ms", rowNames[i]);
+            fprintf(csvFile, ",draw_calls\n");
+        }
+    }
+}
+
+void CloseProfiler(void)
+{
+    if (csvFile != NULL) fclose(csvFile);
+    csvFile = NULL;
+}
+
+void NextProfileFrame(void)
+{
+    double now = GetTime();
+
+    if (frameStart >= 0.0)
+    {
+        float frame[PROFILE_ROWS] = { 0 };
+
+        for (int i = 0; i < PROFILE_PHASE_COUNT; i++) frame[i] = (float)(phaseTime[i]*1000.0);
+        frame[PROFILE_FRAME_ROW] = (float)((now - frameStart)*1000.0);
+
+        for (int i = 0; i < PROFILE_ROWS; i++) history[i][historyIndex] = frame[i];
+
+        historyIndex = (historyIndex + 1)%PROFILER_HISTORY;
+        if (historyCount < PROFILER_HISTORY) historyCount++;
+
+        if (csvFile != NULL)
+        {
+            fprintf(csvFile, "%lli", frameCount);
+            for (int i = 0; i < PROFILE_ROWS; i++) fprintf(csvFile, ",%.3f", frame[i]);
+            fprintf(csvFile, ",%i\n", drawCalls);
+        }
+
+        frameCount++;
+        lastDrawCalls = drawCalls;
+
+        if (++framesSinceRefresh >= PROFILER_REFRESH)
+        {
+            framesSinceRefresh = 0;
+            UpdateStats();
+        }
+    }
+
+    for (int i = 0; i < PROFILE_PHASE_COUNT; i++) phaseTime[i] = 0.0;
+    drawCalls = 0;
+
+    frameStart = now;
+}
+
+void BeginProfilePhase(ProfilePhase phase)
+{
+    phaseStart[phase] = GetTime();
+}
+
+void EndProfilePhase(ProfilePhase phase)
+{
+    phaseTime[phase] += GetTime() - phaseStart[phase];
+}
+
+void CountDrawCalls(int count)
+{
+    drawCalls += count;
+}
+
+void DrawProfilerOverlay(int posX, int posY)
+{
+    const int lineHeight = 14;
+    const int columnWidth = 50;
+
+    DrawRectangle(posX, posY, 80 + 4*columnWidth, (PROFILE_ROWS + 2)*lineHeight + 8, Fade(BLACK, 0.7f));
+
+    posX += 6;
+    posY += 4;
+
+    DrawText("ms", posX, posY, 10, LIGHTGRAY);
+    DrawText("min", posX + 80, posY, 10, LIGHTGRAY);
+    DrawText("avg", posX + 80 + columnWidth, posY, 10, LIGHTGRAY);
+    DrawText("p99", posX + 80 + 2*columnWidth, posY, 10, LIGHTGRAY);
+    DrawText("max", posX + 80 + 3*columnWidth, posY, 10, LIGHTGRAY);
+
+    for (int i = 0; i < PROFILE_ROWS; i++)
+    {
+        int y = posY + (i + 1)*lineHeight;
+        Color color = (i == PROFILE_FRAME_ROW) ? YELLOW : RAYWHITE;
+
+        DrawText(rowNames[i], posX, y, 10, color);
+        DrawText(TextFormat("%.2f", stats[i].min), posX + 80, y, 10, color);
+        DrawText(TextFormat("%.2f", stats[i].avg), posX + 80 + columnWidth, y, 10, color);
+        DrawText(TextFormat("%.2f", stats[i].p99), posX + 80 + 2*columnWidth, y, 10, color);
+        DrawText(TextFormat("%.2f", stats[i].max), posX + 80 + 3*columnWidth, y, 10, color);
+    }
+
+    DrawText(TextFormat("draw calls  %i", lastDrawCalls), posX, posY + (PROFILE_ROWS + 1)*lineHeight, 10, LIGHTGRAY);
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+static void UpdateStats(void)
+{
+    static float sorted[PROFILER_HISTORY] = { 0 };
+
+    if (historyCount == 0) return;
+
+    for (int i = 0; i < PROFILE_ROWS; i++)
+    {
+        double sum = 0.0;
+
+        for (int j = 0; j < historyCount; j++)
+        {
+            sorted[j] = history[i][j];
+            sum += sorted[j];
+        }
+
+        qsort(sorted, historyCount, sizeof(float), CompareFloat);
+
+        stats[i].min = sorted[0];
+        stats[i].avg = (float)(sum/historyCount);
+        stats[i].p99 = sorted[(int)ceilf(0.99f*historyCount) - 1];
+        stats[i].max = sorted[historyCount - 1];
+    }
+}
+
+static int CompareFloat(const void *a, const void *b)
+{
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,50 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - frame profiler
+*
+*   Measures how long each phase of a frame takes (update, terrain, sprites, HUD, present,
+*   music) with the high resolution clock of GetTime(), and keeps the last frames to show
+*   min/avg/p99/max on an overlay. Every frame can also be written to a CSV file, with the
+*   number of draw calls it made.
+*
+*   NOTE: Draw calls are batched, so the GPU work of the draw phases mostly shows up in
+*   the present phase (EndDrawing(): buffer swap, vsync and frame rate wait).
+*
+********************************************************************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "raylib.h"
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define PROFILER_HISTORY               600        // Frames the statistics are computed on (10 s at 60 FPS)
+#define PROFILER_REFRESH                30        // Frames between two updates of the overlay statistics
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum ProfilePhase {
+    PROFILE_UPDATE = 0,             // UpdateGame(): input, AI, shell physics
+    PROFILE_TERRAIN,                // Terrain layer baking and drawing
+    PROFILE_SPRITES,                // Tanks and shell
+    PROFILE_HUD,                    // Texts, aim lines and this overlay
+    PROFILE_PRESENT,                // World texture stretched to the window, EndDrawing()
+    PROFILE_MUSIC,                  // UpdateAudio(): decoded music handed to the audio stream
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void InitProfiler(const char *csvFileName);            // Start profiling, csvFileName: NULL for no CSV
+void CloseProfiler(void);                               // Close the CSV file
+void NextProfileFrame(void);                            // Call once at the start of every frame, ends the previous one
+void BeginProfilePhase(ProfilePhase phase);
+void EndProfilePhase(ProfilePhase phase);               // A phase can be measured several times in a frame, times add up
+void CountDrawCalls(int count);                         // Add raylib draw calls made this frame (raylib batches them in fewer GPU ones)
+void DrawProfilerOverlay(int posX, int posY);
+
+#endif // PROFILER_H
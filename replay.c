@@ -0,0 +1,253 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - replays
+*
+*   Files are written byte by byte in little endian, so they can be shared between machines.
+*
+********************************************************************************************/
+
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define REPLAY_HEADER_SIZE               23
+#define REPLAY_INPUT_SIZE                 5
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static bool AddInput(Replay *replay, int angle, int power, int munition);    // false if there is no memory for it
+static void WriteU16(unsigned char *data, unsigned int value);
+static void WriteU32(unsigned char *data, unsigned int value);
+static unsigned int ReadU16(const unsigned char *data);
+static unsigned int ReadU32(const unsigned char *data);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void BeginReplay(Replay *replay, const Game *game, unsigned int seed)
+{
+    replay->seed = seed;
+    replay->playerCount = game->playerCount;
+    replay->screens = game->worldScreens;
+    replay->physics = game->physics;
+    replay->firstTurn = game->playerTurn;
+    replay->winner = 0;
+    replay->rounds = 0;
+    replay->inputCount = 0;
+}
+
+bool RecordShot(Replay *replay, int angle, int power, Munition munition)
+{
+    if (power < 0) power = 0;
+    if (power > SHRT_MAX) power = SHRT_MAX;
+
+    return AddInput(replay, angle, power, munition);
+}
+
+bool RecordNewMap(Replay *replay)
+{
+    return AddInput(replay, 0, REPLAY_NEW_MAP, MUNITION_SHELL);
+}
+
+bool RecordPreviousMap(Replay *replay)
+{
+    return AddInput(replay, 0, REPLAY_PREVIOUS_MAP, MUNITION_SHELL);
+}
+
+void EndReplay(Replay *replay, const Game *game)
+{
+    replay->winner = game->winner;
+    replay->rounds = game->round;
+}
+
+bool SaveReplay(const Replay *replay, const char *fileName)
+{
+    int size = REPLAY_HEADER_SIZE + replay->inputCount*REPLAY_INPUT_SIZE;
+    unsigned char *data = (unsigned char *)malloc(size);
+
+    if (data == NULL) return false;
+
+    memcpy(data, "TDRP", 4);
+    WriteU16(data + 4, REPLAY_VERSION);
+    data[6] = (unsigned char)replay->firstTurn;
+    data[7] = (unsigned char)replay->winner;
+    WriteU32(data + 8, replay->seed);
+    WriteU32(data + 12, (unsigned int)replay->rounds);
+    WriteU32(data + 16, (unsigned int)replay->inputCount);
+    data[20] = (unsigned char)replay->playerCount;
+    data[21] = (unsigned char)replay->screens;
+    data[22] = (unsigned char)replay->physics;
+
+    for (int i = 0; i < replay->inputCount; i++)
+    {
+        unsigned char *input = data + REPLAY_HEADER_SIZE + i*REPLAY_INPUT_SIZE;
+
+        WriteU16(input, (unsigned short)replay->inputs[i].angle);
+        WriteU16(input + 2, (unsigned short)replay->inputs[i].power);
+        input[4] = replay->inputs[i].munition;
+    }
+
+    FILE *file = fopen(fileName, "wb");
+    bool saved = false;
+
+    if (file != NULL)
+    {
+        saved = (fwrite(data, 1, size, file) == (size_t)size);
+        if (fclose(file) != 0) saved = false;
+    }
+
+    free(data);
+
+    return saved;
+}
+
+bool LoadReplay(Replay *replay, const char *fileName)
+{
+    FILE *file = fopen(fileName, "rb");
+
+    if (file == NULL) return false;
+
+    unsigned char header[REPLAY_HEADER_SIZE] = { 0 };
+    bool loaded = (fread(header, 1, REPLAY_HEADER_SIZE, file) == REPLAY_HEADER_SIZE) && (memcmp(header, "TDRP", 4) == 0);
+
+    // NOTE: Only the current version loads, older files were played with other maps and rules
+    loaded = loaded && (ReadU16(header + 4) == REPLAY_VERSION);
+
+    int playerCount = header[20];
+    int screens = header[21];
+    int physics = header[22];
+
+    loaded = loaded && (playerCount >= MIN_PLAYERS) && (playerCount <= MAX_PLAYERS) && (header[6] < playerCount);
+    loaded = loaded && (screens >= 1) && (screens <= MAX_WORLD_SCREENS);
+    loaded = loaded && (physics < PHYSICS_COUNT);
+
+    unsigned int inputCount = loaded ? ReadU32(header + 16) : 0;
+
+    if (inputCount > INT_MAX/REPLAY_INPUT_SIZE) loaded = false;
+
+    if (loaded)
+    {
+        replay->seed = ReadU32(header + 8);
+        replay->playerCount = playerCount;
+        replay->screens = screens;
+        replay->physics = (PhysicsMode)physics;
+        replay->firstTurn = header[6];
+        replay->winner = header[7];
+        replay->rounds = (int)ReadU32(header + 12);
+        replay->inputCount = 0;
+
+        unsigned char input[REPLAY_INPUT_SIZE] = { 0 };
+
+        for (unsigned int i = 0; i < inputCount; i++)
+        {
+            if ((fread(input, 1, REPLAY_INPUT_SIZE, file) != REPLAY_INPUT_SIZE) ||
+                !AddInput(replay, (short)ReadU16(input), (short)ReadU16(input + 2), input[4]))
+            {
+                loaded = false;
+                break;
+            }
+        }
+    }
+
+    fclose(file);
+
+    return loaded;
+}
+
+void UnloadReplay(Replay *replay)
+{
+    free(replay->inputs);
+
+    *replay = (Replay){ 0 };
+}
+
+void StartReplay(const Replay *replay, Game *game)
+{
+    SeedGame(game, replay->seed);
+    SetPlayerCount(game, replay->playerCount);
+    SetWorldScreens(game, replay->screens);
+    SetPhysicsMode(game, replay->physics);
+    InitLives(game);
+    game->playerTurn = replay->firstTurn;
+    InitGame(game);
+}
+
+ShellEvent PlayReplayInput(const Replay *replay, Game *game, int index)
+{
+    ReplayInput input = replay->inputs[index];
+
+    if (input.power == REPLAY_NEW_MAP)
+    {
+        InitGame(game);
+        return SHELL_NONE;
+    }
+
+    if (input.power == REPLAY_PREVIOUS_MAP)
+    {
+        InitPreviousMap(game);
+        return SHELL_NONE;
+    }
+
+    if (!FireMunition(game, input.angle, input.power, (Munition)input.munition)) return SHELL_NONE;
+
+    return LandShell(game);
+}
+
+bool PlayReplay(const Replay *replay, Game *game)
+{
+    StartReplay(replay, game);
+
+    for (int i = 0; (i < replay->inputCount) && !game->gameOver; i++) PlayReplayInput(replay, game, i);
+
+    return (game->winner == replay->winner) && (game->round == replay->rounds);
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+static bool AddInput(Replay *replay, int angle, int power, int munition)
+{
+    if (replay->inputCount >= replay->inputCapacity)
+    {
+        int capacity = (replay->inputCapacity > 0) ? replay->inputCapacity*2 : 256;
+        ReplayInput *inputs = (ReplayInput *)realloc(replay->inputs, capacity*sizeof(ReplayInput));
+
+        if (inputs == NULL) return false;
+
+        replay->inputs = inputs;
+        replay->inputCapacity = capacity;
+    }
+
+    replay->inputs[replay->inputCount++] = (ReplayInput){ (short)angle, (short)power, (unsigned char)munition };
+
+    return true;
+}
+
+static void WriteU16(unsigned char *data, unsigned int value)
+{
+    data[0] = value & 0xff;
+    data[1] = (value >> 8) & 0xff;
+}
+
+static void WriteU32(unsigned char *data, unsigned int value)
+{
+    WriteU16(data, value & 0xffff);
+    WriteU16(data + 2, value >> 16);
+}
+
+static unsigned int ReadU16(const unsigned char *data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+static unsigned int ReadU32(const unsigned char *data)
+{
+    return ReadU16(data) | (ReadU16(data + 2) << 16);
+}
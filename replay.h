@@ -0,0 +1,71 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - replays
+*
+*   The game core is deterministic: the map comes from the seed given to SeedGame() and the
+*   shells from the (angle, power, munition) of each shot. A match is recorded as that seed
+*   plus the list of shots, 5 bytes each, and replayed by firing them again, as fast as
+*   LandShell() allows or at the pace of the game.
+*
+*   File layout (little endian):
+*       "TDRP", version (u16), first player (u8), winner (u8), seed (u32), rounds (u32),
+*       input count (u32), players (u8), screens (u8), physics (u8), then per input: angle (i16),
+*       power (i16), munition (u8)
+*
+*   Only files of the current version load, older versions were played with other maps and
+*   rules and are refused.
+*
+********************************************************************************************/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define REPLAY_VERSION                    6        // 2: players, 3: screens, 4: pixel hits, 5: maps from their own seed, 6: physics of the match
+#define REPLAY_NEW_MAP                   -1        // Power of an input that regenerates the map instead of firing ([R] key)
+#define REPLAY_PREVIOUS_MAP              -2        // Power of an input that plays the previous map again ([B] key)
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct ReplayInput {
+    short angle;                    // Degrees
+    short power;                    // REPLAY_NEW_MAP, REPLAY_PREVIOUS_MAP: map change instead of a shot
+    unsigned char munition;         // Munition
+} ReplayInput;
+
+typedef struct Replay {
+    unsigned int seed;              // SeedGame() seed of the match
+    int playerCount;
+    int screens;                    // World width, SetWorldScreens()
+    PhysicsMode physics;            // SetPhysicsMode()
+    int firstTurn;                  // Player who fires first
+    int winner;                     // Outcome, checked on playback (0: match not finished)
+    int rounds;
+
+    int inputCount;
+    int inputCapacity;
+    ReplayInput *inputs;
+} Replay;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void BeginReplay(Replay *replay, const Game *game, unsigned int seed);     // Start recording, after SeedGame(), SetWorldScreens(), InitLives() and InitGame()
+bool RecordShot(Replay *replay, int angle, int power, Munition munition);   // Record a shot FireMunition() accepted, false if there is no memory for it
+bool RecordNewMap(Replay *replay);                                          // Record an InitGame() asked by the player, false if there is no memory for it
+bool RecordPreviousMap(Replay *replay);                                     // Record an InitPreviousMap() asked by the player, false if there is no memory for it
+void EndReplay(Replay *replay, const Game *game);                           // Record the outcome
+bool SaveReplay(const Replay *replay, const char *fileName);
+bool LoadReplay(Replay *replay, const char *fileName);                      // Returns false if the file is missing, not a replay of this version or its inputs do not fit in memory
+void UnloadReplay(Replay *replay);
+
+void StartReplay(const Replay *replay, Game *game);                         // Set the game as it was at the start of the recorded match
+ShellEvent PlayReplayInput(const Replay *replay, Game *game, int index);    // Apply one input, the shell lands at once
+bool PlayReplay(const Replay *replay, Game *game);                          // Replay the whole match, returns true if the outcome matches
+
+#endif // REPLAY_H
@@ -0,0 +1,217 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - dynamic resolution
+*
+*   The render texture is as large as the game area in the window, and only reallocated
+*   when the window size changes: a lower render scale draws the world in its top left
+*   part, and DrawWorld() stretches that part, so changing the scale costs nothing.
+*
+*   Frame times are looked at over windows of RESOLUTION_WINDOW seconds. With vsync or a
+*   frame rate cap, a frame that fits in the budget takes exactly the target time and one
+*   that does not takes far longer, so counting the frames over the target is a steadier
+*   signal than their average.
+*
+********************************************************************************************/
+
+#include "resolution.h"
+
+#include <math.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define RESOLUTION_DEFAULT_FPS           60        // Target of uncapped and vsync games, the refresh rate is not known
+#define RESOLUTION_WINDOW              0.5f        // s: frame times are counted over windows this long
+#define RESOLUTION_MISS_RATIO         1.15f        // Frames this much longer than the target missed it
+#define RESOLUTION_DROP_SHARE         0.2f         // Share of missed frames in a window that lowers the scale
+#define RESOLUTION_HOLD               2.0f         // s without a missed frame before the scale is raised
+#define RESOLUTION_MAX_HOLD          32.0f         // Longest wait, after raises that did not hold
+#define RESOLUTION_MAX_FRAME_TIME     0.25f        // Longer frames are not the GPU (loading, window moved), not counted
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static int gameWidth = 0;
+static int gameHeight = 0;
+static float targetFrameTime = 1.0f/RESOLUTION_DEFAULT_FPS;
+
+static RenderTexture2D target = { 0 };
+static Rectangle output = { 0 };                        // Game area in the window
+static float outputScale = 1.0f;                        // Window pixels per game pixel
+
+static float renderScale = RESOLUTION_MAX_SCALE;
+static bool automatic = true;
+
+static float windowTime = 0.0f;                         // Frames of the current window
+static int windowFrames = 0;
+static int windowMissed = 0;
+static float stableTime = 0.0f;                         // s since the last missed frame
+static float holdTime = RESOLUTION_HOLD;                // s to wait before the next raise
+static float raiseTime = -1.0f;                         // s since the last raise, negative once it held
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void AdjustRenderScale(float frameTime);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void InitResolution(int width, int height, int targetFPS)
+{
+    gameWidth = width;
+    gameHeight = height;
+    targetFrameTime = 1.0f/((targetFPS > 0) ? targetFPS : RESOLUTION_DEFAULT_FPS);
+
+    UpdateResolution(0.0f);
+}
+
+void UnloadResolution(void)
+{
+    if (target.id > 0) UnloadRenderTexture(target);
+    target = (RenderTexture2D){ 0 };
+}
+
+void SetRenderScale(float scale)
+{
+    automatic = (scale <= 0.0f);
+    renderScale = automatic ? RESOLUTION_MAX_SCALE : fminf(fmaxf(scale, 0.1f), RESOLUTION_MAX_SCALE);
+}
+
+void UpdateResolution(float frameTime)
+{
+    int windowWidth = GetScreenWidth();
+    int windowHeight = GetScreenHeight();
+
+    if ((windowWidth <= 0) || (windowHeight <= 0)) return;     // Minimized, keep the last size
+
+    outputScale = fminf((float)windowWidth/gameWidth, (float)windowHeight/gameHeight);
+
+    int width = (int)(gameWidth*outputScale + 0.5f);
+    int height = (int)(gameHeight*outputScale + 0.5f);
+
+    // Letterboxed at whole pixels, so a 1:1 copy stays sharp
+    output = (Rectangle){ (float)((windowWidth - width)/2), (float)((windowHeight - height)/2), (float)width, (float)height };
+
+    if ((target.id == 0) || (target.texture.width != width) || (target.texture.height != height))
+    {
+        UnloadResolution();
+
+        target = LoadRenderTexture(width, height);
+        SetTextureFilter(target.texture, FILTER_BILINEAR);
+
+        TraceLog(LOG_INFO, "Resolution: %ix%i output", width, height);
+
+        return;     // The frame of a resize is slow whatever the scale
+    }
+
+    if (automatic) AdjustRenderScale(frameTime);
+}
+
+void BeginWorldMode(float viewLeft)
+{
+    float scale = outputScale*renderScale;
+
+    BeginTextureMode(target);
+    ClearBackground(RAYWHITE);
+
+    // NOTE: Only the offset is set, so the camera reads the same on every raylib version
+    BeginMode2D((Camera2D){ (Vector2){ -viewLeft*scale, 0 }, (Vector2){ 0, 0 }, 0.0f, scale });
+}
+
+void EndWorldMode(void)
+{
+    EndMode2D();
+    EndTextureMode();
+}
+
+void DrawWorld(void)
+{
+    Vector2 size = GetRenderSize();
+
+    // Render textures are upside down, the world is at the top of the texture
+    DrawTexturePro(target.texture, (Rectangle){ 0, target.texture.height - size.y, size.x, -size.y }, output, (Vector2){ 0, 0 }, 0.0f, WHITE);
+}
+
+void BeginHudMode(void)
+{
+    BeginMode2D((Camera2D){ (Vector2){ output.x, output.y }, (Vector2){ 0, 0 }, 0.0f, outputScale });
+}
+
+void EndHudMode(void)
+{
+    EndMode2D();
+}
+
+Vector2 GetGameMousePosition(void)
+{
+    Vector2 mouse = GetMousePosition();
+
+    return (Vector2){ (mouse.x - output.x)/outputScale, (mouse.y - output.y)/outputScale };
+}
+
+float GetRenderScale(void)
+{
+    return renderScale;
+}
+
+Vector2 GetRenderSize(void)
+{
+    return (Vector2){ ceilf(output.width*renderScale), ceilf(output.height*renderScale) };
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+// Down as soon as a window misses the budget, up one step after holdTime without a missed frame
+static void AdjustRenderScale(float frameTime)
+{
+    if ((frameTime <= 0.0f) || (frameTime > RESOLUTION_MAX_FRAME_TIME)) return;
+
+    windowTime += frameTime;
+    windowFrames++;
+    if (frameTime > targetFrameTime*RESOLUTION_MISS_RATIO) windowMissed++;
+    if (raiseTime >= 0.0f) raiseTime += frameTime;
+
+    if (windowTime < RESOLUTION_WINDOW) return;
+
+    float missedShare = (float)windowMissed/windowFrames;
+
+    if (missedShare > RESOLUTION_DROP_SHARE)
+    {
+        // The last raise did not hold: back to the scale that did, and wait longer before trying again
+        // Otherwise two steps at once when most frames miss
+        int steps = ((raiseTime < 0.0f) && (missedShare > 0.5f)) ? 2 : 1;
+
+        renderScale = fmaxf(renderScale - steps*RESOLUTION_STEP, RESOLUTION_MIN_SCALE);
+
+        if (raiseTime >= 0.0f) holdTime = fminf(2.0f*holdTime, RESOLUTION_MAX_HOLD);
+
+        raiseTime = -1.0f;
+        stableTime = 0.0f;
+    }
+    else if (windowMissed == 0)
+    {
+        stableTime += windowTime;
+
+        // The last raise held as long as it waited for: raise sooner again
+        if (raiseTime >= holdTime)
+        {
+            holdTime = fmaxf(holdTime/2.0f, RESOLUTION_HOLD);
+            raiseTime = -1.0f;
+        }
+
+        if ((stableTime >= holdTime) && (renderScale < RESOLUTION_MAX_SCALE))
+        {
+            renderScale = fminf(renderScale + RESOLUTION_STEP, RESOLUTION_MAX_SCALE);
+            stableTime = 0.0f;
+            raiseTime = 0.0f;
+        }
+    }
+    else stableTime = 0.0f;
+
+    windowTime = 0.0f;
+    windowFrames = 0;
+    windowMissed = 0;
+}
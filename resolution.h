@@ -0,0 +1,47 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - dynamic resolution
+*
+*   The game is laid out on a fixed screenWidth x screenHeight area, scaled to fit the window
+*   (letterboxed when the shapes differ). The world is rendered into a texture at a share of
+*   that output size, the render scale, then stretched into the window; the HUD is drawn
+*   after it, straight into the window, so text stays sharp whatever the render scale.
+*
+*   The render scale follows the frame times: it drops as soon as frames take longer than
+*   the target frame rate allows, and is raised again by one step after a while within the
+*   budget. A raise that makes frames miss again is undone and the next one waits longer,
+*   so the scale settles just below what the GPU can draw instead of going up and down.
+*
+********************************************************************************************/
+
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include "raylib.h"
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define RESOLUTION_MIN_SCALE          0.50f        // Lowest render scale of the automatic mode
+#define RESOLUTION_MAX_SCALE          1.00f
+#define RESOLUTION_STEP               0.05f        // Render scale change of each adjustment
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void InitResolution(int gameWidth, int gameHeight, int targetFPS);     // targetFPS <= 0: 60
+void UnloadResolution(void);
+void SetRenderScale(float scale);                       // Fixed render scale, 0: automatic (default)
+void UpdateResolution(float frameTime);                 // Once a frame, before drawing: output from the window size, render scale from the frame times
+
+void BeginWorldMode(float viewLeft);                    // Draw the world in game coordinates into the render texture, the view starting at viewLeft
+void EndWorldMode(void);
+void DrawWorld(void);                                   // Stretch the world into the window, between BeginDrawing() and EndDrawing()
+void BeginHudMode(void);                                // Draw in game coordinates straight into the window
+void EndHudMode(void);
+
+Vector2 GetGameMousePosition(void);                     // Mouse in game coordinates
+float GetRenderScale(void);                             // Share of the output resolution the world is rendered at
+Vector2 GetRenderSize(void);                            // World pixels rendered this frame
+
+#endif // RESOLUTION_H
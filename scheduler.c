@@ -0,0 +1,219 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - job scheduler
+*
+*   The share of each thread is a range of job indices packed in one 64 bits word, first
+*   job in the low half and end in the high half, only ever changed by compare and swap:
+*   the owner moves the first job up, thieves move the end down. A thief only writes its
+*   own range once it is empty, and nobody can take from an empty range, so a plain store
+*   is enough there. Jobs are only moved, never created, so a thread that finds every
+*   range empty can leave: whatever is still being stolen is run by its thief.
+*
+********************************************************************************************/
+
+#include "scheduler.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(PLATFORM_WEB) && !defined(SCHEDULER_NO_THREADS)
+    #define SCHEDULER_NO_THREADS        // Emscripten builds are single threaded
+#endif
+
+#if !defined(SCHEDULER_NO_THREADS)
+    #include <pthread.h>
+    #if defined(_WIN32)
+        // NOTE: Declared here instead of including windows.h, its Rectangle() function clashes with the Rectangle type
+        __declspec(dllimport) unsigned long __stdcall GetActiveProcessorCount(unsigned short GroupNumber);
+    #else
+        #include <unistd.h>
+    #endif
+#endif
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define CACHE_LINE_SIZE                  64
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+// Share of a thread, alone on its cache line so the owners do not slow each other down
+typedef struct JobRange {
+    uint64_t range;                 // First job | end << 32
+    char padding[CACHE_LINE_SIZE - sizeof(uint64_t)];
+} JobRange;
+
+typedef struct JobPool {
+    JobRange share[MAX_JOB_THREADS];
+    int threadCount;
+    JobFunction function;
+    void *context;
+} JobPool;
+
+typedef struct JobThread {
+    JobPool *pool;
+    int index;
+} JobThread;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void RunThreadJobs(JobPool *pool, int thread);
+static bool TakeJob(JobRange *share, int *job);
+static bool StealJobs(JobPool *pool, int thread);
+
+#if !defined(SCHEDULER_NO_THREADS)
+static void *JobThreadMain(void *arg);
+#endif
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+int GetProcessorCount(void)
+{
+    int count = 1;
+
+#if !defined(SCHEDULER_NO_THREADS)
+    #if defined(_WIN32)
+    count = (int)GetActiveProcessorCount(0xffff);
+    #else
+    count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+#endif
+
+    return (count > 0) ? count : 1;
+}
+
+int RunJobs(int count, int threads, JobFunction function, void *context)
+{
+    static JobPool pool = { 0 };        // NOTE: One RunJobs() at a time
+
+    if (threads <= 0) threads = GetProcessorCount();
+    if (threads > MAX_JOB_THREADS) threads = MAX_JOB_THREADS;
+    if (threads > count) threads = (count > 0) ? count : 1;
+#if defined(SCHEDULER_NO_THREADS)
+    threads = 1;
+#endif
+
+    pool.threadCount = threads;
+    pool.function = function;
+    pool.context = context;
+
+    // Even shares to start with
+    for (int i = 0; i < threads; i++)
+    {
+        uint64_t first = (uint64_t)count*i/threads;
+        uint64_t end = (uint64_t)count*(i + 1)/threads;
+
+        __atomic_store_n(&pool.share[i].range, first | (end << 32), __ATOMIC_RELAXED);
+    }
+
+#if !defined(SCHEDULER_NO_THREADS)
+    pthread_t handle[MAX_JOB_THREADS];
+    JobThread thread[MAX_JOB_THREADS];
+    int started = 1;
+
+    // The calling thread is thread 0, if a thread does not start its share gets stolen
+    for (int i = 1; i < threads; i++)
+    {
+        thread[i] = (JobThread){ &pool, i };
+
+        if (pthread_create(&handle[started], NULL, JobThreadMain, &thread[i]) == 0) started++;
+    }
+
+    RunThreadJobs(&pool, 0);
+
+    for (int i = 1; i < started; i++) pthread_join(handle[i], NULL);
+
+    return started;
+#else
+    RunThreadJobs(&pool, 0);
+
+    return 1;
+#endif
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+static void RunThreadJobs(JobPool *pool, int thread)
+{
+    int job = 0;
+
+    do
+    {
+        while (TakeJob(&pool->share[thread], &job)) pool->function(job, thread, pool->context);
+    }
+    while (StealJobs(pool, thread));
+}
+
+// Owner side: the first job of the share
+static bool TakeJob(JobRange *share, int *job)
+{
+    uint64_t range = __atomic_load_n(&share->range, __ATOMIC_ACQUIRE);
+
+    while (true)
+    {
+        uint32_t first = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+
+        if (first >= end) return false;
+
+        if (__atomic_compare_exchange_n(&share->range, &range, (uint64_t)(first + 1) | ((uint64_t)end << 32), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            *job = (int)first;
+            return true;
+        }
+    }
+}
+
+// Thief side: the back half of the largest share left (all of it if one job), false if every share is empty
+static bool StealJobs(JobPool *pool, int thread)
+{
+    while (true)
+    {
+        int victim = -1;
+        uint32_t most = 0;
+
+        for (int i = 1; i < pool->threadCount; i++)
+        {
+            int other = (thread + i)%pool->threadCount;
+            uint64_t range = __atomic_load_n(&pool->share[other].range, __ATOMIC_ACQUIRE);
+            uint32_t left = ((uint32_t)(range >> 32) > (uint32_t)range) ? (uint32_t)(range >> 32) - (uint32_t)range : 0;
+
+            if (left > most)
+            {
+                most = left;
+                victim = other;
+            }
+        }
+
+        if (victim < 0) return false;
+
+        uint64_t range = __atomic_load_n(&pool->share[victim].range, __ATOMIC_ACQUIRE);
+        uint32_t first = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+
+        if (first >= end) continue;             // Emptied meanwhile, look again
+
+        uint32_t middle = first + (end - first)/2;
+
+        if (__atomic_compare_exchange_n(&pool->share[victim].range, &range, (uint64_t)first | ((uint64_t)middle << 32), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            __atomic_store_n(&pool->share[thread].range, (uint64_t)middle | ((uint64_t)end << 32), __ATOMIC_RELEASE);
+            return true;
+        }
+    }
+}
+
+#if !defined(SCHEDULER_NO_THREADS)
+static void *JobThreadMain(void *arg)
+{
+    JobThread *thread = (JobThread *)arg;
+
+    RunThreadJobs(thread->pool, thread->index);
+
+    return NULL;
+}
+#endif
@@ -0,0 +1,34 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - job scheduler
+*
+*   Runs jobs 0..count-1 on a pool of threads with work stealing: each thread starts with
+*   its own share of the jobs and takes them one by one from the front; a thread that runs
+*   out steals the back half of the share of another one. Long and short jobs mix without
+*   any thread waiting on a lock, so throughput grows with the cores.
+*
+*   Jobs get the index of the thread running them, so results can be gathered per thread
+*   and merged once RunJobs() returns, without any lock or shared counter.
+*
+********************************************************************************************/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define MAX_JOB_THREADS                  64
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef void (*JobFunction)(int job, int thread, void *context);
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+int GetProcessorCount(void);                                                    // Processors online, at least 1
+int RunJobs(int count, int threads, JobFunction function, void *context);      // Run every job and return, threads 0: one per processor, returns the threads used
+
+#endif // SCHEDULER_H
@@ -0,0 +1,788 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - shell batch kernel
+*
+*   The lanes are stepped in registers, a step being:
+*       x += vx*dt,  y += vy*dt + g*dt^2/2,  vy += g*dt        (exact for constant gravity)
+*   then the same tests as CheckShellCollision(), in the same order: screen edges, skyline,
+*   tanks (circle against rectangle, then the few lanes touching one against its mask), and
+*   the nose of the shell against the terrain.
+*   Like FlyShell(), a shell above the skyline jumps to where it comes down to it.
+*   Lanes done keep their state until half of them are, then they are written back and
+*   refilled with the next shells, so short flights do not wait for long ones.
+*
+********************************************************************************************/
+
+#include "shellbatch.h"
+#include "tankmask.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define SHELL_BATCH_X86             // SSE2 and AVX2 kernels, compiled with target attributes and picked at runtime
+    #include <immintrin.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+
+// What the shells can hit, flattened for the kernels
+typedef struct BatchScene {
+    float gravity;
+    float radius;
+    float skyline;
+    float width;
+    float height;
+
+    int tankCount;
+    float tankX0[MAX_PLAYERS];
+    float tankY0[MAX_PLAYERS];
+    float tankX1[MAX_PLAYERS];
+    float tankY1[MAX_PLAYERS];
+    bool tankOwn[MAX_PLAYERS];      // Tank of the shooter, shells fly through it
+    int tankPlayer[MAX_PLAYERS];    // Player of each tank, only the tanks alive are listed
+    const TankMask *tankMask[MAX_PLAYERS];
+
+    int recCount;
+    float recX0[MAX_WORLD_BUILDINGS];       // Building rectangles, a superset of the terrain (craters only remove ground)
+    float recX1[MAX_WORLD_BUILDINGS];
+    float recY0[MAX_WORLD_BUILDINGS];
+
+    const Terrain *terrain;
+} BatchScene;
+
+// Lane registers spilled to memory, to retire the shells that landed and load new ones
+typedef struct LaneState {
+    float x[8];
+    float y[8];
+    float vx[8];
+    float vy[8];
+    float time[8];
+    int steps[8];                   // Steps flown in this call
+    int tank[8];                    // Tank hit
+    int event[8];                   // ShellEvent
+    int shell[8];                   // Shell in the lane, -1: empty
+} LaneState;
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+static bool batchISAReady = false;
+static ShellBatchISA batchISA = SHELL_BATCH_SCALAR;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static ShellBatchISA GetSupportedISA(void);
+static void InitScene(BatchScene *scene, const Game *game);
+static int SkipSkyline(const BatchScene *scene, float *x, float *y, float vx, float *vy, float *time);
+static int TestLane(const BatchScene *scene, float x, float y, float vx, float vy, int *hitIndex);
+static int SimulateLanesScalar(ShellBatch *batch, const BatchScene *scene, int first, int last, float deltaTime, int maxSteps);
+
+#if defined(SHELL_BATCH_X86)
+static bool LoadLane(ShellBatch *batch, LaneState *lanes, int lane, int *next, int last);
+static int RetireLanes(ShellBatch *batch, LaneState *lanes, int width, int activeBits, int doneBits, int *next, int last, int *flying);
+static int CheckTankLanes(const BatchScene *scene, int tank, const float *x, const float *y, int width, int touchBits);
+static int CheckTerrainLanes(const BatchScene *scene, const float *noseX, const float *noseY, int width, int candidateBits);
+static int SimulateLanesSSE2(ShellBatch *batch, const BatchScene *scene, int first, int last, float deltaTime, int maxSteps);
+static int SimulateLanesAVX2(ShellBatch *batch, const BatchScene *scene, int first, int last, float deltaTime, int maxSteps);
+#endif
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+ShellBatch LoadShellBatch(int capacity)
+{
+    ShellBatch batch = { 0 };
+
+    batch.capacity = capacity;
+    batch.x = (float *)malloc(capacity*sizeof(float));
+    batch.y = (float *)malloc(capacity*sizeof(float));
+    batch.vx = (float *)malloc(capacity*sizeof(float));
+    batch.vy = (float *)malloc(capacity*sizeof(float));
+    batch.time = (float *)malloc(capacity*sizeof(float));
+    batch.event = (int *)malloc(capacity*sizeof(int));
+    batch.hitIndex = (int *)malloc(capacity*sizeof(int));
+
+    return batch;
+}
+
+void UnloadShellBatch(ShellBatch *batch)
+{
+    free(batch->x);
+    free(batch->y);
+    free(batch->vx);
+    free(batch->vy);
+    free(batch->time);
+    free(batch->event);
+    free(batch->hitIndex);
+
+    *batch = (ShellBatch){ 0 };
+}
+
+void ClearShellBatch(ShellBatch *batch)
+{
+    batch->count = 0;
+}
+
+int AddShellToBatch(ShellBatch *batch, Trajectory trajectory)
+{
+    if (batch->count >= batch->capacity) return -1;
+
+    int i = batch->count;
+
+    batch->x[i] = trajectory.origin.x;
+    batch->y[i] = trajectory.origin.y;
+    batch->vx[i] = trajectory.velocity.x;
+    batch->vy[i] = trajectory.velocity.y;
+    batch->time[i] = 0.0f;
+    batch->event[i] = SHELL_NONE;
+    batch->hitIndex[i] = -1;
+    batch->count++;
+
+    return i;
+}
+
+int SimulateShellBatch(ShellBatch *batch, const Game *game, float deltaTime, int maxSteps)
+{
+    BatchScene scene = { 0 };
+
+    // NOTE: The lanes fly gravity-only arcs, the flights of the other physics would be wrong
+    if ((game->physics != PHYSICS_CLASSIC) && (game->physics != PHYSICS_LOW_GRAVITY)) return -1;
+
+    InitScene(&scene, game);
+
+    switch (GetShellBatchISA())
+    {
+#if defined(SHELL_BATCH_X86)
+        case SHELL_BATCH_AVX2: return SimulateLanesAVX2(batch, &scene, 0, batch->count, deltaTime, maxSteps);
+        case SHELL_BATCH_SSE2: return SimulateLanesSSE2(batch, &scene, 0, batch->count, deltaTime, maxSteps);
+#endif
+        default: return SimulateLanesScalar(batch, &scene, 0, batch->count, deltaTime, maxSteps);
+    }
+}
+
+ShellBatchISA GetShellBatchISA(void)
+{
+    if (!batchISAReady)
+    {
+        batchISA = GetSupportedISA();
+        batchISAReady = true;
+    }
+
+    return batchISA;
+}
+
+const char *GetShellBatchISAName(ShellBatchISA isa)
+{
+    switch (isa)
+    {
+        case SHELL_BATCH_AVX2: return "AVX2";
+        case SHELL_BATCH_SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
+
+ShellBatchISA SetShellBatchISA(ShellBatchISA isa)
+{
+    ShellBatchISA supported = GetSupportedISA();
+
+    batchISA = (isa < supported) ? isa : supported;
+    batchISAReady = true;
+
+    return batchISA;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+static ShellBatchISA GetSupportedISA(void)
+{
+#if defined(SHELL_BATCH_X86)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SHELL_BATCH_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SHELL_BATCH_SSE2;
+#endif
+
+    return SHELL_BATCH_SCALAR;
+}
+
+static void InitScene(BatchScene *scene, const Game *game)
+{
+    scene->gravity = GetPhysicsGravity(game->physics);
+    scene->radius = SHELL_RADIUS;
+    scene->skyline = game->skyline;
+    scene->width = game->worldWidth;
+    scene->height = screenHeight;
+    scene->terrain = &game->terrain;
+
+    scene->tankCount = 0;
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Player *player = &game->player[i];
+        int tank = scene->tankCount;
+
+        if (!player->isAlive) continue;
+
+        scene->tankX0[tank] = player->position.x - player->size.x/2;
+        scene->tankX1[tank] = player->position.x + player->size.x/2;
+        scene->tankY1[tank] = player->position.y + player->size.y/2;
+        scene->tankY0[tank] = scene->tankY1[tank] - TANK_SPRITE_HEIGHT;
+        scene->tankOwn[tank] = (i == game->playerTurn);
+        scene->tankPlayer[tank] = i;
+        scene->tankMask[tank] = GetTankMask(player->isLeftTeam);
+        scene->tankCount++;
+    }
+
+    scene->recCount = game->buildingCount;
+
+    for (int i = 0; i < game->buildingCount; i++)
+    {
+        scene->recX0[i] = game->building[i].rectangle.x;
+        scene->recX1[i] = game->building[i].rectangle.x + game->building[i].rectangle.width;
+        scene->recY0[i] = game->building[i].rectangle.y;
+    }
+}
+
+// Move a shell above the skyline straight to where it comes down to it, returns SHELL_MISSED
+// if it leaves the screen before
+static int SkipSkyline(const BatchScene *scene, float *x, float *y, float vx, float *vy, float *time)
+{
+    float radius = scene->radius;
+    Trajectory trajectory = { 0 };      // Gravity arc (PHYSICS_CLASSIC), the only one the kernel flies
+
+    trajectory.origin = (Vector2){ *x, *y };
+    trajectory.velocity = (Vector2){ vx, *vy };
+    trajectory.gravity = scene->gravity;
+
+    float skylineTime = TrajectoryTimeAtY(trajectory, scene->skyline - radius);
+    float edgeTime = TrajectoryTimeAtX(trajectory, (vx < 0.0f) ? -radius : scene->width + radius);
+    bool missed = (edgeTime >= 0.0f) && ((skylineTime < 0.0f) || (edgeTime < skylineTime));
+    float skipTime = missed ? edgeTime : skylineTime;
+
+    if (skipTime < 0.0f) skipTime = 0.0f;
+
+    Vector2 position = TrajectoryPosition(trajectory, skipTime);
+
+    *x = position.x;
+    *y = missed ? position.y : fmaxf(position.y, scene->skyline - radius);     // Rounding must not leave it above
+    *vy += scene->gravity*skipTime;
+    *time += skipTime;
+
+    return missed ? SHELL_MISSED : SHELL_NONE;
+}
+
+// What a shell at (x, y) flying along (vx, vy) hits
+static int TestLane(const BatchScene *scene, float x, float y, float vx, float vy, int *hitIndex)
+{
+    float radius = scene->radius;
+
+    if ((x + radius < 0) || (x - radius > scene->width) || (y - radius > scene->height)) return SHELL_MISSED;
+    if (y + radius < scene->skyline) return SHELL_NONE;
+
+    for (int i = 0; i < scene->tankCount; i++)
+    {
+        float dx = fmaxf(fmaxf(scene->tankX0[i] - x, x - scene->tankX1[i]), 0.0f);
+        float dy = fmaxf(fmaxf(scene->tankY0[i] - y, y - scene->tankY1[i]), 0.0f);
+
+        if (dx*dx + dy*dy <= radius*radius)
+        {
+            if (scene->tankOwn[i]) return SHELL_NONE;
+
+            // Box touched, the pixels of the sprite decide
+            if (CheckCollisionCircleMask((Vector2){ x, y }, radius, scene->tankMask[i], (Vector2){ scene->tankX0[i], scene->tankY0[i] }))
+            {
+                *hitIndex = scene->tankPlayer[i];
+                return SHELL_HIT_PLAYER;
+            }
+        }
+    }
+
+    float speed = sqrtf(vx*vx + vy*vy);
+    float noseX = (speed > 0.0f) ? x + vx*radius/speed : x;
+    float noseY = (speed > 0.0f) ? y + vy*radius/speed : y + radius;
+
+    if (IsTerrainSolid(scene->terrain, (int)floorf(noseX), (int)floorf(noseY))) return SHELL_HIT_BUILDING;
+
+    return SHELL_NONE;
+}
+
+static int SimulateLanesScalar(ShellBatch *batch, const BatchScene *scene, int first, int last, float deltaTime, int maxSteps)
+{
+    float gravityStep = scene->gravity*deltaTime;
+    float gravityOffset = scene->gravity*deltaTime*deltaTime/2;
+    int flying = 0;
+
+    for (int i = first; i < last; i++)
+    {
+        if (batch->event[i] != SHELL_NONE) continue;
+
+        float x = batch->x[i];
+        float y = batch->y[i];
+        float vx = batch->vx[i];
+        float vy = batch->vy[i];
+        float time = batch->time[i];
+        int event = SHELL_NONE;
+        int hitIndex = -1;
+
+        for (int step = 0; (step < maxSteps) && (event == SHELL_NONE); step++)
+        {
+            x += vx*deltaTime;
+            y += vy*deltaTime + gravityOffset;
+            vy += gravityStep;
+            time += deltaTime;
+
+            if ((y + scene->radius < scene->skyline) && (x + scene->radius >= 0) && (x - scene->radius <= scene->width)) event = SkipSkyline(scene, &x, &y, vx, &vy, &time);
+            else event = TestLane(scene, x, y, vx, vy, &hitIndex);
+        }
+
+        batch->x[i] = x;
+        batch->y[i] = y;
+        batch->vx[i] = vx;
+        batch->vy[i] = vy;
+        batch->time[i] = time;
+        batch->event[i] = event;
+        batch->hitIndex[i] = hitIndex;
+
+        if (event == SHELL_NONE) flying++;
+    }
+
+    return flying;
+}
+
+#if defined(SHELL_BATCH_X86)
+
+// Put the next flying shell in a lane, returns false when there is none left
+static bool LoadLane(ShellBatch *batch, LaneState *lanes, int lane, int *next, int last)
+{
+    while ((*next < last) && (batch->event[*next] != SHELL_NONE)) (*next)++;
+
+    if (*next >= last)
+    {
+        lanes->shell[lane] = -1;
+        return false;
+    }
+
+    int i = (*next)++;
+
+    lanes->shell[lane] = i;
+    lanes->x[lane] = batch->x[i];
+    lanes->y[lane] = batch->y[i];
+    lanes->vx[lane] = batch->vx[i];
+    lanes->vy[lane] = batch->vy[i];
+    lanes->time[lane] = batch->time[i];
+    lanes->steps[lane] = 0;
+
+    return true;
+}
+
+// Write back the shells of the lanes that are done (landed or out of steps) and load new shells
+// in those lanes, returns the lanes that still hold a shell
+static int RetireLanes(ShellBatch *batch, LaneState *lanes, int width, int activeBits, int doneBits, int *next, int last, int *flying)
+{
+    for (int b = 0; b < width; b++)
+    {
+        if (!(doneBits & (1 << b))) continue;
+
+        int i = lanes->shell[b];
+
+        batch->x[i] = lanes->x[b];
+        batch->y[i] = lanes->y[b];
+        batch->vx[i] = lanes->vx[b];
+        batch->vy[i] = lanes->vy[b];
+        batch->time[i] = lanes->time[b];
+        batch->event[i] = lanes->event[b];
+        batch->hitIndex[i] = (lanes->event[b] == SHELL_HIT_PLAYER) ? lanes->tank[b] : -1;
+
+        if (lanes->event[b] == SHELL_NONE) (*flying)++;
+
+        if (!LoadLane(batch, lanes, b, next, last)) activeBits &= ~(1 << b);
+    }
+
+    return activeBits;
+}
+
+// Confirm the lanes touching the rectangle of a tank against its mask
+static int CheckTankLanes(const BatchScene *scene, int tank, const float *x, const float *y, int width, int touchBits)
+{
+    int hitBits = 0;
+    Vector2 origin = { scene->tankX0[tank], scene->tankY0[tank] };
+
+    for (int b = 0; b < width; b++)
+    {
+        if ((touchBits & (1 << b)) && CheckCollisionCircleMask((Vector2){ x[b], y[b] }, scene->radius, scene->tankMask[tank], origin)) hitBits |= (1 << b);
+    }
+
+    return hitBits;
+}
+
+// Confirm the lanes whose nose entered a building rectangle against the terrain, craters included
+static int CheckTerrainLanes(const BatchScene *scene, const float *noseX, const float *noseY, int width, int candidateBits)
+{
+    int buildingBits = 0;
+
+    for (int b = 0; b < width; b++)
+    {
+        if ((candidateBits & (1 << b)) && IsTerrainSolid(scene->terrain, (int)floorf(noseX[b]), (int)floorf(noseY[b]))) buildingBits |= (1 << b);
+    }
+
+    return buildingBits;
+}
+
+// Lane mask from lane bits, and a select for SSE2 that has no blend instruction
+#define LANE_MASK_SSE2(bits)            _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), laneBit), laneBit))
+#define LANE_MASK_AVX2(bits)            _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), laneBit), laneBit))
+#define SELECT_SSE2(mask, a, b)         _mm_or_ps(_mm_and_ps((mask), (a)), _mm_andnot_ps((mask), (b)))
+#define SELECT_SSE2_INT(mask, a, b)     _mm_castps_si128(SELECT_SSE2((mask), _mm_castsi128_ps(a), _mm_castsi128_ps(b)))
+
+__attribute__((target("sse2")))
+static int SimulateLanesSSE2(ShellBatch *batch, const BatchScene *scene, int first, int last, float deltaTime, int maxSteps)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    const __m128 gravity = _mm_set1_ps(scene->gravity);
+    const __m128 halfGravity = _mm_set1_ps(scene->gravity/2);
+    const __m128 invGravity = _mm_set1_ps(1.0f/scene->gravity);
+    const __m128 gravityStep = _mm_set1_ps(scene->gravity*deltaTime);
+    const __m128 gravityOffset = _mm_set1_ps(scene->gravity*deltaTime*deltaTime/2);
+    const __m128 radius = _mm_set1_ps(scene->radius);
+    const __m128 radius2 = _mm_set1_ps(scene->radius*scene->radius);
+    const __m128 width = _mm_set1_ps(scene->width);
+    const __m128 height = _mm_set1_ps(scene->height);
+    const __m128 skyline = _mm_set1_ps(scene->skyline);
+    const __m128 skylineTop = _mm_set1_ps(scene->skyline - scene->radius);
+    const __m128 leftEdge = _mm_set1_ps(-scene->radius);
+    const __m128 rightEdge = _mm_set1_ps(scene->width + scene->radius);
+    const __m128 tiny = _mm_set1_ps(1e-12f);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i stepLimit = _mm_set1_epi32(maxSteps);
+    const __m128i laneBit = _mm_setr_epi32(1, 2, 4, 8);
+
+    LaneState lanes = { 0 };
+    float noseX[4], noseY[4];
+    float laneX[4], laneY[4];
+    int next = first;
+    int flying = 0;
+    int activeBits = 0;
+
+    for (int b = 0; b < 4; b++) if (LoadLane(batch, &lanes, b, &next, last)) activeBits |= (1 << b);
+
+    while (activeBits)
+    {
+        __m128 x = _mm_loadu_ps(lanes.x);
+        __m128 y = _mm_loadu_ps(lanes.y);
+        __m128 vx = _mm_loadu_ps(lanes.vx);
+        __m128 vy = _mm_loadu_ps(lanes.vy);
+        __m128 time = _mm_loadu_ps(lanes.time);
+        __m128i steps = _mm_loadu_si128((const __m128i *)lanes.steps);
+        __m128i tank = _mm_set1_epi32(-1);
+        __m128i event = _mm_set1_epi32(SHELL_NONE);
+        __m128 live = LANE_MASK_SSE2(activeBits);
+        int doneBits = 0;
+
+        // Step the lanes in registers until half of them are done, the lanes done keep their last state
+        while ((doneBits != activeBits) && (__builtin_popcount(doneBits) < 2))
+        {
+            x = SELECT_SSE2(live, _mm_add_ps(x, _mm_mul_ps(vx, dt)), x);
+            y = SELECT_SSE2(live, _mm_add_ps(y, _mm_add_ps(_mm_mul_ps(vy, dt), gravityOffset)), y);
+            vy = SELECT_SSE2(live, _mm_add_ps(vy, gravityStep), vy);
+            time = SELECT_SSE2(live, _mm_add_ps(time, dt), time);
+            steps = _mm_add_epi32(steps, _mm_and_si128(one, _mm_castps_si128(live)));
+
+            int liveBits = activeBits & ~doneBits;
+            int expiredBits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(steps, stepLimit))) & liveBits;
+
+            __m128 missed = _mm_or_ps(_mm_cmplt_ps(_mm_add_ps(x, radius), zero), _mm_cmpgt_ps(_mm_sub_ps(x, radius), width));
+            missed = _mm_and_ps(_mm_or_ps(missed, _mm_cmpgt_ps(_mm_sub_ps(y, radius), height)), live);
+            __m128 below = _mm_andnot_ps(missed, _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(y, radius), skyline), live));
+
+            int missedBits = _mm_movemask_ps(missed);
+            int belowBits = _mm_movemask_ps(below);
+            int aboveBits = liveBits & ~(missedBits | belowBits);
+            int tankBits = 0;
+            int buildingBits = 0;
+
+            // Lanes above the skyline jump to where they come down to it, or to the screen edge
+            if (aboveBits)
+            {
+                __m128 above = LANE_MASK_SSE2(aboveBits);
+                __m128 discriminant = _mm_sub_ps(_mm_mul_ps(vy, vy), _mm_mul_ps(_mm_add_ps(gravity, gravity), _mm_sub_ps(y, skylineTop)));
+                __m128 skylineTime = _mm_mul_ps(_mm_sub_ps(_mm_sqrt_ps(discriminant), vy), invGravity);
+                __m128 edgeTime = _mm_div_ps(_mm_sub_ps(SELECT_SSE2(_mm_cmplt_ps(vx, zero), leftEdge, rightEdge), x), vx);
+                __m128 leave = _mm_and_ps(_mm_cmplt_ps(edgeTime, skylineTime), above);
+                __m128 skipTime = _mm_and_ps(_mm_min_ps(edgeTime, skylineTime), above);
+
+                x = _mm_add_ps(x, _mm_mul_ps(vx, skipTime));
+                y = _mm_add_ps(y, _mm_add_ps(_mm_mul_ps(vy, skipTime), _mm_mul_ps(halfGravity, _mm_mul_ps(skipTime, skipTime))));
+                y = SELECT_SSE2(_mm_andnot_ps(leave, above), _mm_max_ps(y, skylineTop), y);      // Rounding must not leave it above
+                vy = _mm_add_ps(vy, _mm_mul_ps(gravity, skipTime));
+                time = _mm_add_ps(time, skipTime);
+
+                missedBits |= _mm_movemask_ps(leave);
+            }
+
+            if (belowBits)
+            {
+                // Tanks, the first one touched decides (own tank: the shell flies on)
+                __m128 decided = zero;
+                __m128 tankHit = zero;
+
+                for (int i = 0; i < scene->tankCount; i++)
+                {
+                    __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(scene->tankX0[i]), x), _mm_sub_ps(x, _mm_set1_ps(scene->tankX1[i]))), zero);
+                    __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(scene->tankY0[i]), y), _mm_sub_ps(y, _mm_set1_ps(scene->tankY1[i]))), zero);
+                    __m128 touch = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), radius2);
+
+                    touch = _mm_andnot_ps(decided, _mm_and_ps(touch, below));
+
+                    // Few lanes touch a tank: confirm against its pixels (a shell leaving its own tank flies on either way)
+                    int touchBits = scene->tankOwn[i] ? 0 : _mm_movemask_ps(touch);
+
+                    if (touchBits)
+                    {
+                        _mm_storeu_ps(laneX, x);
+                        _mm_storeu_ps(laneY, y);
+                        touch = LANE_MASK_SSE2(CheckTankLanes(scene, i, laneX, laneY, 4, touchBits));
+                    }
+
+                    if (!scene->tankOwn[i])
+                    {
+                        tankHit = _mm_or_ps(tankHit, touch);
+                        tank = SELECT_SSE2_INT(touch, _mm_set1_epi32(scene->tankPlayer[i]), tank);
+                    }
+
+                    decided = _mm_or_ps(decided, touch);
+                }
+
+                tankBits = _mm_movemask_ps(tankHit);
+
+                // Nose of the shell against the building rectangles
+                __m128 invSpeed = _mm_rsqrt_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), tiny));
+                __m128 nx = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(vx, radius), invSpeed));
+                __m128 ny = _mm_add_ps(y, _mm_mul_ps(_mm_mul_ps(vy, radius), invSpeed));
+                __m128 inside = _mm_cmpge_ps(ny, height);
+
+                for (int i = 0; i < scene->recCount; i++)
+                {
+                    __m128 inRec = _mm_and_ps(_mm_cmpge_ps(nx, _mm_set1_ps(scene->recX0[i])), _mm_cmplt_ps(nx, _mm_set1_ps(scene->recX1[i])));
+
+                    inside = _mm_or_ps(inside, _mm_and_ps(inRec, _mm_cmpge_ps(ny, _mm_set1_ps(scene->recY0[i]))));
+                }
+
+                int candidateBits = _mm_movemask_ps(_mm_andnot_ps(decided, _mm_and_ps(inside, below)));
+
+                // Few lanes get here: confirm against the terrain, craters included
+                if (candidateBits)
+                {
+                    _mm_storeu_ps(noseX, nx);
+                    _mm_storeu_ps(noseY, ny);
+                    buildingBits = CheckTerrainLanes(scene, noseX, noseY, 4, candidateBits);
+                }
+            }
+
+            int newBits = missedBits | tankBits | buildingBits | expiredBits;
+
+            if (newBits)
+            {
+                event = SELECT_SSE2_INT(LANE_MASK_SSE2(buildingBits), _mm_set1_epi32(SHELL_HIT_BUILDING), event);
+                event = SELECT_SSE2_INT(LANE_MASK_SSE2(tankBits), _mm_set1_epi32(SHELL_HIT_PLAYER), event);
+                event = SELECT_SSE2_INT(LANE_MASK_SSE2(missedBits), _mm_set1_epi32(SHELL_MISSED), event);
+
+                doneBits |= newBits;
+                live = LANE_MASK_SSE2(activeBits & ~doneBits);
+            }
+        }
+
+        _mm_storeu_ps(lanes.x, x);
+        _mm_storeu_ps(lanes.y, y);
+        _mm_storeu_ps(lanes.vx, vx);
+        _mm_storeu_ps(lanes.vy, vy);
+        _mm_storeu_ps(lanes.time, time);
+        _mm_storeu_si128((__m128i *)lanes.steps, steps);
+        _mm_storeu_si128((__m128i *)lanes.tank, tank);
+        _mm_storeu_si128((__m128i *)lanes.event, event);
+
+        activeBits = RetireLanes(batch, &lanes, 4, activeBits, doneBits, &next, last, &flying);
+    }
+
+    return flying;
+}
+
+__attribute__((target("avx2,fma")))
+static int SimulateLanesAVX2(ShellBatch *batch, const BatchScene *scene, int first, int last, float deltaTime, int maxSteps)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 dt = _mm256_set1_ps(deltaTime);
+    const __m256 gravity = _mm256_set1_ps(scene->gravity);
+    const __m256 halfGravity = _mm256_set1_ps(scene->gravity/2);
+    const __m256 invGravity = _mm256_set1_ps(1.0f/scene->gravity);
+    const __m256 gravityStep = _mm256_set1_ps(scene->gravity*deltaTime);
+    const __m256 gravityOffset = _mm256_set1_ps(scene->gravity*deltaTime*deltaTime/2);
+    const __m256 radius = _mm256_set1_ps(scene->radius);
+    const __m256 radius2 = _mm256_set1_ps(scene->radius*scene->radius);
+    const __m256 width = _mm256_set1_ps(scene->width);
+    const __m256 height = _mm256_set1_ps(scene->height);
+    const __m256 skyline = _mm256_set1_ps(scene->skyline);
+    const __m256 skylineTop = _mm256_set1_ps(scene->skyline - scene->radius);
+    const __m256 leftEdge = _mm256_set1_ps(-scene->radius);
+    const __m256 rightEdge = _mm256_set1_ps(scene->width + scene->radius);
+    const __m256 tiny = _mm256_set1_ps(1e-12f);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i stepLimit = _mm256_set1_epi32(maxSteps);
+    const __m256i laneBit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    LaneState lanes = { 0 };
+    float noseX[8], noseY[8];
+    float laneX[8], laneY[8];
+    int next = first;
+    int flying = 0;
+    int activeBits = 0;
+
+    for (int b = 0; b < 8; b++) if (LoadLane(batch, &lanes, b, &next, last)) activeBits |= (1 << b);
+
+    while (activeBits)
+    {
+        __m256 x = _mm256_loadu_ps(lanes.x);
+        __m256 y = _mm256_loadu_ps(lanes.y);
+        __m256 vx = _mm256_loadu_ps(lanes.vx);
+        __m256 vy = _mm256_loadu_ps(lanes.vy);
+        __m256 time = _mm256_loadu_ps(lanes.time);
+        __m256i steps = _mm256_loadu_si256((const __m256i *)lanes.steps);
+        __m256i tank = _mm256_set1_epi32(-1);
+        __m256i event = _mm256_set1_epi32(SHELL_NONE);
+        __m256 live = LANE_MASK_AVX2(activeBits);
+        int doneBits = 0;
+
+        // Step the lanes in registers until half of them are done, the lanes done keep their last state
+        while ((doneBits != activeBits) && (__builtin_popcount(doneBits) < 4))
+        {
+            x = _mm256_blendv_ps(x, _mm256_fmadd_ps(vx, dt, x), live);
+            y = _mm256_blendv_ps(y, _mm256_add_ps(y, _mm256_fmadd_ps(vy, dt, gravityOffset)), live);
+            vy = _mm256_blendv_ps(vy, _mm256_add_ps(vy, gravityStep), live);
+            time = _mm256_blendv_ps(time, _mm256_add_ps(time, dt), live);
+            steps = _mm256_add_epi32(steps, _mm256_and_si256(one, _mm256_castps_si256(live)));
+
+            int liveBits = activeBits & ~doneBits;
+            int expiredBits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(steps, stepLimit))) & liveBits;
+
+            __m256 missed = _mm256_or_ps(_mm256_cmp_ps(_mm256_add_ps(x, radius), zero, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_sub_ps(x, radius), width, _CMP_GT_OQ));
+            missed = _mm256_and_ps(_mm256_or_ps(missed, _mm256_cmp_ps(_mm256_sub_ps(y, radius), height, _CMP_GT_OQ)), live);
+            __m256 below = _mm256_andnot_ps(missed, _mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(y, radius), skyline, _CMP_GE_OQ), live));
+
+            int missedBits = _mm256_movemask_ps(missed);
+            int belowBits = _mm256_movemask_ps(below);
+            int aboveBits = liveBits & ~(missedBits | belowBits);
+            int tankBits = 0;
+            int buildingBits = 0;
+
+            // Lanes above the skyline jump to where they come down to it, or to the screen edge
+            if (aboveBits)
+            {
+                __m256 above = LANE_MASK_AVX2(aboveBits);
+                __m256 discriminant = _mm256_fnmadd_ps(_mm256_add_ps(gravity, gravity), _mm256_sub_ps(y, skylineTop), _mm256_mul_ps(vy, vy));
+                __m256 skylineTime = _mm256_mul_ps(_mm256_sub_ps(_mm256_sqrt_ps(discriminant), vy), invGravity);
+                __m256 edgeTime = _mm256_div_ps(_mm256_sub_ps(_mm256_blendv_ps(rightEdge, leftEdge, _mm256_cmp_ps(vx, zero, _CMP_LT_OQ)), x), vx);
+                __m256 leave = _mm256_and_ps(_mm256_cmp_ps(edgeTime, skylineTime, _CMP_LT_OQ), above);
+                __m256 skipTime = _mm256_and_ps(_mm256_min_ps(edgeTime, skylineTime), above);
+
+                x = _mm256_fmadd_ps(vx, skipTime, x);
+                y = _mm256_add_ps(y, _mm256_fmadd_ps(vy, skipTime, _mm256_mul_ps(halfGravity, _mm256_mul_ps(skipTime, skipTime))));
+                y = _mm256_blendv_ps(y, _mm256_max_ps(y, skylineTop), _mm256_andnot_ps(leave, above));    // Rounding must not leave it above
+                vy = _mm256_fmadd_ps(gravity, skipTime, vy);
+                time = _mm256_add_ps(time, skipTime);
+
+                missedBits |= _mm256_movemask_ps(leave);
+            }
+
+            if (belowBits)
+            {
+                // Tanks, the first one touched decides (own tank: the shell flies on)
+                __m256 decided = zero;
+                __m256 tankHit = zero;
+
+                for (int i = 0; i < scene->tankCount; i++)
+                {
+                    __m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_set1_ps(scene->tankX0[i]), x), _mm256_sub_ps(x, _mm256_set1_ps(scene->tankX1[i]))), zero);
+                    __m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_set1_ps(scene->tankY0[i]), y), _mm256_sub_ps(y, _mm256_set1_ps(scene->tankY1[i]))), zero);
+                    __m256 touch = _mm256_cmp_ps(_mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy)), radius2, _CMP_LE_OQ);
+
+                    touch = _mm256_andnot_ps(decided, _mm256_and_ps(touch, below));
+
+                    // Few lanes touch a tank: confirm against its pixels (a shell leaving its own tank flies on either way)
+                    int touchBits = scene->tankOwn[i] ? 0 : _mm256_movemask_ps(touch);
+
+                    if (touchBits)
+                    {
+                        _mm256_storeu_ps(laneX, x);
+                        _mm256_storeu_ps(laneY, y);
+                        touch = LANE_MASK_AVX2(CheckTankLanes(scene, i, laneX, laneY, 8, touchBits));
+                    }
+
+                    if (!scene->tankOwn[i])
+                    {
+                        tankHit = _mm256_or_ps(tankHit, touch);
+                        tank = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(tank), _mm256_castsi256_ps(_mm256_set1_epi32(scene->tankPlayer[i])), touch));
+                    }
+
+                    decided = _mm256_or_ps(decided, touch);
+                }
+
+                tankBits = _mm256_movemask_ps(tankHit);
+
+                // Nose of the shell against the building rectangles
+                __m256 invSpeed = _mm256_rsqrt_ps(_mm256_max_ps(_mm256_fmadd_ps(vx, vx, _mm256_mul_ps(vy, vy)), tiny));
+                __m256 nx = _mm256_fmadd_ps(_mm256_mul_ps(vx, radius), invSpeed, x);
+                __m256 ny = _mm256_fmadd_ps(_mm256_mul_ps(vy, radius), invSpeed, y);
+                __m256 inside = _mm256_cmp_ps(ny, height, _CMP_GE_OQ);
+
+                for (int i = 0; i < scene->recCount; i++)
+                {
+                    __m256 inRec = _mm256_and_ps(_mm256_cmp_ps(nx, _mm256_set1_ps(scene->recX0[i]), _CMP_GE_OQ), _mm256_cmp_ps(nx, _mm256_set1_ps(scene->recX1[i]), _CMP_LT_OQ));
+
+                    inside = _mm256_or_ps(inside, _mm256_and_ps(inRec, _mm256_cmp_ps(ny, _mm256_set1_ps(scene->recY0[i]), _CMP_GE_OQ)));
+                }
+
+                int candidateBits = _mm256_movemask_ps(_mm256_andnot_ps(decided, _mm256_and_ps(inside, below)));
+
+                // Few lanes get here: confirm against the terrain, craters included
+                if (candidateBits)
+                {
+                    _mm256_storeu_ps(noseX, nx);
+                    _mm256_storeu_ps(noseY, ny);
+                    buildingBits = CheckTerrainLanes(scene, noseX, noseY, 8, candidateBits);
+                }
+            }
+
+            int newBits = missedBits | tankBits | buildingBits | expiredBits;
+
+            if (newBits)
+            {
+                event = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(event), _mm256_castsi256_ps(_mm256_set1_epi32(SHELL_HIT_BUILDING)), LANE_MASK_AVX2(buildingBits)));
+                event = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(event), _mm256_castsi256_ps(_mm256_set1_epi32(SHELL_HIT_PLAYER)), LANE_MASK_AVX2(tankBits)));
+                event = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(event), _mm256_castsi256_ps(_mm256_set1_epi32(SHELL_MISSED)), LANE_MASK_AVX2(missedBits)));
+
+                doneBits |= newBits;
+                live = LANE_MASK_AVX2(activeBits & ~doneBits);
+            }
+        }
+
+        _mm256_storeu_ps(lanes.x, x);
+        _mm256_storeu_ps(lanes.y, y);
+        _mm256_storeu_ps(lanes.vx, vx);
+        _mm256_storeu_ps(lanes.vy, vy);
+        _mm256_storeu_ps(lanes.time, time);
+        _mm256_storeu_si256((__m256i *)lanes.steps, steps);
+        _mm256_storeu_si256((__m256i *)lanes.tank, tank);
+        _mm256_storeu_si256((__m256i *)lanes.event, event);
+
+        activeBits = RetireLanes(batch, &lanes, 8, activeBits, doneBits, &next, last, &flying);
+    }
+
+    return flying;
+}
+
+#endif // SHELL_BATCH_X86
@@ -0,0 +1,69 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - shell batch kernel
+*
+*   Flies many shells at once for bulk work (throughput runs, searches that can live with an
+*   approximate impact). Shells are stored as structure of arrays and stepped 8 (AVX2) or 4
+*   (SSE2) at a time, including the tests against the tanks and the building rectangles,
+*   which give a hit mask per lane.
+*   The few lanes whose nose enters a building are then checked against the terrain bitmask,
+*   so craters count. The instruction set is picked at runtime, with a scalar fallback.
+*
+*   Shells move with a fixed time step, without the swept samples and the contact bisection
+*   of FlyShell() in game.c: hits are exact to one step (SHELL_BATCH_STEP). So the AI and the
+*   preview, which must see the shells the game flies, keep SimulateShot() and TraceShot(),
+*   and only the headless runner links this module (headless bench).
+*
+*   NOTE: The kernel flies gravity arcs only: SimulateShellBatch() refuses the games of the
+*   wind, drag and bounce physics, the classic and low gravity ones fly.
+*
+********************************************************************************************/
+
+#ifndef SHELLBATCH_H
+#define SHELLBATCH_H
+
+#include "game.h"
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define SHELL_BATCH_STEP       (1.0f/240)          // Default time step (s), 4 px at 1000 px/s
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum ShellBatchISA {
+    SHELL_BATCH_SCALAR = 0,
+    SHELL_BATCH_SSE2,
+    SHELL_BATCH_AVX2
+} ShellBatchISA;
+
+typedef struct ShellBatch {
+    int count;                      // Shells in the batch
+    int capacity;
+
+    float *x;                       // Position
+    float *y;
+    float *vx;                      // Velocity (px/s)
+    float *vy;
+    float *time;                    // Flight time (s)
+    int *event;                     // ShellEvent, SHELL_NONE while flying
+    int *hitIndex;                  // Tank hit, -1 if none
+} ShellBatch;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+ShellBatch LoadShellBatch(int capacity);                                // Allocate a batch for capacity shells
+void UnloadShellBatch(ShellBatch *batch);
+void ClearShellBatch(ShellBatch *batch);                                // Remove all the shells
+int AddShellToBatch(ShellBatch *batch, Trajectory trajectory);          // Returns the shell index, -1 if the batch is full
+
+// Fly the shells of the current player until they land or maxSteps steps, returns how many are still flying (-1: physics not supported)
+int SimulateShellBatch(ShellBatch *batch, const Game *game, float deltaTime, int maxSteps);
+
+ShellBatchISA GetShellBatchISA(void);                                   // Instruction set in use
+const char *GetShellBatchISAName(ShellBatchISA isa);
+ShellBatchISA SetShellBatchISA(ShellBatchISA isa);                      // Force an instruction set (benchmarks), clamped to what the CPU supports
+
+#endif // SHELLBATCH_H
@@ -0,0 +1,348 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - snapshots
+*
+*   The Game struct is cut in segments around its four big arrays (terrain bits, plan
+*   rectangles, plan craters and baked bits), and only their used part is copied. The same
+*   segment list drives saving and restoring.
+*
+********************************************************************************************/
+
+#include "snapshot.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    // NOTE: Declared here instead of including windows.h, its Rectangle() function clashes with the Rectangle type
+    __declspec(dllimport) int __stdcall MoveFileExA(const char *existingFileName, const char *newFileName, unsigned long flags);
+    #define MOVEFILE_REPLACE_EXISTING   0x1
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define SEGMENT_COUNT                     9
+#define TERRAIN_OFFSET(field)  (offsetof(Game, terrain) + offsetof(Terrain, field))
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct Segment {
+    size_t offset;                  // In the Game struct
+    size_t size;
+} Segment;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void GetSegments(Segment *segment, const SnapshotHeader *header);
+static size_t GetSegmentsSize(const Segment *segment);
+static SnapshotHeader GetHeader(const Game *game, int tag);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+int SaveSnapshot(const Game *game, int tag, unsigned char *data)
+{
+    SnapshotHeader header = GetHeader(game, tag);
+    Segment segment[SEGMENT_COUNT];
+    unsigned char *out = data + sizeof(SnapshotHeader);
+
+    GetSegments(segment, &header);
+
+    memcpy(data, &header, sizeof(SnapshotHeader));
+
+    for (int i = 0; i < SEGMENT_COUNT; i++)
+    {
+        memcpy(out, (const unsigned char *)game + segment[i].offset, segment[i].size);
+        out += segment[i].size;
+    }
+
+    return (int)header.size;
+}
+
+bool RestoreSnapshot(const unsigned char *data, int size, Game *game, int *tag)
+{
+    SnapshotHeader header;
+
+    if ((data == NULL) || (size < (int)sizeof(SnapshotHeader))) return false;
+
+    memcpy(&header, data, sizeof(SnapshotHeader));
+
+    if ((memcmp(header.magic, "TDSN", 4) != 0) || (header.version != SNAPSHOT_VERSION)) return false;
+    if ((header.headerSize != sizeof(SnapshotHeader)) || (header.gameSize != sizeof(Game))) return false;
+    if ((header.bitsSlots < 0) || (header.bitsSlots > TERRAIN_CACHE_CHUNKS)) return false;
+    if ((header.recCount < 0) || (header.recCount > TERRAIN_MAX_RECS)) return false;
+    if ((header.craterCount < 0) || (header.craterCount > TERRAIN_MAX_CRATERS)) return false;
+    if ((header.bakedSlots < 0) || (header.bakedSlots > TERRAIN_BAKED_CHUNKS)) return false;
+
+    Segment segment[SEGMENT_COUNT];
+
+    GetSegments(segment, &header);
+
+    if ((header.size != (unsigned int)size) || (header.size != sizeof(SnapshotHeader) + GetSegmentsSize(segment))) return false;
+
+    const unsigned char *in = data + sizeof(SnapshotHeader);
+
+    for (int i = 0; i < SEGMENT_COUNT; i++)
+    {
+        memcpy((unsigned char *)game + segment[i].offset, in, segment[i].size);
+        in += segment[i].size;
+    }
+
+    // The chunk slots saved refer to bits that were not
+    EvictTerrain(&game->terrain);
+
+    if (tag != NULL) *tag = header.tag;
+
+    return true;
+}
+
+int GetSnapshotSize(const Game *game)
+{
+    return (int)GetHeader(game, 0).size;
+}
+
+bool SaveSnapshotFile(const Game *game, int tag, const char *fileName)
+{
+    unsigned char *data = (unsigned char *)malloc(SNAPSHOT_MAX_SIZE);
+
+    if (data == NULL) return false;
+
+    int size = SaveSnapshot(game, tag, data);
+    unsigned int checksum = HashBytes(2166136261u, data + sizeof(SnapshotHeader), size - sizeof(SnapshotHeader));
+
+    memcpy(data + offsetof(SnapshotHeader, checksum), &checksum, sizeof(checksum));
+
+    // Written aside then renamed over the previous file
+    char tempName[512];
+    bool saved = false;
+
+    snprintf(tempName, sizeof(tempName), "%s.tmp", fileName);
+
+    FILE *file = fopen(tempName, "wb");
+
+    if (file != NULL)
+    {
+        saved = (fwrite(data, 1, size, file) == (size_t)size);
+        if (fclose(file) != 0) saved = false;
+    }
+
+#if defined(_WIN32)
+    if (saved) saved = (MoveFileExA(tempName, fileName, MOVEFILE_REPLACE_EXISTING) != 0);    // rename() does not replace files on Windows
+#else
+    if (saved) saved = (rename(tempName, fileName) == 0);
+#endif
+    if (!saved) remove(tempName);
+
+    free(data);
+
+    return saved;
+}
+
+bool MapSnapshotFile(SnapshotFile *file, const char *fileName)
+{
+    *file = (SnapshotFile){ 0 };
+
+#if !defined(_WIN32)
+    int descriptor = open(fileName, O_RDONLY);
+    struct stat status;
+
+    if (descriptor < 0) return false;
+
+    if ((fstat(descriptor, &status) == 0) && (status.st_size > 0) && (status.st_size <= SNAPSHOT_MAX_SIZE))
+    {
+        void *mapping = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+        if (mapping != MAP_FAILED)
+        {
+            file->data = (const unsigned char *)mapping;
+            file->size = (int)status.st_size;
+            file->mapped = true;
+        }
+    }
+
+    close(descriptor);          // The mapping stays valid
+
+    return file->mapped;
+#else
+    FILE *stream = fopen(fileName, "rb");
+
+    if (stream == NULL) return false;
+
+    unsigned char *data = (unsigned char *)malloc(SNAPSHOT_MAX_SIZE);
+    size_t size = (data != NULL) ? fread(data, 1, SNAPSHOT_MAX_SIZE, stream) : 0;
+
+    fclose(stream);
+
+    if (size == 0)
+    {
+        free(data);
+        return false;
+    }
+
+    file->data = data;
+    file->size = (int)size;
+
+    return true;
+#endif
+}
+
+void UnmapSnapshotFile(SnapshotFile *file)
+{
+    if (file->data != NULL)
+    {
+#if !defined(_WIN32)
+        if (file->mapped) munmap((void *)file->data, (size_t)file->size);
+#endif
+        if (!file->mapped) free((void *)file->data);
+    }
+
+    *file = (SnapshotFile){ 0 };
+}
+
+bool LoadSnapshotFile(const char *fileName, Game *game, int *tag)
+{
+    SnapshotFile file;
+
+    if (!MapSnapshotFile(&file, fileName)) return false;
+
+    SnapshotHeader header;
+    bool restored = false;
+
+    memcpy(&header, file.data, (file.size < (int)sizeof(SnapshotHeader)) ? (size_t)file.size : sizeof(SnapshotHeader));
+
+    // A damaged file leaves the game untouched
+    if ((file.size > (int)sizeof(SnapshotHeader)) && (HashBytes(2166136261u, file.data + sizeof(SnapshotHeader), file.size - sizeof(SnapshotHeader)) == header.checksum))
+    {
+        restored = RestoreSnapshot(file.data, file.size, game, tag);
+    }
+
+    UnmapSnapshotFile(&file);
+
+    return restored;
+}
+
+bool InitSnapshotRing(SnapshotRing *ring, int capacity)
+{
+    *ring = (SnapshotRing){ 0 };
+
+    if (capacity < 1) return false;
+
+    // Pages are only touched as snapshots fill them, a compact snapshot uses a third of its slot
+    ring->data = (unsigned char *)malloc((size_t)capacity*SNAPSHOT_MAX_SIZE);
+
+    if (ring->data == NULL) return false;
+
+    ring->capacity = capacity;
+
+    return true;
+}
+
+void UnloadSnapshotRing(SnapshotRing *ring)
+{
+    free(ring->data);
+
+    *ring = (SnapshotRing){ 0 };
+}
+
+void ClearSnapshotRing(SnapshotRing *ring)
+{
+    ring->first = 0;
+    ring->count = 0;
+}
+
+void PushSnapshot(SnapshotRing *ring, const Game *game, int tag)
+{
+    if (ring->capacity == 0) return;
+
+    if (ring->count == ring->capacity)
+    {
+        ring->first = (ring->first + 1)%ring->capacity;
+        ring->count--;
+    }
+
+    int slot = (ring->first + ring->count)%ring->capacity;
+
+    SaveSnapshot(game, tag, ring->data + (size_t)slot*SNAPSHOT_MAX_SIZE);
+    ring->count++;
+}
+
+bool PopSnapshot(SnapshotRing *ring, Game *game, int *tag)
+{
+    if (ring->count == 0) return false;
+
+    ring->count--;
+
+    if (game == NULL) return true;
+
+    const unsigned char *data = ring->data + (size_t)((ring->first + ring->count)%ring->capacity)*SNAPSHOT_MAX_SIZE;
+    SnapshotHeader header;
+
+    memcpy(&header, data, sizeof(SnapshotHeader));
+
+    return RestoreSnapshot(data, (int)header.size, game, tag);
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+// The Game bytes around the used part of the terrain bits, plan rectangles, plan craters and baked bits
+static void GetSegments(Segment *segment, const SnapshotHeader *header)
+{
+    size_t bitsEnd = TERRAIN_OFFSET(bits) + sizeof(((Terrain *)0)->bits);
+    size_t recEnd = TERRAIN_OFFSET(rec) + sizeof(((Terrain *)0)->rec);
+    size_t craterEnd = TERRAIN_OFFSET(planCrater) + sizeof(((Terrain *)0)->planCrater);
+    size_t bakedEnd = TERRAIN_OFFSET(baked) + sizeof(((Terrain *)0)->baked);
+
+    segment[0] = (Segment){ 0, TERRAIN_OFFSET(bits) };
+    segment[1] = (Segment){ TERRAIN_OFFSET(bits), header->bitsSlots*sizeof(((Terrain *)0)->bits[0]) };
+    segment[2] = (Segment){ bitsEnd, TERRAIN_OFFSET(rec) - bitsEnd };
+    segment[3] = (Segment){ TERRAIN_OFFSET(rec), header->recCount*sizeof(TerrainRec) };
+    segment[4] = (Segment){ recEnd, TERRAIN_OFFSET(planCrater) - recEnd };
+    segment[5] = (Segment){ TERRAIN_OFFSET(planCrater), header->craterCount*sizeof(TerrainCrater) };
+    segment[6] = (Segment){ craterEnd, TERRAIN_OFFSET(baked) - craterEnd };
+    segment[7] = (Segment){ TERRAIN_OFFSET(baked), header->bakedSlots*sizeof(((Terrain *)0)->baked[0]) };
+    segment[8] = (Segment){ bakedEnd, sizeof(Game) - bakedEnd };
+}
+
+static size_t GetSegmentsSize(const Segment *segment)
+{
+    size_t size = 0;
+
+    for (int i = 0; i < SEGMENT_COUNT; i++) size += segment[i].size;
+
+    return size;
+}
+
+// A streaming world saves no bits, its chunks are rebuilt from the plan as they are required
+static SnapshotHeader GetHeader(const Game *game, int tag)
+{
+    const Terrain *terrain = &game->terrain;
+    SnapshotHeader header = { .magic = { 'T', 'D', 'S', 'N' } };
+    Segment segment[SEGMENT_COUNT];
+
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.gameSize = sizeof(Game);
+    header.tag = tag;
+    header.bitsSlots = terrain->streaming ? 0 : terrain->chunkCount;
+    header.recCount = terrain->recCount;
+    header.craterCount = terrain->planCraterCount;
+    header.bakedSlots = terrain->bakedCount;
+
+    GetSegments(segment, &header);
+    header.size = (unsigned int)(sizeof(SnapshotHeader) + GetSegmentsSize(segment));
+
+    return header;
+}
+
+// FNV-1a
\ No newline at end of file
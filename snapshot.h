@@ -0,0 +1,88 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - snapshots
+*
+*   The game state is plain data (no pointers), so a snapshot is the Game struct itself,
+*   minus what is not in use: only the terrain chunks with bits (none for a streaming world,
+*   whose chunks are rebuilt from the plan), the plan rectangles, the plan craters and the
+*   baked chunks so far.
+*   Saving or restoring one is a few memcpy() of about 170 KB for a one screen world.
+*
+*   Unlike replays, snapshots keep the native layout of the build that saved them: a build
+*   with another Game layout (gameSize) or another SNAPSHOT_VERSION refuses them. A snapshot
+*   file is the same bytes as a snapshot in memory, so it is restored straight from a read
+*   only mapping of the file (MapSnapshotFile()).
+*
+*   Layout: SnapshotHeader, then the Game bytes up to the terrain bits, bitsSlots chunks of
+*   bits, the Game bytes up to the plan rectangles, recCount rectangles, the Game bytes up to
+*   the plan craters, craterCount craters, the Game bytes up to the baked bits, bakedSlots
+*   chunks of them and the rest of the Game bytes.
+*
+*   A SnapshotRing keeps the last snapshots, the windowed game pushes one each turn to undo
+*   shots and saves one to a file to resume a match after a crash.
+*
+********************************************************************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "game.h"
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define SNAPSHOT_VERSION                  1
+#define SNAPSHOT_MAX_SIZE  ((int)(sizeof(SnapshotHeader) + sizeof(Game)))     // Bytes of a snapshot, at most
+#define DEFAULT_SNAPSHOT_RING            16        // Turns the windowed game can undo
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct SnapshotHeader {
+    char magic[4];                  // "TDSN"
+    unsigned short version;         // SNAPSHOT_VERSION
+    unsigned short headerSize;      // sizeof(SnapshotHeader), with gameSize it tells the layout apart
+    unsigned int gameSize;          // sizeof(Game) of the build that saved it
+    unsigned int size;              // Whole snapshot, header included
+    unsigned int checksum;          // FNV-1a of the bytes after the header, files only (0 in memory)
+    int tag;                        // Caller data, e.g. the replay inputs recorded before the snapshot
+    int bitsSlots;                  // Terrain chunks saved with their bits
+    int recCount;                   // Terrain plan rectangles
+    int craterCount;                // Terrain plan craters
+    int bakedSlots;                 // Terrain chunks baked out of the plan
+} SnapshotHeader;
+
+// Snapshots of the last turns, the oldest is dropped when full
+typedef struct SnapshotRing {
+    unsigned char *data;            // capacity slots of SNAPSHOT_MAX_SIZE bytes
+    int capacity;
+    int first;                      // Slot of the oldest snapshot
+    int count;
+} SnapshotRing;
+
+// Snapshot file contents, mapped when the platform can
+typedef struct SnapshotFile {
+    const unsigned char *data;
+    int size;
+    bool mapped;                    // data is a mapping of the file, else a copy of it
+} SnapshotFile;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+int SaveSnapshot(const Game *game, int tag, unsigned char *data);          // Write the state to data (SNAPSHOT_MAX_SIZE bytes), returns its size
+bool RestoreSnapshot(const unsigned char *data, int size, Game *game, int *tag);    // Read a state back, false (game untouched) if data is not a snapshot of this build
+int GetSnapshotSize(const Game *game);                                      // Bytes SaveSnapshot() would write
+
+bool SaveSnapshotFile(const Game *game, int tag, const char *fileName);     // Replaces the file at once, a crash never leaves half a snapshot
+bool MapSnapshotFile(SnapshotFile *file, const char *fileName);
+void UnmapSnapshotFile(SnapshotFile *file);
+bool LoadSnapshotFile(const char *fileName, Game *game, int *tag);         // Map, check the checksum and restore, false (game untouched) if it does not check out
+
+bool InitSnapshotRing(SnapshotRing *ring, int capacity);
+void UnloadSnapshotRing(SnapshotRing *ring);
+void ClearSnapshotRing(SnapshotRing *ring);
+void PushSnapshot(SnapshotRing *ring, const Game *game, int tag);
+bool PopSnapshot(SnapshotRing *ring, Game *game, int *tag);     // Restore the latest snapshot and drop it (game NULL: only drop it)
+
+#endif // SNAPSHOT_H
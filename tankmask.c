@@ -0,0 +1,158 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - tank collision masks
+*
+*   A shell touches a row of pixels where the circle crosses the band of the row: at the
+*   height of the band closest to the center, the circle is widest, so the span of columns
+*   it covers there is exact for the whole band. Spans are built as masks of set bits and
+*   tested against the row words, no pixel is looked at on its own.
+*
+********************************************************************************************/
+
+#include "tankmask.h"
+
+#include <math.h>
+
+//------------------------------------------------------------------------------------
+// Global Variables Declaration
+//------------------------------------------------------------------------------------
+
+// Masks of resources/TankBleu.png and resources/TankRouge.png, as BuildTankMask() makes them
+static TankMask tankMask[2] = {
+    { 50, 30, {       // TankBleu.png, left team
+        0x0000000000000000ull,     // ..................................................
+        0x0000000000000000ull,     // ..................................................
+        0x0000000000200000ull,     // .....................#............................
+        0x000000007ff00000ull,     // ....................###########...................
+        0x0000000000608000ull,     // ...............#.....##...........................
+        0x00000000007c8000ull,     // ...............#..#####...........................
+        0x0000000003ff8000ull,     // ...............###########........................
+        0x0000000003ff8700ull,     // ........###....###########........................
+        0x000000000fffff00ull,     // ........####################......................
+        0x000000001fffff00ull,     // ........#####################.....................
+        0x0003ffffffffff00ull,     // ........##########################################
+        0x000000001fffff00ull,     // ........#####################.....................
+        0x000000003fff9700ull,     // ........###.#..###############....................
+        0x00000000fffff800ull,     // ...........#####################..................
+        0x00000001ffffff80ull,     // .......##########################.................
+        0x00000001fffffff8ull,     // ...##############################.................
+        0x0000000fffffffffull,     // ####################################..............
+        0x0000000fffffffffull,     // ####################################..............
+        0x0000001fffffffffull,     // #####################################.............
+        0x0000003ffffffffeull,     // .#####################################............
+        0x0000007ffffffffcull,     // ..#####################################...........
+        0x0000007ffffffffcull,     // ..#####################################...........
+        0x0000007ffffffffcull,     // ..#####################################...........
+        0x0000007ffffffffcull,     // ..#####################################...........
+        0x0000007ffffffffcull,     // ..#####################################...........
+        0x0000007ffffffffcull,     // ..#####################################...........
+        0x0000000ffbfeff88ull,     // ...#...#########.#########.#########..............
+        0x0000000e7bdef390ull,     // ....#..###..####.####.####.####..###..............
+        0x0000001e738e73a0ull,     // .....#.###..###..###...###..###..####.............
+        0x0000000fffffff80ull,     // .......#############################..............
+    } },
+    { 50, 30, {       // TankRouge.png, right team
+        0x0000000000000000ull,     // ..................................................
+        0x0000000000000000ull,     // ..................................................
+        0x0000000010000000ull,     // ............................#.....................
+        0x000000003ff80000ull,     // ...................###########....................
+        0x000000041c000000ull,     // ..........................###.....#...............
+        0x00000005f8000000ull,     // ...........................######.#...............
+        0x00000007ff000000ull,     // ........................###########...............
+        0x000003c7ff000000ull,     // ........................###########...####........
+        0x000003ffffc00000ull,     // ......................####################........
+        0x000003fffff00000ull,     // ....................######################........
+        0x000003ffffffffffull,     // ##########################################........
+        0x000003ffffe00000ull,     // .....................#####################........
+        0x000003e7fff00000ull,     // ....................###############..#####........
+        0x0000007ffffc0000ull,     // ..................#####################...........
+        0x00000ffffffe0000ull,     // .................###########################......
+        0x00007ffffffe0000ull,     // .................##############################...
+        0x0003ffffffffc000ull,     // ..............####################################
+        0x0003ffffffffc000ull,     // ..............####################################
+        0x0003ffffffffe000ull,     // .............#####################################
+        0x0001fffffffff800ull,     // ...........######################################.
+        0x0001fffffffff800ull,     // ...........######################################.
+        0x0000fffffffff800ull,     // ...........#####################################..
+        0x0000fffffffff800ull,     // ...........#####################################..
+        0x0000fffffffffc00ull,     // ..........######################################..
+        0x0000fffffffff800ull,     // ...........#####################################..
+        0x0000fffffffff800ull,     // ...........#####################################..
+        0x000067fdff7fd000ull,     // ............#.#########.#########.#########..##...
+        0x000027bdef79e000ull,     // .............####..####.####.####.####.####..#....
+        0x00001f3de739e000ull,     // .............####..###..###..####.####..#####.....
+        0x000007ffffffc000ull,     // ..............#############################.......
+    } },
+};
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void BuildTankMask(TankMask *mask, const unsigned char *pixels, int width, int height)
+{
+    mask->width = (width < TANK_MASK_WIDTH) ? width : TANK_MASK_WIDTH;
+    mask->height = (height < TANK_MASK_HEIGHT) ? height : TANK_MASK_HEIGHT;
+
+    for (int y = 0; y < TANK_MASK_HEIGHT; y++)
+    {
+        uint64_t row = 0;
+
+        for (int x = 0; (y < mask->height) && (x < mask->width); x++)
+        {
+            if (pixels[(y*width + x)*4 + 3] >= TANK_MASK_ALPHA) row |= (uint64_t)1 << x;
+        }
+
+        mask->row[y] = row;
+    }
+}
+
+void SetTankMask(bool leftTeam, const TankMask *mask)
+{
+    tankMask[leftTeam ? 0 : 1] = *mask;
+}
+
+const TankMask *GetTankMask(bool leftTeam)
+{
+    return &tankMask[leftTeam ? 0 : 1];
+}
+
+bool CheckCollisionCircleMask(Vector2 center, float radius, const TankMask *mask, Vector2 origin)
+{
+    // Circle in mask pixels
+    float x = center.x - origin.x;
+    float y = center.y - origin.y;
+
+    // Bounding box reject
+    if ((x + radius < 0) || (x - radius > mask->width) || (y + radius < 0) || (y - radius > mask->height)) return false;
+
+    int row0 = (int)floorf(y - radius);
+    int row1 = (int)floorf(y + radius);
+
+    if (row0 < 0) row0 = 0;
+    if (row1 >= mask->height) row1 = mask->height - 1;
+
+    for (int row = row0; row <= row1; row++)
+    {
+        if (mask->row[row] == 0) continue;
+
+        // Widest chord of the circle in the band [row, row + 1)
+        float dy = (y < row) ? row - y : ((y > row + 1) ? y - (row + 1) : 0.0f);
+        float chord = radius*radius - dy*dy;
+
+        if (chord < 0.0f) continue;
+
+        float halfWidth = sqrtf(chord);
+        int column0 = (int)floorf(x - halfWidth);
+        int column1 = (int)floorf(x + halfWidth);
+
+        if (column0 < 0) column0 = 0;
+        if (column1 >= mask->width) column1 = mask->width - 1;
+        if (column0 > column1) continue;
+
+        uint64_t span = (~(uint64_t)0 >> (63 - (column1 - column0))) << column0;
+
+        if (mask->row[row] & span) return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,47 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - tank collision masks
+*
+*   Shells hit the pixels of the tank sprites, not their bounding box: each sprite is turned
+*   once into a packed mask, one bit per pixel and one 64 bits word per row. A hit test first
+*   rejects the shells away from the box, then ANDs the span of the shell circle on each row
+*   it covers with the row of the mask, 64 pixels at once.
+*
+*   The masks of the sprites shipped in resources/ are built in, so the headless builds hit
+*   the same pixels as the game. The windowed game builds them again from the sprites it
+*   loads (BuildTankMask()), which only makes a difference with modified sprites.
+*
+********************************************************************************************/
+
+#ifndef TANKMASK_H
+#define TANKMASK_H
+
+#include "game.h"
+
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define TANK_MASK_WIDTH                  64        // Widest sprite a mask holds, one word per row
+#define TANK_MASK_HEIGHT  TANK_SPRITE_HEIGHT
+#define TANK_MASK_ALPHA                 128        // Sprite pixels at least this opaque are solid
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct TankMask {
+    int width;                      // Pixels of the sprite, the hitbox of the tank is width x TANK_SPRITE_HEIGHT
+    int height;
+    uint64_t row[TANK_MASK_HEIGHT]; // Bit x: pixel x of the row is solid
+} TankMask;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void BuildTankMask(TankMask *mask, const unsigned char *pixels, int width, int height);    // From R8G8B8A8 pixels, cropped to TANK_MASK_WIDTH x TANK_MASK_HEIGHT
+void SetTankMask(bool leftTeam, const TankMask *mask);      // Replace the mask of a team, while no game is played
+const TankMask *GetTankMask(bool leftTeam);
+bool CheckCollisionCircleMask(Vector2 center, float radius, const TankMask *mask, Vector2 origin);  // Circle against the mask placed with its top left corner at origin
+
+#endif // TANKMASK_H
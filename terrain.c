@@ -0,0 +1,595 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - destructible terrain
+*
+*   Shapes are rasterized row by row as spans of bits, whole 64 bits words at a time, and
+*   a chunk is rebuilt from its plan the same way: its rectangles, then its craters.
+*
+*   Baking a chunk compacts the plan arrays without it, in order, so the plan stays the same
+*   bytes on every machine that played the same craters (checksums, snapshots).
+*
+*   The scratch bits of a chunk are allocated by each thread on its first plan test there,
+*   and freed when the thread exits: a shot simulation sweeps the world, any smaller set of
+*   scratch chunks would be rebuilt over and over. They are rebuilt when the stamp changed.
+*
+********************************************************************************************/
+
+#include "terrain.h"
+#include "game.h"               // HashBytes()
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(PLATFORM_WEB) && !defined(TERRAIN_NO_THREADS)
+    #define TERRAIN_NO_THREADS          // Emscripten builds are single threaded
+#endif
+
+#if !defined(TERRAIN_NO_THREADS)
+    #include <pthread.h>
+    #define THREAD_LOCAL __thread
+#else
+    #define THREAD_LOCAL
+#endif
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+
+// Chunk bits built from the plan for IsTerrainPlanSolid(), one set per thread
+typedef struct TerrainScratch {
+    uint64_t (*bits[TERRAIN_MAX_CHUNKS])[TERRAIN_CHUNK_WORDS];     // TERRAIN_HEIGHT rows of each chunk, NULL: not allocated yet
+    uint64_t stamp[TERRAIN_MAX_CHUNKS];             // Chunk stamp the bits were built for, 0: none
+    int planIndex[TERRAIN_MAX_CRATERS];             // DropChunkPlan(): new index of each plan entry, -1: dropped
+} TerrainScratch;
+
+//----------------------------------------------------------------------------------
+// Global Variables Declaration
+//----------------------------------------------------------------------------------
+static uint64_t stampCount = 0;                     // Last chunk stamp given, of any terrain
+static THREAD_LOCAL TerrainScratch *scratch = NULL;
+static bool scratchFailed = false;                  // No memory for the scratch bits: the plans are walked
+#if !defined(TERRAIN_NO_THREADS)
+static pthread_once_t scratchKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t scratchKey;                    // Frees the scratch bits of a thread when it exits
+#endif
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+static void FillChunkRec(uint64_t (*bits)[TERRAIN_CHUNK_WORDS], int chunk, int x0, int x1, int y0, int y1);
+static void CarveChunkCircle(uint64_t (*bits)[TERRAIN_CHUNK_WORDS], int chunk, int cx, int cy, int radius);
+static void RasterizeChunk(const Terrain *terrain, int chunk, uint64_t (*bits)[TERRAIN_CHUNK_WORDS]);     // Baked bits, or the plan
+static void BuildChunk(Terrain *terrain, int chunk, int slot);
+static TerrainScratch *GetScratch(void);            // Scratch of the thread, NULL if there is no memory for it
+static const uint64_t (*GetScratchChunk(const Terrain *terrain, int chunk))[TERRAIN_CHUNK_WORDS];   // NULL if there is no scratch memory
+static bool IsChunkPlanSolid(const Terrain *terrain, int chunk, int x, int y);
+static void StampChunks(Terrain *terrain, int c0, int c1);     // New stamps for chunks c0..c1 (included)
+#if !defined(TERRAIN_NO_THREADS)
+static void CreateScratchKey(void);
+static void FreeScratch(void *data);
+#endif
+static bool BakeFullestChunk(Terrain *terrain);     // Make room in the plan, false if nothing could be baked
+static void DropChunkPlan(Terrain *terrain, int chunk, int *index);    // index: TERRAIN_MAX_CRATERS entries of scratch
+static void SetSpan(uint64_t *row, int x0, int x1, bool solid);    // Set or clear bits x0..x1 (included) of a chunk row
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+void ClearTerrain(Terrain *terrain, int width)
+{
+    if (width < 1) width = 1;
+    if (width > TERRAIN_MAX_WIDTH) width = TERRAIN_MAX_WIDTH;
+
+    terrain->width = width;
+    terrain->chunkCount = (width + TERRAIN_CHUNK_WIDTH - 1)/TERRAIN_CHUNK_WIDTH;
+    terrain->streaming = (terrain->chunkCount > TERRAIN_CACHE_CHUNKS);
+    terrain->useCount = 0;
+    terrain->chunksBuilt = 0;
+    terrain->recCount = 0;
+    terrain->planCraterCount = 0;
+    terrain->bakedCount = 0;
+    terrain->cratersLost = 0;
+
+    for (int c = 0; c < TERRAIN_MAX_CHUNKS; c++)
+    {
+        terrain->chunkSlot[c] = -1;
+        terrain->firstRec[c] = -1;
+        terrain->firstCrater[c] = -1;
+        terrain->bakedSlot[c] = -1;
+    }
+
+    StampChunks(terrain, 0, TERRAIN_MAX_CHUNKS - 1);
+
+    for (int s = 0; s < TERRAIN_CACHE_CHUNKS; s++)
+    {
+        terrain->slotChunk[s] = -1;
+        terrain->slotUse[s] = 0;
+    }
+
+    // A world that fits in the cache has all its chunks, for good
+    if (!terrain->streaming)
+    {
+        for (int c = 0; c < terrain->chunkCount; c++)
+        {
+            terrain->chunkSlot[c] = (signed char)c;
+            terrain->slotChunk[c] = (short)c;
+        }
+
+        memset(terrain->bits, 0, terrain->chunkCount*sizeof(terrain->bits[0]));
+    }
+
+    terrain->generation++;
+    terrain->craterCount = 0;
+}
+
+void FillTerrainRec(Terrain *terrain, Rectangle rec)
+{
+    int x0 = (int)rec.x;
+    int x1 = (int)(rec.x + rec.width) - 1;
+    int y0 = (int)rec.y;
+    int y1 = (int)(rec.y + rec.height) - 1;
+
+    if (x0 < 0) x0 = 0;
+    if (x1 >= terrain->width) x1 = terrain->width - 1;
+    if (y0 < 0) y0 = 0;
+    if (y1 >= TERRAIN_HEIGHT) y1 = TERRAIN_HEIGHT - 1;
+    if ((x0 > x1) || (y0 > y1)) return;
+
+    for (int c = x0/TERRAIN_CHUNK_WIDTH; c <= x1/TERRAIN_CHUNK_WIDTH; c++)
+    {
+        int chunkX0 = c*TERRAIN_CHUNK_WIDTH;
+        int pieceX0 = (x0 > chunkX0) ? x0 : chunkX0;
+        int pieceX1 = (x1 < chunkX0 + TERRAIN_CHUNK_WIDTH - 1) ? x1 : chunkX0 + TERRAIN_CHUNK_WIDTH - 1;
+
+        if (terrain->streaming)
+        {
+            if (terrain->recCount == TERRAIN_MAX_RECS) return;       // Only wider worlds than the maps make could get here
+
+            TerrainRec *piece = &terrain->rec[terrain->recCount];
+
+            piece->x0 = (short)pieceX0;
+            piece->x1 = (short)pieceX1;
+            piece->y0 = (short)y0;
+            piece->y1 = (short)y1;
+            piece->next = terrain->firstRec[c];
+            terrain->firstRec[c] = (short)terrain->recCount;
+            terrain->recCount++;
+        }
+
+        if (terrain->chunkSlot[c] >= 0) FillChunkRec(terrain->bits[terrain->chunkSlot[c]], c, pieceX0, pieceX1, y0, y1);
+
+        StampChunks(terrain, c, c);
+    }
+}
+
+bool CarveTerrainCircle(Terrain *terrain, Vector2 center, int radius)
+{
+    int cx = (int)center.x;
+    int cy = (int)center.y;
+    int c0 = (cx - radius)/TERRAIN_CHUNK_WIDTH;
+    int c1 = (cx + radius)/TERRAIN_CHUNK_WIDTH;
+
+    if (cx - radius < 0) c0 = 0;
+    if (c1 >= terrain->chunkCount) c1 = terrain->chunkCount - 1;
+
+    // One plan crater per chunk touched, but the baked ones
+    for (;;)
+    {
+        int needed = 0;
+
+        for (int c = c0; c <= c1; c++) if (terrain->bakedSlot[c] < 0) needed++;
+
+        if (terrain->planCraterCount + needed <= TERRAIN_MAX_CRATERS) break;
+
+        if (!BakeFullestChunk(terrain))
+        {
+            terrain->cratersLost++;
+            return false;
+        }
+    }
+
+    for (int c = c0; c <= c1; c++)
+    {
+        if (terrain->bakedSlot[c] >= 0)
+        {
+            if (terrain->streaming) CarveChunkCircle(terrain->baked[terrain->bakedSlot[c]], c, cx, cy, radius);
+            continue;
+        }
+
+        TerrainCrater *crater = &terrain->planCrater[terrain->planCraterCount];
+
+        crater->x = cx;
+        crater->y = cy;
+        crater->radius = radius;
+        crater->next = terrain->firstCrater[c];
+        terrain->firstCrater[c] = terrain->planCraterCount;
+        terrain->planCraterCount++;
+    }
+
+    for (int c = c0; c <= c1; c++)
+    {
+        if (terrain->chunkSlot[c] >= 0) CarveChunkCircle(terrain->bits[terrain->chunkSlot[c]], c, cx, cy, radius);
+    }
+
+    StampChunks(terrain, c0, c1);
+
+    terrain->crater[terrain->craterCount%TERRAIN_CRATER_LOG] = center;
+    terrain->craterCount++;
+
+    return true;
+}
+
+// NOTE: At most TERRAIN_CACHE_CHUNKS chunks from x0 on are built, the ones required last are kept
+void RequireTerrain(Terrain *terrain, int x0, int x1)
+{
+    if (!terrain->streaming) return;
+
+    if (x0 < 0) x0 = 0;
+    if (x1 >= terrain->width) x1 = terrain->width - 1;
+    if (x0 > x1) return;
+
+    int c0 = x0/TERRAIN_CHUNK_WIDTH;
+    int c1 = x1/TERRAIN_CHUNK_WIDTH;
+    unsigned int use = ++terrain->useCount;
+
+    if (c1 - c0 >= TERRAIN_CACHE_CHUNKS) c1 = c0 + TERRAIN_CACHE_CHUNKS - 1;
+
+    for (int c = c0; c <= c1; c++)
+    {
+        int slot = terrain->chunkSlot[c];
+
+        if (slot < 0)
+        {
+            // A free slot, or the one required least recently (never one of this call)
+            slot = 0;
+
+            for (int s = 0; s < TERRAIN_CACHE_CHUNKS; s++)
+            {
+                if (terrain->slotChunk[s] < 0)
+                {
+                    slot = s;
+                    break;
+                }
+
+                if ((terrain->slotUse[s] != use) && ((terrain->slotUse[slot] == use) || (terrain->slotUse[s] < terrain->slotUse[slot]))) slot = s;
+            }
+
+            if (terrain->slotChunk[slot] >= 0) terrain->chunkSlot[terrain->slotChunk[slot]] = -1;
+
+            BuildChunk(terrain, c, slot);
+        }
+
+        terrain->slotUse[slot] = use;
+    }
+}
+
+// NOTE: The chunks get new stamps, the ones restored with a snapshot may come from another process
+void EvictTerrain(Terrain *terrain)
+{
+    StampChunks(terrain, 0, TERRAIN_MAX_CHUNKS - 1);
+
+    if (!terrain->streaming) return;
+
+    for (int c = 0; c < TERRAIN_MAX_CHUNKS; c++) terrain->chunkSlot[c] = -1;
+
+    for (int s = 0; s < TERRAIN_CACHE_CHUNKS; s++)
+    {
+        terrain->slotChunk[s] = -1;
+        terrain->slotUse[s] = 0;
+    }
+}
+
+bool IsTerrainPlanSolid(const Terrain *terrain, int x, int y)
+{
+    int chunk = x/TERRAIN_CHUNK_WIDTH;
+    int column = x%TERRAIN_CHUNK_WIDTH;
+    const uint64_t (*bits)[TERRAIN_CHUNK_WORDS] = GetScratchChunk(terrain, chunk);
+
+    if (bits == NULL) return IsChunkPlanSolid(terrain, chunk, x, y);
+
+    return (bits[y][column >> 6] >> (column & 63)) & 1;
+}
+
+// A streaming world hashes its plan (the bits of its baked chunks), the others their bits, in world order
+unsigned int GetTerrainChecksum(const Terrain *terrain, unsigned int hash)
+{
+    hash = HashBytes(hash, &terrain->width, sizeof(terrain->width));
+
+    for (int c = 0; c < terrain->chunkCount; c++)
+    {
+        if (terrain->streaming && (terrain->bakedSlot[c] >= 0)) hash = HashBytes(hash, terrain->baked[terrain->bakedSlot[c]], sizeof(terrain->baked[0]));
+        else if (terrain->streaming)
+        {
+            // The shapes only, not the links between them
+            for (int i = terrain->firstRec[c]; i >= 0; i = terrain->rec[i].next)
+            {
+                const TerrainRec *rec = &terrain->rec[i];
+                int bounds[4] = { rec->x0, rec->x1, rec->y0, rec->y1 };
+
+                hash = HashBytes(hash, bounds, sizeof(bounds));
+            }
+
+            for (int i = terrain->firstCrater[c]; i >= 0; i = terrain->planCrater[i].next)
+            {
+                const TerrainCrater *crater = &terrain->planCrater[i];
+                int circle[3] = { crater->x, crater->y, crater->radius };
+
+                hash = HashBytes(hash, circle, sizeof(circle));
+            }
+        }
+        else hash = HashBytes(hash, terrain->bits[terrain->chunkSlot[c]], sizeof(terrain->bits[0]));
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+// Fill world columns x0..x1 of rows y0..y1 in the bits of a chunk
+static void FillChunkRec(uint64_t (*bits)[TERRAIN_CHUNK_WORDS], int chunk, int x0, int x1, int y0, int y1)
+{
+    int chunkX0 = chunk*TERRAIN_CHUNK_WIDTH;
+
+    for (int y = y0; y <= y1; y++) SetSpan(bits[y], x0 - chunkX0, x1 - chunkX0, true);
+}
+
+static void CarveChunkCircle(uint64_t (*bits)[TERRAIN_CHUNK_WORDS], int chunk, int cx, int cy, int radius)
+{
+    int chunkX0 = chunk*TERRAIN_CHUNK_WIDTH;
+
+    for (int dy = -radius; dy <= radius; dy++)
+    {
+        int y = cy + dy;
+
+        if ((y < 0) || (y >= TERRAIN_HEIGHT)) continue;
+
+        int halfWidth = (int)sqrtf((float)(radius*radius - dy*dy));
+
+        SetSpan(bits[y], cx - halfWidth - chunkX0, cx + halfWidth - chunkX0, false);
+    }
+}
+
+static void RasterizeChunk(const Terrain *terrain, int chunk, uint64_t (*bits)[TERRAIN_CHUNK_WORDS])
+{
+    if (terrain->bakedSlot[chunk] >= 0)
+    {
+        memcpy(bits, terrain->baked[terrain->bakedSlot[chunk]], sizeof(terrain->baked[0]));
+        return;
+    }
+
+    memset(bits, 0, sizeof(terrain->bits[0]));
+
+    for (int i = terrain->firstRec[chunk]; i >= 0; i = terrain->rec[i].next)
+    {
+        const TerrainRec *rec = &terrain->rec[i];
+
+        FillChunkRec(bits, chunk, rec->x0, rec->x1, rec->y0, rec->y1);
+    }
+
+    for (int i = terrain->firstCrater[chunk]; i >= 0; i = terrain->planCrater[i].next)
+    {
+        const TerrainCrater *crater = &terrain->planCrater[i];
+
+        CarveChunkCircle(bits, chunk, crater->x, crater->y, crater->radius);
+    }
+}
+
+// Build the bits of a chunk from its plan into a cache slot
+static void BuildChunk(Terrain *terrain, int chunk, int slot)
+{
+    RasterizeChunk(terrain, chunk, terrain->bits[slot]);
+
+    terrain->chunkSlot[chunk] = (signed char)slot;
+    terrain->slotChunk[slot] = (short)chunk;
+    terrain->chunksBuilt++;
+}
+
+// Bake the chunk with the most plan craters (the first of them on a tie), its bits stay the same
+static bool BakeFullestChunk(Terrain *terrain)
+{
+    if (terrain->streaming && (terrain->bakedCount == TERRAIN_BAKED_CHUNKS)) return false;
+
+    TerrainScratch *thread = GetScratch();
+
+    if (thread == NULL) return false;
+
+    int fullest = -1;
+    int most = 0;
+
+    for (int c = 0; c < terrain->chunkCount; c++)
+    {
+        int count = 0;
+
+        for (int i = terrain->firstCrater[c]; i >= 0; i = terrain->planCrater[i].next) count++;
+
+        if (count > most)
+        {
+            fullest = c;
+            most = count;
+        }
+    }
+
+    if (fullest < 0) return false;
+
+    if (terrain->streaming)
+    {
+        int slot = terrain->bakedCount++;
+
+        RasterizeChunk(terrain, fullest, terrain->baked[slot]);
+        terrain->bakedSlot[fullest] = (signed char)slot;
+    }
+    else terrain->bakedSlot[fullest] = terrain->chunkSlot[fullest];
+
+    DropChunkPlan(terrain, fullest, thread->planIndex);
+
+    return true;
+}
+
+// Remove the rectangles and the craters of a chunk from the plan, the others keep their order
+static void DropChunkPlan(Terrain *terrain, int chunk, int *index)
+{
+    int count = 0;
+
+    for (int i = 0; i < terrain->recCount; i++) index[i] = 0;
+    for (int i = terrain->firstRec[chunk]; i >= 0; i = terrain->rec[i].next) index[i] = -1;
+
+    for (int i = 0; i < terrain->recCount; i++)
+    {
+        if (index[i] < 0) continue;
+
+        index[i] = count;
+        terrain->rec[count++] = terrain->rec[i];
+    }
+
+    for (int i = 0; i < count; i++) if (terrain->rec[i].next >= 0) terrain->rec[i].next = (short)index[terrain->rec[i].next];
+    for (int c = 0; c < terrain->chunkCount; c++) if (terrain->firstRec[c] >= 0) terrain->firstRec[c] = (short)index[terrain->firstRec[c]];
+
+    terrain->recCount = count;
+    terrain->firstRec[chunk] = -1;
+
+    count = 0;
+
+    for (int i = 0; i < terrain->planCraterCount; i++) index[i] = 0;
+    for (int i = terrain->firstCrater[chunk]; i >= 0; i = terrain->planCrater[i].next) index[i] = -1;
+
+    for (int i = 0; i < terrain->planCraterCount; i++)
+    {
+        if (index[i] < 0) continue;
+
+        index[i] = count;
+        terrain->planCrater[count++] = terrain->planCrater[i];
+    }
+
+    for (int i = 0; i < count; i++) if (terrain->planCrater[i].next >= 0) terrain->planCrater[i].next = index[terrain->planCrater[i].next];
+    for (int c = 0; c < terrain->chunkCount; c++) if (terrain->firstCrater[c] >= 0) terrain->firstCrater[c] = index[terrain->firstCrater[c]];
+
+    terrain->planCraterCount = count;
+    terrain->firstCrater[chunk] = -1;
+}
+
+// Scratch of the thread, allocated on its first use
+static TerrainScratch *GetScratch(void)
+{
+    if (scratch != NULL) return scratch;
+
+    scratch = (TerrainScratch *)calloc(1, sizeof(TerrainScratch));
+
+    if (scratch == NULL)
+    {
+        scratchFailed = true;
+        return NULL;
+    }
+#if !defined(TERRAIN_NO_THREADS)
+    pthread_once(&scratchKeyOnce, CreateScratchKey);
+    pthread_setspecific(scratchKey, scratch);
+#endif
+
+    return scratch;
+}
+
+// Bits of a chunk without cache slot: its baked bits, or the scratch bits of the thread, built if its stamp is not there
+static const uint64_t (*GetScratchChunk(const Terrain *terrain, int chunk))[TERRAIN_CHUNK_WORDS]
+{
+    if (terrain->bakedSlot[chunk] >= 0) return terrain->baked[terrain->bakedSlot[chunk]];
+
+    uint64_t stamp = terrain->chunkStamp[chunk];
+
+    if ((scratch != NULL) && (scratch->stamp[chunk] == stamp)) return scratch->bits[chunk];
+    if (scratchFailed || (GetScratch() == NULL)) return NULL;
+
+    if (scratch->bits[chunk] == NULL)
+    {
+        scratch->bits[chunk] = (uint64_t (*)[TERRAIN_CHUNK_WORDS])malloc(sizeof(terrain->bits[0]));
+
+        if (scratch->bits[chunk] == NULL)
+        {
+            scratchFailed = true;
+            return NULL;
+        }
+    }
+
+    RasterizeChunk(terrain, chunk, scratch->bits[chunk]);
+    scratch->stamp[chunk] = stamp;
+
+    return scratch->bits[chunk];
+}
+
+// Same spans as FillTerrainRec() and CarveTerrainCircle(): ground if a rectangle covers the point and no crater does
+static bool IsChunkPlanSolid(const Terrain *terrain, int chunk, int x, int y)
+{
+    bool solid = false;
+
+    for (int i = terrain->firstRec[chunk]; i >= 0; i = terrain->rec[i].next)
+    {
+        const TerrainRec *rec = &terrain->rec[i];
+
+        if ((x >= rec->x0) && (x <= rec->x1) && (y >= rec->y0) && (y <= rec->y1))
+        {
+            solid = true;
+            break;
+        }
+    }
+
+    if (!solid) return false;
+
+    for (int i = terrain->firstCrater[chunk]; i >= 0; i = terrain->planCrater[i].next)
+    {
+        const TerrainCrater *crater = &terrain->planCrater[i];
+        int dy = y - crater->y;
+
+        if ((dy < -crater->radius) || (dy > crater->radius)) continue;
+
+        int halfWidth = (int)sqrtf((float)(crater->radius*crater->radius - dy*dy));
+
+        if ((x >= crater->x - halfWidth) && (x <= crater->x + halfWidth)) return false;
+    }
+
+    return true;
+}
+
+static void StampChunks(Terrain *terrain, int c0, int c1)
+{
+    for (int c = c0; c <= c1; c++) terrain->chunkStamp[c] = __atomic_add_fetch(&stampCount, 1, __ATOMIC_RELAXED);
+}
+
+#if !defined(TERRAIN_NO_THREADS)
+static void CreateScratchKey(void)
+{
+    pthread_key_create(&scratchKey, FreeScratch);
+}
+
+static void FreeScratch(void *data)
+{
+    TerrainScratch *exiting = (TerrainScratch *)data;
+
+    for (int c = 0; c < TERRAIN_MAX_CHUNKS; c++) free(exiting->bits[c]);
+
+    free(exiting);
+}
+#endif
+
+static void SetSpan(uint64_t *row, int x0, int x1, bool solid)
+{
+    if (x0 < 0) x0 = 0;
+    if (x1 >= TERRAIN_CHUNK_WIDTH) x1 = TERRAIN_CHUNK_WIDTH - 1;
+    if (x0 > x1) return;
+
+    int word0 = x0 >> 6;
+    int word1 = x1 >> 6;
+    uint64_t mask0 = ~0ULL << (x0 & 63);            // Bits from x0 to the end of its word
+    uint64_t mask1 = ~0ULL >> (63 - (x1 & 63));     // Bits from the start of its word to x1
+
+    for (int w = word0; w <= word1; w++)
+    {
+        uint64_t mask = ~0ULL;
+
+        if (w == word0) mask &= mask0;
+        if (w == word1) mask &= mask1;
+
+        if (solid) row[w] |= mask;
+        else row[w] &= ~mask;
+    }
+}
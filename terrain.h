@@ -0,0 +1,130 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - destructible terrain
+*
+*   The ground is a packed bitmask, one bit per pixel. Buildings are filled in once per map
+*   and each explosion carves its crater into it, so testing a point against the terrain is
+*   a single lookup, whatever the number of explosions so far.
+*
+*   The world is cut in chunks of TERRAIN_CHUNK_WIDTH columns, and only TERRAIN_CACHE_CHUNKS
+*   of them have bits at once. A world that fits in the cache keeps all its chunks, as a one
+*   screen world always did. A wider world streams them: each chunk keeps the list of the
+*   rectangles and craters that made it (its plan), its bits are built from the plan when the
+*   game asks for it (RequireTerrain()) and dropped again, least recently required first.
+*   Every world keeps the craters of its chunks in the plan, the renderer draws them from it.
+*   A point of a chunk without bits is read from scratch bits of the calling thread, built
+*   from the plan the same way but outside of the game state, so the const callers (shot
+*   simulations of the AI and of the preview) get a single lookup too, and the answer never
+*   depends on which chunks happen to be in the cache. Each chunk has a stamp, new whenever
+*   its ground changes, that tells whether scratch bits are still its own.
+*
+*   When the plan has no room left for a crater, the chunk with the most craters is baked:
+*   its bits are built once more, kept for good in one of TERRAIN_BAKED_CHUNKS slots and its
+*   plan is dropped, the craters dug there later go straight into those bits. A world that
+*   fits in the cache only drops the plan, its bits are kept for good anyway. Baked chunks
+*   are drawn from their bits.
+*
+********************************************************************************************/
+
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#if defined(GAME_HEADLESS)
+    #include "headless.h"
+#else
+    #include "raylib.h"
+#endif
+
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define TERRAIN_HEIGHT                  720        // Same as screenHeight
+#define TERRAIN_MAX_WIDTH             20480        // 16 screens, see MAX_WORLD_SCREENS
+
+#define TERRAIN_CHUNK_WIDTH             512        // Columns of a chunk
+#define TERRAIN_CHUNK_WORDS  (TERRAIN_CHUNK_WIDTH/64)     // 64 bits words per row of a chunk
+#define TERRAIN_MAX_CHUNKS   (TERRAIN_MAX_WIDTH/TERRAIN_CHUNK_WIDTH)
+#define TERRAIN_CACHE_CHUNKS              8        // Chunks with bits at once (46 KB each), a screen is 3
+
+#define TERRAIN_MAX_RECS                512        // Rectangles in the plan, cut at the chunk edges
+#define TERRAIN_MAX_CRATERS            8192        // Craters in the plan (one per chunk touched), then a chunk is baked
+#define TERRAIN_BAKED_CHUNKS              4        // Chunks whose plan was baked into bits kept for good (46 KB each)
+
+#define CRATER_RADIUS                    30
+#define TERRAIN_CRATER_LOG              256        // Last craters remembered, more than a volley can dig in one step
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+
+// Piece of a rectangle inside a chunk, bounds included
+typedef struct TerrainRec {
+    short x0, x1;
+    short y0, y1;
+    short next;                     // Next rectangle of the chunk, -1: last
+} TerrainRec;
+
+typedef struct TerrainCrater {
+    int x, y;                       // Center, rounded as CarveTerrainCircle() does
+    int radius;
+    int next;                       // Next crater of the chunk, -1: last
+} TerrainCrater;
+
+typedef struct Terrain {
+    int width;                      // World width, set by ClearTerrain()
+    int chunkCount;
+    bool streaming;                 // More chunks than the cache holds: bits come and go, the plan is the ground
+
+    uint64_t bits[TERRAIN_CACHE_CHUNKS][TERRAIN_HEIGHT][TERRAIN_CHUNK_WORDS];  // Bit (x%64) of word [slot][y][x/64] of its chunk is set where there is ground
+    signed char chunkSlot[TERRAIN_MAX_CHUNKS];      // Cache slot holding the bits of each chunk, -1: none
+    short slotChunk[TERRAIN_CACHE_CHUNKS];          // Chunk in each cache slot, -1: free
+    unsigned int slotUse[TERRAIN_CACHE_CHUNKS];     // Last RequireTerrain() of the slot, the lowest is evicted
+    unsigned int useCount;
+    int chunksBuilt;                                // Statistics: chunk bits built from the plan since ClearTerrain()
+
+    // Plan: the rectangles of streaming worlds, the craters of every world
+    short firstRec[TERRAIN_MAX_CHUNKS];
+    int firstCrater[TERRAIN_MAX_CHUNKS];
+    TerrainRec rec[TERRAIN_MAX_RECS];
+    int recCount;
+    TerrainCrater planCrater[TERRAIN_MAX_CRATERS];
+    int planCraterCount;
+    uint64_t baked[TERRAIN_BAKED_CHUNKS][TERRAIN_HEIGHT][TERRAIN_CHUNK_WORDS];   // Bits of the baked chunks, the plan of the others
+    signed char bakedSlot[TERRAIN_MAX_CHUNKS];      // Baked slot of each chunk (its cache slot if not streaming), -1: built from its plan
+    int bakedCount;                                 // Baked slots in use, taken in order
+    int cratersLost;                                // Craters not dug since ClearTerrain(): the plan and the baked slots were full
+    uint64_t chunkStamp[TERRAIN_MAX_CHUNKS];        // Unique in the process, new whenever the ground of the chunk changes
+
+    unsigned int generation;                        // Bumped by ClearTerrain(), tells the renderers the map changed
+    int craterCount;                                // Craters carved since the last ClearTerrain()
+    Vector2 crater[TERRAIN_CRATER_LOG];             // Centers of the last craters, crater n is at [n%TERRAIN_CRATER_LOG]
+} Terrain;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+void ClearTerrain(Terrain *terrain, int width);                         // Remove all the ground, of a world width columns wide
+void FillTerrainRec(Terrain *terrain, Rectangle rec);                   // Add ground (building), before any crater
+bool CarveTerrainCircle(Terrain *terrain, Vector2 center, int radius);  // Remove ground (crater), false (counted in cratersLost) if a streaming world has no room left for it
+void RequireTerrain(Terrain *terrain, int x0, int x1);                  // Build the bits of the chunks of columns x0..x1, evicting others
+void EvictTerrain(Terrain *terrain);                                    // Drop the bits of every chunk of a streaming world, the plan stays
+bool IsTerrainPlanSolid(const Terrain *terrain, int x, int y);          // Ground at (x, y) of the world, from the scratch bits of its chunk
+unsigned int GetTerrainChecksum(const Terrain *terrain, unsigned int hash);    // FNV-1a of the ground, the same whatever chunks have bits
+
+// Is there ground at (x, y)? Left, right and above the world is air, below it is bedrock
+static inline bool IsTerrainSolid(const Terrain *terrain, int x, int y)
+{
+    if ((x < 0) || (x >= terrain->width) || (y < 0)) return false;
+    if (y >= TERRAIN_HEIGHT) return true;
+
+    int slot = terrain->chunkSlot[x/TERRAIN_CHUNK_WIDTH];
+    int column = x%TERRAIN_CHUNK_WIDTH;
+
+    if (slot < 0) return IsTerrainPlanSolid(terrain, x, y);
+
+    return (terrain->bits[slot][y][column >> 6] >> (column & 63)) & 1;
+}
+
+#endif // TERRAIN_H
@@ -0,0 +1,346 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - network transports
+*
+*   Sockets are non-blocking: ReceivePacket() is polled once per frame by the game.
+*   A loopback link is one allocation shared by its two ends, freed with the last one.
+*
+********************************************************************************************/
+
+#include "transport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PLATFORM_WEB) && !defined(TRANSPORT_NO_UDP)
+    #define TRANSPORT_NO_UDP            // Browsers have no UDP sockets, only the loopback is available
+#endif
+
+#if !defined(TRANSPORT_NO_UDP)
+    #if defined(_WIN32)
+        #include <winsock2.h>
+        #include <ws2tcpip.h>
+
+        typedef SOCKET UdpSocket;
+        typedef int AddressSize;
+        #define CloseSocket closesocket
+    #else
+        #include <sys/types.h>
+        #include <sys/socket.h>
+        #include <netinet/in.h>
+        #include <netdb.h>
+        #include <fcntl.h>
+        #include <unistd.h>
+
+        typedef int UdpSocket;
+        typedef socklen_t AddressSize;
+        #define INVALID_SOCKET (-1)
+        #define CloseSocket close
+    #endif
+#endif
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+#if !defined(TRANSPORT_NO_UDP)
+typedef struct UdpLink {
+    UdpSocket socket;
+    struct sockaddr_storage peer;
+    AddressSize peerSize;
+    bool hasPeer;                   // The host learns its peer from the first datagram
+} UdpLink;
+#endif
+
+typedef struct LoopbackPacket {
+    int size;
+    unsigned char data[TRANSPORT_MAX_PACKET];
+} LoopbackPacket;
+
+typedef struct LoopbackQueue {
+    LoopbackPacket packet[TRANSPORT_LOOPBACK_QUEUE];
+    int first;
+    int count;
+} LoopbackQueue;
+
+typedef struct LoopbackLink {
+    LoopbackQueue queue[2];         // Datagrams on their way to side 0 and to side 1
+    int lossPercent;
+    unsigned int randomState;       // Which datagrams are lost, so a test run can be repeated
+    int openEnds;
+} LoopbackLink;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration (local)
+//------------------------------------------------------------------------------------
+#if !defined(TRANSPORT_NO_UDP)
+static bool OpenUdpSocket(Transport *transport, UdpLink *link, int family);
+#endif
+static bool DropPacket(LoopbackLink *link);
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions
+//------------------------------------------------------------------------------------
+bool OpenUdpHost(Transport *transport, int port)
+{
+    *transport = (Transport){ 0 };
+
+#if defined(TRANSPORT_NO_UDP)
+    (void)port;
+    return false;
+#else
+    UdpLink *link = (UdpLink *)calloc(1, sizeof(UdpLink));
+
+    if (!OpenUdpSocket(transport, link, AF_INET)) return false;
+
+    struct sockaddr_in address = { 0 };
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((unsigned short)port);
+
+    if (bind(link->socket, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        CloseTransport(transport);
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+bool OpenUdpClient(Transport *transport, const char *host, int port)
+{
+    *transport = (Transport){ 0 };
+
+#if defined(TRANSPORT_NO_UDP)
+    (void)host;
+    (void)port;
+    return false;
+#else
+    struct addrinfo hints = { 0 };
+    struct addrinfo *found = NULL;
+    char service[16] = { 0 };
+
+    hints.ai_family = AF_INET;                  // The host listens on IPv4
+    hints.ai_socktype = SOCK_DGRAM;
+
+    sprintf(service, "%i", port);
+
+#if defined(_WIN32)
+    WSADATA data;
+    WSAStartup(MAKEWORD(2, 2), &data);      // getaddrinfo() needs it, OpenUdpSocket() starts it again
+#endif
+
+    bool resolved = (getaddrinfo(host, service, &hints, &found) == 0) && (found != NULL);
+
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+
+    if (!resolved) return false;
+
+    UdpLink *link = (UdpLink *)calloc(1, sizeof(UdpLink));
+    bool opened = OpenUdpSocket(transport, link, found->ai_family);
+
+    if (opened)
+    {
+        memcpy(&link->peer, found->ai_addr, found->ai_addrlen);
+        link->peerSize = (AddressSize)found->ai_addrlen;
+        link->hasPeer = true;
+    }
+
+    freeaddrinfo(found);
+
+    return opened;
+#endif
+}
+
+void OpenLoopback(Transport *a, Transport *b, int lossPercent, unsigned int seed)
+{
+    LoopbackLink *link = (LoopbackLink *)calloc(1, sizeof(LoopbackLink));
+
+    link->lossPercent = lossPercent;
+    link->randomState = (seed != 0) ? seed : 1;
+    link->openEnds = 2;
+
+    *a = (Transport){ TRANSPORT_LOOPBACK, 0, link };
+    *b = (Transport){ TRANSPORT_LOOPBACK, 1, link };
+}
+
+void CloseTransport(Transport *transport)
+{
+    switch (transport->type)
+    {
+    #if !defined(TRANSPORT_NO_UDP)
+        case TRANSPORT_UDP:
+        {
+            UdpLink *link = (UdpLink *)transport->link;
+
+            CloseSocket(link->socket);
+            free(link);
+        #if defined(_WIN32)
+            WSACleanup();
+        #endif
+        } break;
+    #endif
+        case TRANSPORT_LOOPBACK:
+        {
+            LoopbackLink *link = (LoopbackLink *)transport->link;
+
+            if (--link->openEnds == 0) free(link);
+        } break;
+        default: break;
+    }
+
+    *transport = (Transport){ 0 };
+}
+
+bool SendPacket(Transport *transport, const unsigned char *data, int size)
+{
+    if ((size <= 0) || (size > TRANSPORT_MAX_PACKET)) return false;
+
+    switch (transport->type)
+    {
+    #if !defined(TRANSPORT_NO_UDP)
+        case TRANSPORT_UDP:
+        {
+            UdpLink *link = (UdpLink *)transport->link;
+
+            if (!link->hasPeer) return false;
+
+            return (sendto(link->socket, (const char *)data, size, 0, (struct sockaddr *)&link->peer, link->peerSize) == size);
+        }
+    #endif
+        case TRANSPORT_LOOPBACK:
+        {
+            LoopbackLink *link = (LoopbackLink *)transport->link;
+            LoopbackQueue *queue = &link->queue[1 - transport->side];
+
+            if (DropPacket(link) || (queue->count == TRANSPORT_LOOPBACK_QUEUE)) return true;      // Lost on the way
+
+            LoopbackPacket *packet = &queue->packet[(queue->first + queue->count)%TRANSPORT_LOOPBACK_QUEUE];
+
+            packet->size = size;
+            memcpy(packet->data, data, size);
+            queue->count++;
+
+            return true;
+        }
+        default: return false;
+    }
+}
+
+int ReceivePacket(Transport *transport, unsigned char *data, int size)
+{
+    switch (transport->type)
+    {
+    #if !defined(TRANSPORT_NO_UDP)
+        case TRANSPORT_UDP:
+        {
+            UdpLink *link = (UdpLink *)transport->link;
+            unsigned char packet[TRANSPORT_MAX_PACKET];
+            struct sockaddr_storage from;
+            AddressSize fromSize = sizeof(from);
+
+            while (true)
+            {
+                int received = (int)recvfrom(link->socket, (char *)packet, sizeof(packet), 0, (struct sockaddr *)&from, &fromSize);
+
+                if (received <= 0) return 0;        // Nothing waiting (or an error, the protocol resends)
+
+                if (!link->hasPeer)
+                {
+                    link->peer = from;
+                    link->peerSize = fromSize;
+                    link->hasPeer = true;
+                }
+                else if ((fromSize != link->peerSize) || (memcmp(&from, &link->peer, fromSize) != 0))
+                {
+                    fromSize = sizeof(from);
+                    continue;                       // Somebody else, only one peer per game
+                }
+
+                if (received > size) received = size;
+                memcpy(data, packet, received);
+
+                return received;
+            }
+        }
+    #endif
+        case TRANSPORT_LOOPBACK:
+        {
+            LoopbackLink *link = (LoopbackLink *)transport->link;
+            LoopbackQueue *queue = &link->queue[transport->side];
+
+            if (queue->count == 0) return 0;
+
+            LoopbackPacket *packet = &queue->packet[queue->first];
+            int received = (packet->size < size) ? packet->size : size;
+
+            memcpy(data, packet->data, received);
+            queue->first = (queue->first + 1)%TRANSPORT_LOOPBACK_QUEUE;
+            queue->count--;
+
+            return received;
+        }
+        default: return 0;
+    }
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definitions (local)
+//------------------------------------------------------------------------------------
+
+#if !defined(TRANSPORT_NO_UDP)
+// Create a non-blocking datagram socket, the transport owns the link from here
+static bool OpenUdpSocket(Transport *transport, UdpLink *link, int family)
+{
+#if defined(_WIN32)
+    WSADATA data;
+
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+    {
+        free(link);
+        return false;
+    }
+#endif
+
+    link->socket = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+
+    if (link->socket == INVALID_SOCKET)
+    {
+        free(link);
+    #if defined(_WIN32)
+        WSACleanup();
+    #endif
+        return false;
+    }
+
+#if defined(_WIN32)
+    u_long nonBlocking = 1;
+    ioctlsocket(link->socket, FIONBIO, &nonBlocking);
+#else
+    fcntl(link->socket, F_SETFL, fcntl(link->socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    transport->type = TRANSPORT_UDP;
+    transport->link = link;
+
+    return true;
+}
+#endif
+
+// Decide if the next loopback datagram is lost (xorshift32)
+static bool DropPacket(LoopbackLink *link)
+{
+    if (link->lossPercent <= 0) return false;
+
+    unsigned int x = link->randomState;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    link->randomState = x;
+
+    return ((int)(x%100) < link->lossPercent);
+}
@@ -0,0 +1,51 @@
+/*******************************************************************************************
+*
+*   Tank Destroyer - network transports
+*
+*   Unreliable datagrams between two peers, what the lockstep protocol of net.c runs on:
+*   packets can be lost, the protocol resends them. Two transports:
+*       - UDP, between two machines (the host waits for the first datagram of its peer)
+*       - Loopback, both ends in the same process, with optional packet loss, for tests
+*
+*   NOTE: This module does not include raylib.h: windows.h (sockets) clashes with it.
+*
+********************************************************************************************/
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Some Defines
+//----------------------------------------------------------------------------------
+#define TRANSPORT_MAX_PACKET             32        // Bytes of the largest datagram
+#define TRANSPORT_LOOPBACK_QUEUE        256        // Datagrams in flight each way on a loopback link, more are lost
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum TransportType {
+    TRANSPORT_NONE = 0,
+    TRANSPORT_UDP,
+    TRANSPORT_LOOPBACK
+} TransportType;
+
+typedef struct Transport {
+    TransportType type;
+    int side;                       // Loopback: end of the link, 0 or 1
+    void *link;                     // Socket and peer address, or the loopback queues
+} Transport;
+
+//------------------------------------------------------------------------------------
+// Module Functions Declaration
+//------------------------------------------------------------------------------------
+bool OpenUdpHost(Transport *transport, int port);                           // Listen on a port, the first peer to send is the peer
+bool OpenUdpClient(Transport *transport, const char *host, int port);
+void OpenLoopback(Transport *a, Transport *b, int lossPercent, unsigned int seed);    // Two ends of an in-process link, lossPercent of the datagrams are dropped
+void CloseTransport(Transport *transport);
+
+bool SendPacket(Transport *transport, const unsigned char *data, int size);    // Returns false if it could not be sent (no peer yet), it may still be lost
+int ReceivePacket(Transport *transport, unsigned char *data, int size);        // Next datagram, 0 if there is none, never blocks
+
+#endif // TRANSPORT_H